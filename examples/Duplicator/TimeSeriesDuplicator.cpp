@@ -1,6 +1,7 @@
 #include "TimeSeriesDuplicator.h"
 
 #include "TimeSeriesFilter.h"
+#include "TimeSeriesEvaluationPlan.h"
 
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/thread/thread.hpp>
@@ -194,15 +195,25 @@ std::pair<time_t,int> TimeSeriesDuplicator::_fetchAll(time_t start, time_t end)
   int nPoints = 0;
   _pctCompleteFetch = 0.;
   size_t nSeries = _destinationSeries.size();
+  
+  // select the sources in batches, rather than one round trip per series.
+  if (_shouldRun && nSeries > 0) {
+    BOOST_FOREACH(TimeSeries::_sp ts, _destinationSeries) {
+      ts->resetCache();
+    }
+    vector<TimeSeries::_sp> sinks(_destinationSeries.begin(), _destinationSeries.end());
+    TimeSeriesEvaluationPlan(sinks, TimeRange(start, end)).preFetchRoots();
+  }
+  
   BOOST_FOREACH(TimeSeries::_sp ts, _destinationSeries) {
     if (_shouldRun) {
-      ts->resetCache();
       TimeSeries::PointCollection pc = ts->pointCollection(TimeRange(start, end));
+      TimeSeries::PointCollection::Summary summary = pc.summary();
       stringstream tsSS;
-      tsSS << ts->name() << " : " << pc.count() << " points (max:" << pc.max() << " min:" << pc.min() << " avg:" << pc.mean() << ")";
+      tsSS << ts->name() << " : " << summary.count << " points (max:" << summary.max << " min:" << summary.min << " avg:" << summary.mean << ")";
       this->_logLine(tsSS.str(),RTX_DUPLICATOR_LOGLEVEL_VERBOSE);
       _pctCompleteFetch += 1./(double)nSeries;
-      nPoints += pc.count();
+      nPoints += summary.count;
     }
     
   }
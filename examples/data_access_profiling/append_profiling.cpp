@@ -0,0 +1,114 @@
+//
+//  append_profiling.cpp
+//  data_access_profiling
+//
+//  one thread writes simulation-style output (one point per series per step)
+//  while reader threads scan the same series. compares a BufferPointRecord with
+//  an AppendPointRecord, and checks that every scan sees an ordered, gap-free
+//  prefix of what was written, including across a rewind.
+//
+
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "BufferPointRecord.h"
+#include "AppendPointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t step = 300;
+const int nSeries = 200;
+const int nSteps = 2000;
+const int nReaders = 4;
+
+
+string seriesName(int i) {
+  stringstream name;
+  name << "junction_" << i << "_head";
+  return name.str();
+}
+
+// values encode their time and the pass that wrote them.
+double valueAt(time_t t, int pass) {
+  return (double)(t - start) + pass * 0.5;
+}
+
+void simulate(PointRecord::_sp record) {
+  for (int pass = 0; pass < 2; ++pass) {
+    // the second pass re-simulates the last quarter, as after a tank reset.
+    time_t from = (pass == 0) ? start : start + (nSteps * 3 / 4) * step;
+    for (time_t t = from; t < start + nSteps * step; t += step) {
+      for (int i = 0; i < nSeries; ++i) {
+        // a one-point batch: BufferPointRecord only caches points added in batches.
+        record->addPoints(seriesName(i), vector<Point>(1, Point(t, valueAt(t, pass), Point::opc_good, 1.)));
+      }
+    }
+  }
+}
+
+void scan(PointRecord::_sp record, volatile bool* stop, size_t* nScans, size_t* nBad) {
+  unsigned int seed = 7;
+  while (!*stop) {
+    vector<Point> points = record->pointsInRange(seriesName(rand_r(&seed) % nSeries), start, start + nSteps * step);
+    for (size_t i = 0; i < points.size(); ++i) {
+      bool inOrder = (points[i].time == start + (time_t)i * step);
+      double v = points[i].value - (double)(points[i].time - start);
+      bool fromAPass = (v == 0. || v == 0.5);
+      if (!inOrder || !fromAPass) {
+        ++*nBad;
+        break;
+      }
+    }
+    ++*nScans;
+  }
+}
+
+
+void run(const string& label, PointRecord::_sp record) {
+  for (int i = 0; i < nSeries; ++i) {
+    record->registerAndGetIdentifierForSeriesWithUnits(seriesName(i), RTX_DIMENSIONLESS);
+  }
+
+  vector<size_t> nScans(nReaders, 0), nBad(nReaders, 0);
+  volatile bool stop = false;
+  boost::thread_group readers;
+  for (int r = 0; r < nReaders; ++r) {
+    readers.create_thread(boost::bind(&scan, record, &stop, &nScans[r], &nBad[r]));
+  }
+
+  boost::timer::cpu_timer timer;
+  simulate(record);
+  double seconds = (double)timer.elapsed().wall / 1e9;
+  stop = true;
+  readers.join_all();
+
+  size_t scans = 0, bad = 0;
+  for (int r = 0; r < nReaders; ++r) {
+    scans += nScans[r];
+    bad += nBad[r];
+  }
+  vector<Point> final = record->pointsInRange(seriesName(0), start, start + nSteps * step);
+  bool complete = (final.size() == (size_t)nSteps);
+  bool rewritten = (complete && final.back().value == valueAt(final.back().time, 1));
+
+  cout << label << (size_t)((double)(nSeries * nSteps * 5 / 4) / seconds) << " appends/s with " << nReaders << " readers (" << scans << " scans, " << bad << " inconsistent); " << (complete ? "complete" : "INCOMPLETE") << ", re-run " << (rewritten ? "replaced" : "kept") << " earlier values" << endl;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  BufferPointRecord::_sp buffer(new BufferPointRecord);
+  buffer->setMemoryBudget(0);
+  run("BufferPointRecord:  ", buffer);
+
+  run("AppendPointRecord:  ", AppendPointRecord::_sp(new AppendPointRecord));
+  return 0;
+}
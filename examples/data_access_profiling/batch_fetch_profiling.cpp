@@ -0,0 +1,90 @@
+//
+//  batch_fetch_profiling.cpp
+//  data_access_profiling
+//
+//  many series in one SQLite record, fetched over the same day: one query per
+//  series, and one batched prefetch (as Model::fetchElementInputs does through
+//  TimeSeriesFetchPool). reports wall time for each and checks the points match.
+//
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "SqlitePointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const time_t day = 24 * 3600;
+const int nSeries = 300;
+
+
+string seriesName(int i) {
+  stringstream name;
+  name << "sensor_" << i;
+  return name.str();
+}
+
+SqlitePointRecord::_sp openRecord(const string& path) {
+  SqlitePointRecord::_sp record(new SqlitePointRecord);
+  record->setConnectionString(path);
+  record->dbConnect();
+  for (int i = 0; i < nSeries; ++i) {
+    record->registerAndGetIdentifierForSeriesWithUnits(seriesName(i), RTX_DIMENSIONLESS);
+  }
+  return record;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const string path = "batch_fetch_profiling.sqlite";
+  remove(path.c_str());
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    for (int i = 0; i < nSeries; ++i) {
+      vector<Point> points;
+      for (time_t t = start; t < start + 3 * day; t += period) {
+        points.push_back(Point(t, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+      }
+      record->addPoints(seriesName(i), points);
+    }
+  }
+
+  vector<string> names;
+  for (int i = 0; i < nSeries; ++i) {
+    names.push_back(seriesName(i));
+  }
+  const time_t from = start + day, to = start + 2 * day;
+
+  size_t serialCount = 0, batchCount = 0;
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    cout << "one query per series: ";
+    boost::timer::auto_cpu_timer t;
+    for (int i = 0; i < nSeries; ++i) {
+      serialCount += record->pointsInRange(names[i], from, to).size();
+    }
+  }
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    cout << "batched prefetch:     ";
+    boost::timer::auto_cpu_timer t;
+    record->preFetchRanges(names, from, to);
+    for (int i = 0; i < nSeries; ++i) {
+      batchCount += record->pointsInRange(names[i], from, to).size();
+    }
+  }
+
+  remove(path.c_str());
+  cout << nSeries << " series, " << serialCount << " / " << batchCount << " points: " << (serialCount == batchCount ? "identical" : "DIFFERENT") << endl;
+  return serialCount == batchCount ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+//
+//  cache_budget_profiling.cpp
+//  data_access_profiling
+//
+//  many series share one buffer record with a small memory budget. a scan over
+//  every series pushes the record past its budget; the least-recently used
+//  chunks are evicted, while a repeatedly read "hot" series stays resident.
+//  reports the record's hit/miss/eviction counters. the byte count is allocated
+//  buffer capacity, so a series that was evicted must also have given its
+//  storage back for the record to stay under budget.
+//
+
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "BufferPointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+void printStats(const string& label, BufferPointRecord::_sp record) {
+  BufferPointRecord::CacheStatistics s = record->cacheStatistics();
+  cout << label << ": " << s.hits << " hits, " << s.misses << " misses, " << s.evictions << " chunks evicted (" << s.evictedPoints << " points), " << s.bytes / 1024 << " / " << s.budget / 1024 << " kB" << endl;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const time_t start = 1400000000;
+  const time_t day = 24 * 3600;
+  const int nSeries = 200;
+  const size_t budget = 4 * 1024 * 1024;
+  const TimeRange week(start, start + 7 * day - 300);
+
+  BufferPointRecord::_sp record(new BufferPointRecord);
+  record->setMemoryBudget(budget);
+
+  vector<TimeSeries::_sp> series;
+  for (int i = 0; i < nSeries; ++i) {
+    stringstream name;
+    name << "series_" << i;
+    TimeSeries::_sp ts(new TimeSeries);
+    ts->setName(name.str());
+    ts->setUnits(RTX_DIMENSIONLESS);
+    ts->setRecord(record);
+    series.push_back(ts);
+  }
+  printStats("registered", record);
+
+  {
+    cout << "scan:     ";
+    boost::timer::auto_cpu_timer t;
+    for (int i = 0; i < nSeries; ++i) {
+      vector<Point> points;
+      for (time_t time = week.start; time <= week.end; time += 300) {
+        points.push_back(Point(time, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+      }
+      series[i]->insertPoints(points);
+      // keep the first series hot
+      series[0]->points(week);
+    }
+  }
+  printStats("after scan", record);
+
+  record->resetCacheStatistics();
+  size_t hotPoints = record->pointsInRange(series[0]->name(), week.start, week.end).size();
+  size_t coldPoints = record->pointsInRange(series[1]->name(), week.start, week.end).size();
+  printStats("re-read", record);
+  cout << "hot series: " << hotPoints << " points resident; cold series: " << coldPoints << endl;
+
+  BufferPointRecord::CacheStatistics s = record->cacheStatistics();
+  record->reset(series[0]->name());
+  BufferPointRecord::CacheStatistics afterReset = record->cacheStatistics();
+  printStats("hot reset", record);
+  
+  size_t hotBytes = hotPoints * sizeof(Point);
+  bool ok = (s.bytes <= budget && hotPoints == (size_t)(7 * day / 300) && afterReset.bytes + hotBytes <= s.bytes);
+  cout << (ok ? "OK" : "OVER BUDGET, HOT SERIES EVICTED OR STORAGE KEPT AFTER RESET") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+//
+//  coalescing_profiling.cpp
+//  data_access_profiling
+//
+//  several threads ask a slow database record for overlapping ranges of the
+//  same series at once, as when sibling TimeSeries fetch in parallel. reports
+//  how many selects actually reached the database, and checks that every
+//  caller got the same points.
+//
+
+#include <ctime>
+#include <cstdlib>
+#include <atomic>
+#include <iostream>
+#include <vector>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "DbPointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const time_t day = 24 * 3600;
+const int nReaders = 8;
+
+
+// a database with a point every period, and a fixed latency per select.
+class SlowDbPointRecord : public DbPointRecord {
+public:
+  RTX_SHARED_POINTER(SlowDbPointRecord);
+  SlowDbPointRecord(int latencyMs) : selects(0), _latencyMs(latencyMs) {};
+  bool supportsUnitsColumn() { return true; };
+  void truncate() {};
+  std::atomic<int> selects;
+protected:
+  vector<Point> selectRange(const string& id, time_t startTime, time_t endTime) {
+    ++selects;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(_latencyMs));
+    vector<Point> points;
+    for (time_t t = start + ((max(startTime, start) - start + period - 1) / period) * period; t <= endTime; t += period) {
+      points.push_back(Point(t, (double)(t - start) / period, Point::opc_good, 1.));
+    }
+    return points;
+  };
+  Point selectNext(const string& id, time_t time) { return Point(); };
+  Point selectPrevious(const string& id, time_t time) { return Point(); };
+  void insertSingle(const string& id, Point point) {};
+  void insertRange(const string& id, const vector<Point>& points) {};
+  void removeRecord(const string& id) {};
+  bool insertIdentifierAndUnits(const string& id, Units units) { return true; };
+private:
+  int _latencyMs;
+};
+
+
+void readRange(SlowDbPointRecord::_sp record, int i, vector<Point>* out) {
+  // each reader wants the same day, staggered by an hour either side.
+  time_t offset = (i % 3 - 1) * 3600;
+  *out = record->pointsInRange("tank_level", start + day + offset, start + 2 * day + offset);
+}
+
+
+int main(int argc, const char * argv[])
+{
+  SlowDbPointRecord::_sp record(new SlowDbPointRecord(50));
+  record->registerAndGetIdentifierForSeriesWithUnits("tank_level", RTX_METER);
+
+  vector< vector<Point> > results(nReaders);
+  boost::thread_group readers;
+  {
+    cout << nReaders << " overlapping reads: ";
+    boost::timer::auto_cpu_timer t;
+    for (int i = 0; i < nReaders; ++i) {
+      readers.create_thread(boost::bind(&readRange, record, i, &results[i]));
+    }
+    readers.join_all();
+  }
+
+  bool ok = true;
+  for (int i = 0; i < nReaders; ++i) {
+    time_t offset = (i % 3 - 1) * 3600;
+    ok = ok && (results[i].size() == (size_t)(day / period + 1)) && (results[i].front().time == start + day + offset);
+    for (size_t j = 1; j < results[i].size(); ++j) {
+      ok = ok && (results[i][j].time == results[i][j-1].time + period);
+    }
+  }
+  cout << record->selects << " selects for " << nReaders << " readers; " << (ok ? "all complete" : "INCOMPLETE RESULTS") << endl;
+  return ok ? 0 : 1;
+}
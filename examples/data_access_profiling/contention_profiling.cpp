@@ -0,0 +1,119 @@
+//
+//  contention_profiling.cpp
+//  data_access_profiling
+//
+//  reader threads hammering one BufferPointRecord: each on its own series,
+//  all on the same series, and with a writer appending to another series the
+//  whole time (like Model::saveNetworkStates writing results while boundary
+//  conditions are read). reports reads per second against a single reader.
+//
+
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "BufferPointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const int nPoints = 20000;
+const int readsPerThread = 200000;
+
+
+void readSeries(BufferPointRecord::_sp record, string name, unsigned int seed, size_t* found) {
+  size_t n = 0;
+  for (int i = 0; i < readsPerThread; ++i) {
+    time_t t = start + (time_t)(rand_r(&seed) % nPoints) * period;
+    if (i % 8 == 0) {
+      n += record->pointsInRange(name, t, t + 12 * period).size();
+    }
+    else {
+      n += record->point(name, t).isValid ? 1 : 0;
+    }
+  }
+  *found = n;
+}
+
+void writeSeries(BufferPointRecord::_sp record, string name, volatile bool* stop) {
+  time_t t = start;
+  while (!*stop) {
+    vector<Point> batch;
+    for (int i = 0; i < 10; ++i, t += period) {
+      batch.push_back(Point(t, 1., Point::opc_good, 1.));
+    }
+    record->addPoints(name, batch);
+  }
+}
+
+
+double run(BufferPointRecord::_sp record, int nThreads, bool sameSeries, bool withWriter) {
+  vector<size_t> found(nThreads, 0);
+  volatile bool stop = false;
+  boost::thread_group readers;
+  boost::thread* writer = NULL;
+
+  record->reset("results");
+  record->registerAndGetIdentifierForSeriesWithUnits("results", RTX_DIMENSIONLESS);
+  if (withWriter) {
+    writer = new boost::thread(boost::bind(&writeSeries, record, string("results"), &stop));
+  }
+
+  boost::timer::cpu_timer timer;
+  for (int i = 0; i < nThreads; ++i) {
+    stringstream name;
+    name << "series_" << (sameSeries ? 0 : i);
+    readers.create_thread(boost::bind(&readSeries, record, name.str(), (unsigned int)(i + 1), &found[i]));
+  }
+  readers.join_all();
+  double seconds = (double)timer.elapsed().wall / 1e9;
+
+  if (writer) {
+    stop = true;
+    writer->join();
+    delete writer;
+  }
+  return (double)(nThreads * readsPerThread) / seconds;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const int nThreads = 8;
+
+  BufferPointRecord::_sp record(new BufferPointRecord);
+  record->setMemoryBudget(0);
+  for (int s = 0; s < nThreads; ++s) {
+    stringstream name;
+    name << "series_" << s;
+    record->registerAndGetIdentifierForSeriesWithUnits(name.str(), RTX_DIMENSIONLESS);
+    vector<Point> points;
+    for (int i = 0; i < nPoints; ++i) {
+      points.push_back(Point(start + (time_t)i * period, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+    }
+    record->addPoints(name.str(), points);
+  }
+
+  double single = run(record, 1, false, false);
+  cout << "1 reader:                          " << (size_t)single << " reads/s" << endl;
+
+  double distinct = run(record, nThreads, false, false);
+  cout << nThreads << " readers, own series:             " << (size_t)distinct << " reads/s (" << distinct / single << "x)" << endl;
+
+  double same = run(record, nThreads, true, false);
+  cout << nThreads << " readers, same series:            " << (size_t)same << " reads/s (" << same / single << "x)" << endl;
+
+  double writing = run(record, nThreads, false, true);
+  cout << nThreads << " readers, own series, + writer:   " << (size_t)writing << " reads/s (" << writing / single << "x)" << endl;
+
+  BufferPointRecord::CacheStatistics stats = record->cacheStatistics();
+  cout << stats.hits << " hits, " << stats.misses << " misses" << endl;
+  return 0;
+}
@@ -0,0 +1,122 @@
+//
+//  copy_profiling.cpp
+//  data_access_profiling
+//
+//  counts heap traffic for a filter-chain fetch. every allocation is tallied
+//  by a replacement global operator new, and the bytes allocated per stage
+//  are reported in units of "point buffers" (range size x sizeof(Point)).
+//  each stage has to build its own output, so one buffer per stage is the
+//  floor; anything above that is a copy in the plumbing.
+//
+//  exits non-zero if any stage costs more than the allowance below.
+//
+
+#include <ctime>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <boost/foreach.hpp>
+
+#include "TimeSeries.h"
+#include "BufferPointRecord.h"
+#include "OffsetTimeSeries.h"
+#include "GainTimeSeries.h"
+
+using namespace std;
+using namespace RTX;
+
+static size_t _allocCount = 0;
+static size_t _allocBytes = 0;
+
+void* operator new(size_t size) {
+  ++_allocCount;
+  _allocBytes += size;
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const time_t period = 60;
+  const size_t nPoints = 7 * 24 * 60;
+  const time_t start = 1400000000;
+  const TimeRange range(start, start + (time_t)(nPoints - 1) * period);
+  const double allowance = 1.1; // point buffers per stage: its own output, nothing more
+
+  // source series, backed by a buffer record
+  TimeSeries::_sp source(new TimeSeries);
+  source->setRecord(PointRecord::_sp(new BufferPointRecord));
+  source->setName("source");
+  source->setUnits(RTX_DIMENSIONLESS);
+  vector<Point> sourcePoints;
+  sourcePoints.reserve(nPoints);
+  for (size_t i = 0; i < nPoints; ++i) {
+    sourcePoints.push_back(Point(start + (time_t)i * period, (double)(rand() % 10000) / 100.));
+  }
+  source->insertPoints(sourcePoints);
+
+  // a chain of point-by-point filters, no caching records (every fetch recomputes)
+  vector<TimeSeries::_sp> stages;
+  stages.push_back(source);
+  TimeSeries::_sp upstream = source;
+  for (int i = 0; i < 4; ++i) {
+    TimeSeriesFilter::_sp f;
+    if (i % 2 == 0) {
+      OffsetTimeSeries::_sp o(new OffsetTimeSeries);
+      o->setOffset(1.);
+      f = o;
+    }
+    else {
+      GainTimeSeries::_sp g(new GainTimeSeries);
+      g->setGain(2.);
+      f = g;
+    }
+    f->setUnits(RTX_DIMENSIONLESS);
+    f->setSource(upstream);
+    stages.push_back(f);
+    upstream = f;
+  }
+
+  const double bufferBytes = (double)(nPoints * sizeof(Point));
+  bool withinBudget = true;
+  size_t previousBytes = 0;
+
+  cout << "fetching " << nPoints << " points (" << (size_t)bufferBytes << " bytes per buffer)" << endl;
+  for (size_t depth = 0; depth < stages.size(); ++depth) {
+    _allocCount = 0;
+    _allocBytes = 0;
+    vector<Point> fetched = stages[depth]->points(range);
+    size_t bytes = _allocBytes;
+    size_t count = _allocCount;
+
+    if (fetched.size() != nPoints) {
+      cerr << "stage " << depth << " returned " << fetched.size() << " points" << endl;
+      withinBudget = false;
+    }
+
+    // cost of this stage alone, over and above everything upstream of it
+    double stageBuffers = ((double)bytes - (double)previousBytes) / bufferBytes;
+    previousBytes = bytes;
+    cout << "  depth " << depth << ": " << setw(6) << count << " allocations, " << fixed << setprecision(2) << (double)bytes / bufferBytes << " buffers total, " << stageBuffers << " for this stage" << endl;
+    if (depth > 0 && stageBuffers > allowance) {
+      withinBudget = false;
+    }
+  }
+
+  cout << (withinBudget ? "OK" : "OVER BUDGET") << " (allowance " << allowance << " buffers per stage)" << endl;
+  return withinBudget ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+//
+//  evaluation_plan_profiling.cpp
+//  data_access_profiling
+//
+//  counts the reads that reach the root records of a small filter graph,
+//  for a plain sink->points(range) call and for a TimeSeriesEvaluationPlan
+//  over the same range. both should produce identical output. the plan reads
+//  each root once to evaluate; building it still costs the seeks that stages
+//  make to find their ranges (here, the moving average looking for points
+//  just outside its range on the outlier filter).
+//
+//  graph:  raw -> outlier -> moving average ---------------> aggregator
+//                                  \-> multiplier (x pattern) --/
+//
+
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "BufferPointRecord.h"
+#include "OutlierExclusionTimeSeries.h"
+#include "MovingAverage.h"
+#include "MultiplierTimeSeries.h"
+#include "AggregatorTimeSeries.h"
+#include "TimeSeriesEvaluationPlan.h"
+
+using namespace std;
+using namespace RTX;
+
+// a buffer record that tallies every read, standing in for a database.
+class CountingPointRecord : public BufferPointRecord {
+public:
+  RTX_SHARED_POINTER(CountingPointRecord);
+  CountingPointRecord() : rangeReads(0), seekReads(0) {};
+  vector<Point> pointsInRange(handle_t handle, time_t startTime, time_t endTime) {
+    ++rangeReads;
+    return BufferPointRecord::pointsInRange(handle, startTime, endTime);
+  };
+  Point pointBefore(handle_t handle, time_t time) {
+    ++seekReads;
+    return BufferPointRecord::pointBefore(handle, time);
+  };
+  Point pointAfter(handle_t handle, time_t time) {
+    ++seekReads;
+    return BufferPointRecord::pointAfter(handle, time);
+  };
+  void resetCounts() { rangeReads = 0; seekReads = 0; };
+  size_t rangeReads, seekReads;
+};
+
+
+TimeSeries::_sp rootSeries(const string& name, CountingPointRecord::_sp record, time_t start, time_t period, size_t nPoints) {
+  TimeSeries::_sp ts(new TimeSeries);
+  ts->setName(name);
+  ts->setUnits(RTX_DIMENSIONLESS);
+  ts->setRecord(record);
+  vector<Point> points;
+  points.reserve(nPoints);
+  for (size_t i = 0; i < nPoints; ++i) {
+    points.push_back(Point(start + (time_t)i * period, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+  }
+  ts->insertPoints(points);
+  return ts;
+}
+
+bool samePoints(const vector<Point>& a, const vector<Point>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].time != b[i].time || a[i].value != b[i].value || a[i].quality != b[i].quality) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const time_t start = 1400000000;
+  const time_t day = 24 * 3600;
+  CountingPointRecord::_sp rawRecord(new CountingPointRecord);
+  CountingPointRecord::_sp patternRecord(new CountingPointRecord);
+
+  TimeSeries::_sp raw = rootSeries("raw", rawRecord, start - day, 60, 9 * 24 * 60);
+  TimeSeries::_sp pattern = rootSeries("pattern", patternRecord, start - day, 900, 9 * 24 * 4);
+
+  Clock::_sp fiveMinutes(new Clock(300));
+
+  OutlierExclusionTimeSeries::_sp outlier(new OutlierExclusionTimeSeries);
+  outlier->setName("outlier");
+  outlier->setUnits(RTX_DIMENSIONLESS);
+  outlier->setSource(raw);
+  outlier->setWindow(Clock::_sp(new Clock(3600)));
+  outlier->setOutlierMultiplier(2.);
+
+  MovingAverage::_sp smooth(new MovingAverage);
+  smooth->setName("smooth");
+  smooth->setUnits(RTX_DIMENSIONLESS);
+  smooth->setSource(outlier);
+  smooth->setWindowSize(5);
+  smooth->setClock(fiveMinutes);
+
+  MultiplierTimeSeries::_sp scaled(new MultiplierTimeSeries);
+  scaled->setName("scaled");
+  scaled->setUnits(RTX_DIMENSIONLESS);
+  scaled->setSource(smooth);
+  scaled->setMultiplier(pattern);
+  scaled->setClock(fiveMinutes);
+
+  AggregatorTimeSeries::_sp sum(new AggregatorTimeSeries);
+  sum->setName("sum");
+  sum->setUnits(RTX_DIMENSIONLESS);
+  sum->addSource(smooth, 1.);
+  sum->addSource(scaled, -1.);
+  sum->setClock(fiveMinutes);
+
+  const TimeRange range(start, start + 7 * day);
+  vector<Point> naive, planned;
+
+  rawRecord->resetCounts();
+  patternRecord->resetCounts();
+  {
+    cout << "sink->points(range):  ";
+    boost::timer::auto_cpu_timer t;
+    naive = sum->points(range);
+  }
+  cout << "  raw: " << rawRecord->rangeReads << " range reads, " << rawRecord->seekReads << " seeks; pattern: " << patternRecord->rangeReads << " range reads, " << patternRecord->seekReads << " seeks" << endl;
+
+  rawRecord->resetCounts();
+  patternRecord->resetCounts();
+  {
+    cout << "evaluation plan:      ";
+    boost::timer::auto_cpu_timer t;
+    TimeSeriesEvaluationPlan plan(sum, range);
+    cout << "  building: raw: " << rawRecord->rangeReads << " range reads, " << rawRecord->seekReads << " seeks; pattern: " << patternRecord->rangeReads << " range reads, " << patternRecord->seekReads << " seeks" << endl;
+    plan.evaluate();
+    planned = plan.points(sum);
+    cout << plan;
+  }
+  cout << "  raw: " << rawRecord->rangeReads << " range reads, " << rawRecord->seekReads << " seeks; pattern: " << patternRecord->rangeReads << " range reads, " << patternRecord->seekReads << " seeks" << endl;
+
+  bool same = samePoints(naive, planned);
+  cout << naive.size() << " points, " << (same ? "identical" : "MISMATCH") << endl;
+  return same ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+//
+//  handle_profiling.cpp
+//  data_access_profiling
+//
+//  single-point reads from a BufferPointRecord holding many long-named series,
+//  by identifier (a map lookup per call) and by handle (an index). reports reads
+//  per second for each and checks both return the same points.
+//
+
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/timer/timer.hpp>
+
+#include "BufferPointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const int nSeries = 5000;
+const int nPoints = 288;
+const int nReads = 2000000;
+
+
+int main(int argc, const char * argv[])
+{
+  BufferPointRecord::_sp record(new BufferPointRecord);
+  record->setMemoryBudget(0);
+
+  vector<string> names;
+  vector<PointRecord::handle_t> handles;
+  for (int s = 0; s < nSeries; ++s) {
+    stringstream name;
+    name << "network.pressure_zone_" << s / 100 << ".junction_" << s << ".head";
+    names.push_back(name.str());
+    record->registerAndGetIdentifierForSeriesWithUnits(name.str(), RTX_DIMENSIONLESS);
+    handles.push_back(record->handleForIdentifier(name.str()));
+    vector<Point> points;
+    for (int i = 0; i < nPoints; ++i) {
+      points.push_back(Point(start + (time_t)i * period, (double)(s + i), Point::opc_good, 1.));
+    }
+    record->addPoints(handles.back(), points);
+  }
+
+  double byName = 0, byHandle = 0;
+  double seconds;
+  {
+    unsigned int seed = 1;
+    boost::timer::cpu_timer timer;
+    for (int r = 0; r < nReads; ++r) {
+      int s = rand_r(&seed) % nSeries;
+      byName += record->point(names[s], start + (time_t)(rand_r(&seed) % nPoints) * period).value;
+    }
+    seconds = (double)timer.elapsed().wall / 1e9;
+    cout << "by identifier: " << (size_t)(nReads / seconds) << " reads/s" << endl;
+  }
+  {
+    unsigned int seed = 1;
+    boost::timer::cpu_timer timer;
+    for (int r = 0; r < nReads; ++r) {
+      int s = rand_r(&seed) % nSeries;
+      byHandle += record->point(handles[s], start + (time_t)(rand_r(&seed) % nPoints) * period).value;
+    }
+    seconds = (double)timer.elapsed().wall / 1e9;
+    cout << "by handle:     " << (size_t)(nReads / seconds) << " reads/s" << endl;
+  }
+
+  cout << (byName == byHandle ? "identical" : "DIFFERENT") << endl;
+  return byName == byHandle ? 0 : 1;
+}
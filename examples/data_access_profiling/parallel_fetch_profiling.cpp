@@ -0,0 +1,181 @@
+//
+//  parallel_fetch_profiling.cpp
+//  data_access_profiling
+//
+//  an aggregator over many meters, each read from a record with a fixed
+//  round-trip latency (standing in for a database). compares the serial fetch
+//  with the parallel one, and checks that the results are identical. then
+//  the same meters in a database record with its default single reader,
+//  where the meters' roots are loaded in one query before the branches run.
+//
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "BufferPointRecord.h"
+#include "SqlitePointRecord.h"
+#include "AggregatorTimeSeries.h"
+#include "TimeSeriesFetchPool.h"
+
+using namespace std;
+using namespace RTX;
+
+// a buffer record that waits before every read
+class SlowPointRecord : public BufferPointRecord {
+public:
+  RTX_SHARED_POINTER(SlowPointRecord);
+  SlowPointRecord(int latencyMs) : _latencyMs(latencyMs) {};
+  vector<Point> pointsInRange(handle_t handle, time_t startTime, time_t endTime) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(_latencyMs));
+    return BufferPointRecord::pointsInRange(handle, startTime, endTime);
+  };
+  Point pointBefore(handle_t handle, time_t time) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(_latencyMs));
+    return BufferPointRecord::pointBefore(handle, time);
+  };
+  Point pointAfter(handle_t handle, time_t time) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(_latencyMs));
+    return BufferPointRecord::pointAfter(handle, time);
+  };
+private:
+  int _latencyMs;
+};
+
+
+// a sqlite record that waits before every query, and counts them
+class SlowSqlitePointRecord : public SqlitePointRecord {
+public:
+  RTX_SHARED_POINTER(SlowSqlitePointRecord);
+  SlowSqlitePointRecord(int latencyMs) : queries(0), _latencyMs(latencyMs) {};
+  int queries;
+protected:
+  vector<Point> selectRange(const string& id, time_t startTime, time_t endTime) {
+    this->wait();
+    return SqlitePointRecord::selectRange(id, startTime, endTime);
+  };
+  Point selectNext(const string& id, time_t time) {
+    this->wait();
+    return SqlitePointRecord::selectNext(id, time);
+  };
+  Point selectPrevious(const string& id, time_t time) {
+    this->wait();
+    return SqlitePointRecord::selectPrevious(id, time);
+  };
+  map<string, vector<Point> > selectRanges(const vector<string>& ids, time_t startTime, time_t endTime) {
+    this->wait();
+    return SqlitePointRecord::selectRanges(ids, startTime, endTime);
+  };
+private:
+  void wait() {
+    boost::mutex::scoped_lock lock(_countMutex);
+    ++queries;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(_latencyMs));
+  };
+  boost::mutex _countMutex;
+  int _latencyMs;
+};
+
+
+bool samePoints(const vector<Point>& a, const vector<Point>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].time != b[i].time || a[i].value != b[i].value || a[i].quality != b[i].quality || a[i].confidence != b[i].confidence) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const time_t start = 1400000000;
+  const time_t day = 24 * 3600;
+  const int nMeters = 40;
+  const int latencyMs = 20;
+  const int readers = 8;
+
+  SlowPointRecord::_sp record(new SlowPointRecord(latencyMs));
+  record->setMaxConcurrentReads(readers);
+
+  AggregatorTimeSeries::_sp demand(new AggregatorTimeSeries);
+  demand->setUnits(RTX_DIMENSIONLESS);
+  demand->setClock(Clock::_sp(new Clock(300)));
+  vector<TimeSeries::_sp> meters;
+
+  for (int m = 0; m < nMeters; ++m) {
+    stringstream name;
+    name << "meter_" << m;
+    TimeSeries::_sp meter(new TimeSeries);
+    meter->setName(name.str());
+    meter->setUnits(RTX_DIMENSIONLESS);
+    meter->setRecord(record);
+    vector<Point> points;
+    for (time_t t = start - 3600; t < start + 2 * day; t += 60 + rand() % 60) {
+      points.push_back(Point(t, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+    }
+    meter->insertPoints(points);
+    demand->addSource(meter, (m % 5 == 0) ? -1. : 1.);
+    meters.push_back(meter);
+  }
+
+  const TimeRange range(start, start + day);
+  vector<Point> serial, parallel;
+  size_t defaultThreads = TimeSeriesFetchPool::maxThreads();
+
+  cout << nMeters << " meters, " << latencyMs << "ms per read" << endl;
+  TimeSeriesFetchPool::setMaxThreads(1);
+  {
+    cout << "serial:                ";
+    boost::timer::auto_cpu_timer t;
+    serial = demand->points(range);
+  }
+  TimeSeriesFetchPool::setMaxThreads(defaultThreads > (size_t)readers ? defaultThreads : (size_t)readers);
+  {
+    cout << "parallel, " << readers << " readers:   ";
+    boost::timer::auto_cpu_timer t;
+    parallel = demand->points(range);
+  }
+
+  bool same = samePoints(serial, parallel);
+  cout << serial.size() << " points, " << (same ? "identical" : "MISMATCH") << endl;
+
+  // the same meters in a database record, limited to one reader as database records are by default
+  const string path = "parallel_fetch_profiling.sqlite";
+  remove(path.c_str());
+  {
+    SqlitePointRecord::_sp writer(new SqlitePointRecord);
+    writer->setConnectionString(path);
+    writer->dbConnect();
+    BOOST_FOREACH(TimeSeries::_sp meter, meters) {
+      writer->registerAndGetIdentifierForSeriesWithUnits(meter->name(), RTX_DIMENSIONLESS);
+      writer->addPoints(meter->name(), meter->points(TimeRange(start - 3600, start + 2 * day)));
+    }
+  }
+  SlowSqlitePointRecord::_sp db(new SlowSqlitePointRecord(latencyMs));
+  db->setConnectionString(path);
+  db->dbConnect();
+  BOOST_FOREACH(TimeSeries::_sp meter, meters) {
+    meter->setRecord(db); // cold cache: everything comes from the file
+  }
+  vector<Point> fromDb;
+  {
+    cout << "database, " << db->maxConcurrentReads() << " reader:    ";
+    boost::timer::auto_cpu_timer t;
+    fromDb = demand->points(range);
+  }
+  remove(path.c_str());
+  bool sameDb = samePoints(serial, fromDb);
+  cout << db->queries << " queries, " << fromDb.size() << " points, " << (sameDb ? "identical" : "MISMATCH") << endl;
+  return (same && sameDb) ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+//
+//  percentile_profiling.cpp
+//  data_access_profiling
+//
+//  compares the selection-based PointCollection percentile against the
+//  boost tail_quantile accumulator it replaced, for the window sizes the
+//  stats / outlier filters typically see. then checks percentiles that are
+//  not one of the presets: through StatsTimeSeries with an arbitrary
+//  percentile (as ModelPerformance uses it), and from a summary that was
+//  not asked for them.
+//
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <boost/foreach.hpp>
+#include <boost/timer/timer.hpp>
+
+#include <boost/accumulators/accumulators.hpp>
+#include <boost/accumulators/statistics.hpp>
+#include <boost/accumulators/statistics/tail_quantile.hpp>
+
+#include "TimeSeries.h"
+#include "StatsTimeSeries.h"
+#include "BufferPointRecord.h"
+
+using namespace std;
+using namespace RTX;
+using namespace boost::accumulators;
+
+// the previous implementation, verbatim.
+double accumulatorPercentile(TimeSeries::PointCollection& pc, double p) {
+  int cacheSize = (int)pc.points.size();
+  if (cacheSize == 1 && p == 0.5) {
+    return pc.points.front().value;
+  }
+  if (p <= 0.5) {
+    accumulator_set<double, stats<tag::tail_quantile<boost::accumulators::left> > > centile( tag::tail<boost::accumulators::left>::cache_size = cacheSize );
+    BOOST_FOREACH(const Point& point, pc.points) {
+      centile(point.value);
+    }
+    return quantile(centile, quantile_probability = p);
+  }
+  else {
+    accumulator_set<double, stats<tag::tail_quantile<boost::accumulators::right> > > centile( tag::tail<boost::accumulators::right>::cache_size = cacheSize );
+    BOOST_FOREACH(const Point& point, pc.points) {
+      centile(point.value);
+    }
+    return quantile(centile, quantile_probability = p);
+  }
+}
+
+TimeSeries::PointCollection randomCollection(size_t nPoints) {
+  vector<Point> points;
+  points.reserve(nPoints);
+  time_t start = time(NULL);
+  for (size_t i = 0; i < nPoints; ++i) {
+    points.push_back(Point(start + i*60, (double)(rand() % 10000) / 100.));
+  }
+  return TimeSeries::PointCollection(points, RTX_DIMENSIONLESS);
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const size_t windowSizes[] = {15, 60, 1440, 10080};
+  const size_t totalPoints = 2000000; // per window size, spread across repetitions
+
+  BOOST_FOREACH(size_t windowSize, windowSizes) {
+    TimeSeries::PointCollection pc = randomCollection(windowSize);
+    const size_t reps = totalPoints / windowSize;
+    double sink = 0;
+
+    // correctness first
+    vector<double> quartiles;
+    quartiles.push_back(.25);
+    quartiles.push_back(.75);
+    vector<double> selected = pc.percentiles(quartiles);
+    if (selected[0] != accumulatorPercentile(pc, .25) || selected[1] != accumulatorPercentile(pc, .75)) {
+      cerr << "MISMATCH at window size " << windowSize << endl;
+    }
+
+    cout << "window of " << windowSize << " points, " << reps << " repetitions (q25 + q75)" << endl;
+    {
+      cout << "  boost tail_quantile accumulator: ";
+      boost::timer::auto_cpu_timer t;
+      for (size_t i = 0; i < reps; ++i) {
+        sink += accumulatorPercentile(pc, .25);
+        sink += accumulatorPercentile(pc, .75);
+      }
+    }
+    {
+      cout << "  nth_element, two calls:          ";
+      boost::timer::auto_cpu_timer t;
+      for (size_t i = 0; i < reps; ++i) {
+        sink += pc.percentile(.25);
+        sink += pc.percentile(.75);
+      }
+    }
+    {
+      cout << "  nth_element, one partition:      ";
+      boost::timer::auto_cpu_timer t;
+      for (size_t i = 0; i < reps; ++i) {
+        vector<double> q = pc.percentiles(quartiles);
+        sink += q[0] + q[1];
+      }
+    }
+    cout << "  (checksum " << sink << ")" << endl;
+  }
+
+  // arbitrary percentiles over a moving window, against the previous implementation on each window.
+  // source points sit between the minutes, so no window boundary lands on one.
+  const time_t start = 1399996800, hour = 3600;
+  TimeSeries::_sp source(new TimeSeries);
+  source->setUnits(RTX_DIMENSIONLESS);
+  source->setName("source");
+  source->setRecord(PointRecord::_sp(new BufferPointRecord));
+  vector<Point> sourcePoints;
+  for (time_t t = start + 30; t < start + 48 * hour; t += 60) {
+    sourcePoints.push_back(Point(t, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+  }
+  source->insertPoints(sourcePoints);
+
+  StatsTimeSeries::_sp stats(new StatsTimeSeries);
+  stats->setSource(source);
+  stats->setClock(Clock::_sp(new Clock(hour)));
+  stats->setWindow(Clock::_sp(new Clock(6 * hour)));
+  stats->setStatsType(StatsTimeSeries::StatsTimeSeriesPercentile);
+
+  bool ok = true;
+  const double arbitrary[] = {.9, .37, .995, .01};
+  BOOST_FOREACH(double p, arbitrary) {
+    stats->setArbitraryPercentile(p);
+    vector<Point> computed = stats->points(TimeRange(start + 6 * hour, start + 47 * hour));
+    size_t nMatched = 0;
+    BOOST_FOREACH(const Point& point, computed) {
+      TimeSeries::PointCollection window = source->pointCollection(TimeRange(point.time - 6 * hour, point.time));
+      if (point.value == accumulatorPercentile(window, p)) {
+        ++nMatched;
+      }
+    }
+    cout << "StatsTimeSeries percentile " << p << ": " << nMatched << " / " << computed.size() << " windows match" << endl;
+    ok = ok && !computed.empty() && nMatched == computed.size();
+  }
+
+  // a quantile the summary was not asked for lies between its neighbours, instead of being NaN.
+  TimeSeries::PointCollection pc = randomCollection(1440);
+  vector<double> quartiles;
+  quartiles.push_back(.25);
+  quartiles.push_back(.75);
+  TimeSeries::PointCollection::Summary s = pc.summary(quartiles);
+  const double unasked[] = {.1, .5, .9};
+  BOOST_FOREACH(double p, unasked) {
+    double q = s.quantile(p);
+    double below = (p < .25) ? s.min : (p < .75) ? s.quantile(.25) : s.quantile(.75);
+    double above = (p < .25) ? s.quantile(.25) : (p < .75) ? s.quantile(.75) : s.max;
+    bool bounded = (below <= q && q <= above);
+    cout << "summary quantile " << p << " (not selected): " << q << (bounded ? "" : "  OUT OF BOUNDS") << endl;
+    ok = ok && bounded;
+  }
+
+  return ok ? 0 : 1;
+}
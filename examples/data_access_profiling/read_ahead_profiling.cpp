@@ -0,0 +1,123 @@
+//
+//  read_ahead_profiling.cpp
+//  data_access_profiling
+//
+//  a simulation-style loop over a slow database record: at each step read the
+//  value at or before the clock for every input, then "solve" for a while. run
+//  once reading on demand and once with a TimeSeriesReadAhead following the
+//  clock. reports time spent waiting on reads and checks the values match.
+//
+
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "DbPointRecord.h"
+#include "TimeSeriesReadAhead.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const time_t step = 3600;
+const time_t day = 24 * 3600;
+const int nSeries = 10;
+const int latencyMs = 20;
+const int solveMs = 10;
+
+
+// a database with a point every period, and a fixed latency per query.
+class SlowDbPointRecord : public DbPointRecord {
+public:
+  RTX_SHARED_POINTER(SlowDbPointRecord);
+  SlowDbPointRecord() {};
+  bool supportsUnitsColumn() { return true; };
+  void truncate() {};
+protected:
+  vector<Point> selectRange(const string& id, time_t startTime, time_t endTime) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(latencyMs));
+    return pointsBetween(startTime, endTime);
+  };
+  map<string, vector<Point> > selectRanges(const vector<string>& ids, time_t startTime, time_t endTime) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(latencyMs)); // one query for the lot
+    map<string, vector<Point> > selected;
+    BOOST_FOREACH(const string& id, ids) {
+      selected[id] = pointsBetween(startTime, endTime);
+    }
+    return selected;
+  };
+  Point selectNext(const string& id, time_t time) { return Point(); };
+  Point selectPrevious(const string& id, time_t time) { return Point(); };
+  void insertSingle(const string& id, Point point) {};
+  void insertRange(const string& id, const vector<Point>& points) {};
+  void removeRecord(const string& id) {};
+  bool insertIdentifierAndUnits(const string& id, Units units) { return true; };
+private:
+  vector<Point> pointsBetween(time_t startTime, time_t endTime) {
+    vector<Point> points;
+    for (time_t t = start + ((max(startTime, start) - start + period - 1) / period) * period; t <= endTime; t += period) {
+      points.push_back(Point(t, (double)(t - start) / period, Point::opc_good, 1.));
+    }
+    return points;
+  };
+};
+
+
+vector<TimeSeries::_sp> makeInputs() {
+  SlowDbPointRecord::_sp record(new SlowDbPointRecord);
+  vector<TimeSeries::_sp> inputs;
+  for (int i = 0; i < nSeries; ++i) {
+    stringstream name;
+    name << "boundary_" << i;
+    TimeSeries::_sp ts(new TimeSeries);
+    ts->setName(name.str());
+    ts->setRecord(record);
+    inputs.push_back(ts);
+  }
+  return inputs;
+}
+
+// returns the sum of everything read; waited is the time spent reading.
+double simulate(const vector<TimeSeries::_sp>& inputs, TimeSeriesReadAhead* readAhead, double& waited) {
+  double sum = 0;
+  waited = 0;
+  for (time_t t = start + day; t < start + 2 * day; t += step) {
+    if (readAhead) {
+      readAhead->advanceTo(t);
+    }
+    boost::timer::cpu_timer timer;
+    BOOST_FOREACH(TimeSeries::_sp ts, inputs) {
+      sum += ts->pointAtOrBefore(t).value;
+    }
+    waited += (double)timer.elapsed().wall / 1e9;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(solveMs));
+  }
+  return sum;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  double waitedOnDemand, waitedReadAhead;
+  double onDemand, withReadAhead;
+  {
+    vector<TimeSeries::_sp> inputs = makeInputs();
+    onDemand = simulate(inputs, NULL, waitedOnDemand);
+  }
+  {
+    vector<TimeSeries::_sp> inputs = makeInputs();
+    TimeSeriesReadAhead readAhead(inputs, 12 * 3600);
+    withReadAhead = simulate(inputs, &readAhead, waitedReadAhead);
+  }
+
+  cout << "waiting on reads, on demand:  " << waitedOnDemand << " s" << endl;
+  cout << "waiting on reads, read-ahead: " << waitedReadAhead << " s" << endl;
+  cout << (onDemand == withReadAhead ? "identical" : "DIFFERENT") << endl;
+  return onDemand == withReadAhead ? 0 : 1;
+}
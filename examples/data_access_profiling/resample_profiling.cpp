@@ -0,0 +1,147 @@
+//
+//  resample_profiling.cpp
+//  data_access_profiling
+//
+//  compares the PointCollection resampling sweep against the point-by-point
+//  implementation it replaced, for up-, down- and same-rate regular clocks,
+//  in both linear and step mode.
+//
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <boost/foreach.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+
+using namespace std;
+using namespace RTX;
+
+// the previous implementation, verbatim.
+vector<Point> pointwiseResample(const vector<Point>& source, const TimeGrid& timeList, TimeSeries::TimeSeriesResampleMode mode) {
+  typedef std::vector<Point>::const_iterator pVec_cIt;
+  vector<Point> resampled;
+  if (timeList.empty() || source.empty()) {
+    return resampled;
+  }
+  resampled.reserve(timeList.size());
+
+  pVec_cIt sourceEnd = source.end();
+  pVec_cIt right = source.begin();
+  pVec_cIt left = source.begin();
+  ++right;
+
+  BOOST_FOREACH(const time_t now, timeList) {
+    if (now < left->time) {
+      continue;
+    }
+    while (right != sourceEnd && right->time <= now) {
+      ++left;
+      ++right;
+    }
+    Point p;
+    if (mode == TimeSeries::TimeSeriesResampleModeLinear) {
+      if (right != sourceEnd) {
+        p = Point::linearInterpolate(*left, *right, now);
+        resampled.push_back(p);
+      }
+      else {
+        if (left->time == now) {
+          p = *left;
+          resampled.push_back(p);
+        }
+        break;
+      }
+    }
+    else if (mode == TimeSeries::TimeSeriesResampleModeStep) {
+      p = *left;
+      p.time = now;
+      resampled.push_back(p);
+    }
+  }
+  return resampled;
+}
+
+vector<Point> randomPoints(time_t start, time_t period, size_t nPoints) {
+  vector<Point> points;
+  points.reserve(nPoints);
+  for (size_t i = 0; i < nPoints; ++i) {
+    // a little jitter, so source points rarely land on the output clock
+    time_t jitter = (period > 1) ? rand() % (period / 2) : 0;
+    points.push_back(Point(start + i*period + jitter, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+  }
+  return points;
+}
+
+bool samePoints(const vector<Point>& a, const vector<Point>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].time != b[i].time || a[i].value != b[i].value || a[i].quality != b[i].quality || a[i].confidence != b[i].confidence || a[i].isValid != b[i].isValid) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const time_t start = 1400000000;
+  const time_t week = 7 * 24 * 3600;
+  // (source period, output clock period)
+  const time_t cases[][2] = { {900, 60}, {60, 900}, {300, 300} };
+  const char* modeNames[] = {"linear", "step"};
+  const size_t work = 5000000; // points in plus points out, per case: small cases repeat more, so they time above the noise
+
+  BOOST_FOREACH(const time_t* c, cases) {
+    vector<Point> source = randomPoints(start, c[0], (size_t)(week / c[0]));
+    TimeSeries::PointCollection pc(source, RTX_DIMENSIONLESS);
+    TimeGrid grid(start, c[1], (size_t)(week / c[1]));
+    const size_t reps = work / (source.size() + grid.size());
+
+    for (int m = 0; m < 2; ++m) {
+      TimeSeries::TimeSeriesResampleMode mode = (m == 0) ? TimeSeries::TimeSeriesResampleModeLinear : TimeSeries::TimeSeriesResampleModeStep;
+      vector<Point> out;
+      double sink = 0;
+
+      // correctness first
+      pc.resampleInto(grid, out, mode);
+      if (!samePoints(out, pointwiseResample(source, grid, mode))) {
+        cerr << "MISMATCH for source period " << c[0] << ", clock period " << c[1] << ", mode " << modeNames[m] << endl;
+      }
+
+      cout << source.size() << " points every " << c[0] << "s onto a " << c[1] << "s clock (" << grid.size() << " ticks), " << modeNames[m] << ", " << reps << " repetitions" << endl;
+      {
+        cout << "  point-by-point:         ";
+        boost::timer::auto_cpu_timer t;
+        for (size_t i = 0; i < reps; ++i) {
+          vector<Point> r = pointwiseResample(source, grid, mode);
+          sink += r.back().value;
+        }
+      }
+      {
+        cout << "  sweep, fresh buffer:    ";
+        boost::timer::auto_cpu_timer t;
+        for (size_t i = 0; i < reps; ++i) {
+          TimeSeries::PointCollection r = pc.resampledAtTimes(grid, mode);
+          sink += r.points.back().value;
+        }
+      }
+      {
+        cout << "  sweep, reused buffer:   ";
+        boost::timer::auto_cpu_timer t;
+        for (size_t i = 0; i < reps; ++i) {
+          pc.resampleInto(grid, out, mode);
+          sink += out.back().value;
+        }
+      }
+      cout << "  (checksum " << sink << ")" << endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+//
+//  sqlite_chunk_profiling.cpp
+//  data_access_profiling
+//
+//  a long archive of simulation results in a SQLite record, stored a row per
+//  point and in compressed chunks (storage=chunks). reports the file size, the
+//  time to write it, to read every series back, and to read one hour of each a
+//  day at a time, and checks both stores give back exactly what was written.
+//
+//  then a week is written a step at a time, one addPoint per series inside a
+//  bulk operation, as a simulation saves its results. a second connection,
+//  opened while the writer is still open, must see every step that has ended.
+//
+//  a last pass writes a row-per-point file and opens it with storage=chunks, to
+//  time the migration.
+//
+
+#include <ctime>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "SqlitePointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const time_t hour = 3600;
+const time_t day = 24 * hour;
+const int nDays = 90;
+const int nSeries = 50;
+
+
+string seriesName(int i) {
+  stringstream name;
+  name << "tank_" << i << "_level";
+  return name.str();
+}
+
+// a daily cycle, as a tank level would follow, reported to the centimeter.
+vector<Point> seriesPoints(int i) {
+  vector<Point> points;
+  for (time_t t = start; t < start + nDays * day; t += period) {
+    double level = 5. + 2. * sin(2. * M_PI * (double)(t - start) / (double)day + i) + (double)(rand() % 10) / 100.;
+    points.push_back(Point(t, round(level * 100.) / 100., Point::opc_good, 1.));
+  }
+  return points;
+}
+
+SqlitePointRecord::_sp openRecord(const string& connection) {
+  SqlitePointRecord::_sp record(new SqlitePointRecord);
+  record->setConnectionString(connection);
+  record->dbConnect();
+  for (int i = 0; i < nSeries; ++i) {
+    record->registerAndGetIdentifierForSeriesWithUnits(seriesName(i), RTX_METER);
+  }
+  return record;
+}
+
+double seconds(boost::timer::cpu_timer& timer) {
+  return (double)timer.elapsed().wall / 1e9;
+}
+
+long fileSize(const string& path) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return 0;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+bool samePoints(const vector<Point>& a, const vector<Point>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].time != b[i].time || a[i].value != b[i].value || a[i].quality != b[i].quality || a[i].confidence != b[i].confidence) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool profile(const string& path, const string& options, const vector<vector<Point> >& archive) {
+  remove(path.c_str());
+  boost::timer::cpu_timer timer;
+  {
+    SqlitePointRecord::_sp record = openRecord(path + options);
+    timer.start();
+    for (int i = 0; i < nSeries; ++i) {
+      record->addPoints(seriesName(i), archive[i]);
+    }
+  }
+  double written = seconds(timer);
+
+  // a new connection for each pass, so nothing comes from the record's cache.
+  bool same = true;
+  size_t count = 0;
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    timer.start();
+    for (int i = 0; i < nSeries; ++i) {
+      vector<Point> back = record->pointsInRange(seriesName(i), start, start + nDays * day);
+      same = same && samePoints(back, archive[i]);
+    }
+  }
+  double readAll = seconds(timer);
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    timer.start();
+    for (int i = 0; i < nSeries; ++i) {
+      for (time_t t = start + 12 * hour; t < start + nDays * day; t += day) {
+        count += record->pointsInRange(seriesName(i), t, t + hour - 1).size();
+      }
+    }
+  }
+  double readHours = seconds(timer);
+
+  cout << (options.empty() ? "rows" : options) << ": " << fileSize(path) / 1024 << " KiB, write " << written << " s, read all " << readAll << " s, " << nDays << " one-hour selects each " << readHours << " s; " << (same && count == (size_t)(nSeries * nDays * hour / period) ? "read back identical" : "read back DIFFERENT") << endl;
+  remove(path.c_str());
+  return same;
+}
+
+bool profileSteps(const string& path, const string& options, const vector<vector<Point> >& archive) {
+  const size_t nSteps = (size_t)(7 * day / period);
+  remove(path.c_str());
+  boost::timer::cpu_timer timer;
+  double written;
+  size_t visible;
+  {
+    SqlitePointRecord::_sp record = openRecord(path + options);
+    timer.start();
+    for (size_t step = 0; step < nSteps; ++step) {
+      record->beginBulkOperation();
+      for (int i = 0; i < nSeries; ++i) {
+        record->addPoint(seriesName(i), archive[i][step]);
+      }
+      record->endBulkOperation();
+    }
+    written = seconds(timer);
+    SqlitePointRecord::_sp reader = openRecord(path);
+    visible = reader->pointsInRange(seriesName(nSeries - 1), start, start + 7 * day).size();
+  }
+  
+  bool same = true;
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    for (int i = 0; i < nSeries; ++i) {
+      vector<Point> week(archive[i].begin(), archive[i].begin() + nSteps);
+      same = samePoints(record->pointsInRange(seriesName(i), start, start + 7 * day), week) && same;
+    }
+  }
+  
+  cout << (options.empty() ? "rows" : options) << ": " << nSteps << " steps of " << nSeries << " points written in " << written << " s, " << visible << " visible to another connection; " << (same ? "read back identical" : "read back DIFFERENT") << endl;
+  remove(path.c_str());
+  return same && visible == nSteps;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const string path = "sqlite_chunk_profiling.sqlite";
+  vector<vector<Point> > archive;
+  for (int i = 0; i < nSeries; ++i) {
+    archive.push_back(seriesPoints(i));
+  }
+  cout << nSeries << " series of " << archive.front().size() << " points" << endl;
+
+  bool good = profile(path, "", archive);
+  good = profile(path, "?storage=chunks", archive) && good;
+  good = profileSteps(path, "", archive) && good;
+  good = profileSteps(path, "?storage=chunks", archive) && good;
+
+  // migrate a row-per-point file
+  remove(path.c_str());
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    for (int i = 0; i < nSeries; ++i) {
+      record->addPoints(seriesName(i), archive[i]);
+    }
+  }
+  boost::timer::cpu_timer timer;
+  SqlitePointRecord::_sp record = openRecord(path + "?storage=chunks");
+  cout << "migrated to chunks in " << seconds(timer) << " s: " << fileSize(path) / 1024 << " KiB" << endl;
+  for (int i = 0; i < nSeries; ++i) {
+    good = samePoints(record->pointsInRange(seriesName(i), start, start + nDays * day), archive[i]) && good;
+  }
+  record.reset();
+  remove(path.c_str());
+
+  return good ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+//
+//  sqlite_concurrency_profiling.cpp
+//  data_access_profiling
+//
+//  one connection writes a long run of simulation results in a single bulk
+//  insert, while another connection to the same file keeps reading, as a
+//  dashboard would. run with the default rollback journal and with WAL. reports
+//  how many reads started while the write was in progress, and the longest
+//  any one of them took.
+//
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "SqlitePointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const time_t hour = 3600;
+const time_t day = 24 * hour;
+const int nSeries = 50;
+const int nWritten = 400000;
+const string path = "sqlite_concurrency_profiling.sqlite";
+
+
+string seriesName(int i) {
+  stringstream name;
+  name << "sensor_" << i;
+  return name.str();
+}
+
+SqlitePointRecord::_sp openRecord(const string& options) {
+  SqlitePointRecord::_sp record(new SqlitePointRecord);
+  record->setConnectionString(path + options);
+  record->dbConnect();
+  return record;
+}
+
+void writeResults(SqlitePointRecord::_sp record, boost::atomic<bool>* writing) {
+  vector<Point> points;
+  for (int i = 0; i < nWritten; ++i) {
+    points.push_back(Point(start + i * 60, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+  }
+  *writing = true;
+  record->addPoints("simulation_results", points);
+  *writing = false;
+}
+
+void profile(const string& options) {
+  remove(path.c_str());
+  {
+    SqlitePointRecord::_sp record = openRecord(options);
+    for (int i = 0; i < nSeries; ++i) {
+      record->registerAndGetIdentifierForSeriesWithUnits(seriesName(i), RTX_DIMENSIONLESS);
+      vector<Point> points;
+      for (time_t t = start; t < start + 2 * day; t += period) {
+        points.push_back(Point(t, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+      }
+      record->addPoints(seriesName(i), points);
+    }
+    record->registerAndGetIdentifierForSeriesWithUnits("simulation_results", RTX_DIMENSIONLESS);
+  }
+
+  SqlitePointRecord::_sp writer = openRecord(options);
+  SqlitePointRecord::_sp reader = openRecord(options);
+
+  boost::atomic<bool> writing(false);
+  boost::timer::cpu_timer writeTimer;
+  boost::thread writerThread(writeResults, writer, &writing);
+
+  int reads = 0, readsDuringWrite = 0;
+  double longestWait = 0;
+  while (!writerThread.timed_join(boost::posix_time::milliseconds(0))) {
+    // a different hour of a different series each time, so every read goes to the file.
+    string name = seriesName(reads % nSeries);
+    time_t from = start + ((reads / nSeries) % 48) * hour;
+    if (reads > 0 && reads % (nSeries * 48) == 0) {
+      reader->reset();
+    }
+    bool duringWrite = writing;
+    boost::timer::cpu_timer timer;
+    reader->pointsInRange(name, from, from + hour - 1);
+    double waited = (double)timer.elapsed().wall / 1e9;
+    ++reads;
+    if (duringWrite) {
+      ++readsDuringWrite;
+      longestWait = max(longestWait, waited);
+    }
+  }
+
+  cout << (options.empty() ? "(default)" : options) << ": write took " << (double)writeTimer.elapsed().wall / 1e9 << " s; " << readsDuringWrite << " reads during the write, longest " << longestWait << " s" << endl;
+  writer.reset();
+  reader.reset();
+  remove(path.c_str());
+  remove((path + "-wal").c_str());
+  remove((path + "-shm").c_str());
+}
+
+
+int main(int argc, const char * argv[])
+{
+  profile("?busy_timeout=60000");
+  profile("?busy_timeout=60000&journal_mode=WAL&synchronous=NORMAL");
+  return 0;
+}
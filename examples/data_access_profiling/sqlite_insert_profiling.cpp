@@ -0,0 +1,106 @@
+//
+//  sqlite_insert_profiling.cpp
+//  data_access_profiling
+//
+//  simulation results written to a SQLite record two ways: a series at a time,
+//  as one addPoints (insertRange) per element; and a step at a time, one
+//  addPoint per element inside a bulk operation, as Model::saveNetworkStates
+//  does. reports wall time and points per second for each, then reads
+//  everything back through a new connection to check it all arrived.
+//
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/foreach.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "SqlitePointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 60;
+const time_t day = 24 * 3600;
+const int nSeries = 200;
+
+
+string seriesName(int i) {
+  stringstream name;
+  name << "junction_" << i << "_head";
+  return name.str();
+}
+
+SqlitePointRecord::_sp openRecord(const string& path) {
+  SqlitePointRecord::_sp record(new SqlitePointRecord);
+  record->setConnectionString(path);
+  record->dbConnect();
+  for (int i = 0; i < nSeries; ++i) {
+    record->registerAndGetIdentifierForSeriesWithUnits(seriesName(i), RTX_METER);
+  }
+  return record;
+}
+
+
+bool writeAndReadBack(const string& path, const vector<Point>& points, bool byStep) {
+  remove(path.c_str());
+  
+  size_t written = 0;
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    boost::timer::cpu_timer timer;
+    if (byStep) {
+      BOOST_FOREACH(const Point& p, points) {
+        record->beginBulkOperation();
+        for (int i = 0; i < nSeries; ++i) {
+          record->addPoint(seriesName(i), p);
+          ++written;
+        }
+        record->endBulkOperation();
+      }
+    }
+    else {
+      for (int i = 0; i < nSeries; ++i) {
+        record->addPoints(seriesName(i), points);
+        written += points.size();
+      }
+    }
+    double seconds = (double)timer.elapsed().wall / 1e9;
+    cout << (byStep ? "by step:   " : "by series: ") << "wrote " << written << " points in " << seconds << " s (" << (size_t)(written / seconds) << " points/s)" << endl;
+  }
+
+  size_t read = 0;
+  bool same = true;
+  {
+    SqlitePointRecord::_sp record = openRecord(path);
+    for (int i = 0; i < nSeries; ++i) {
+      vector<Point> back = record->pointsInRange(seriesName(i), start, start + day);
+      read += back.size();
+      same = same && back.size() == points.size() && back.back().value == points.back().value;
+    }
+  }
+
+  remove(path.c_str());
+  cout << "           read back " << read << " points: " << (same && read == written ? "identical" : "DIFFERENT") << endl;
+  return same && read == written;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const string path = "sqlite_insert_profiling.sqlite";
+  
+  vector<Point> points;
+  for (time_t t = start; t < start + day; t += period) {
+    points.push_back(Point(t, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+  }
+  
+  bool bySeries = writeAndReadBack(path, points, false);
+  bool byStep = writeAndReadBack(path, points, true);
+  return (bySeries && byStep) ? 0 : 1;
+}
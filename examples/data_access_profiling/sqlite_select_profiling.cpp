@@ -0,0 +1,111 @@
+//
+//  sqlite_select_profiling.cpp
+//  data_access_profiling
+//
+//  the small, frequent queries a simulation makes of a SQLite record: register
+//  each series, find its range, read it an hour at a time, and look back past a
+//  long gap for the points either side. each costs a statement prepare if
+//  statements aren't kept, and a name lookup in meta if selects join on name; a
+//  search across the gap costs one query per day searched if it isn't a single
+//  seek. reports wall time for each kind of query.
+//
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <boost/timer/timer.hpp>
+
+#include "TimeSeries.h"
+#include "SqlitePointRecord.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t period = 300;
+const time_t hour = 3600;
+const time_t day = 24 * hour;
+const int nSeries = 200;
+const int gapDays = 60;
+
+
+string seriesName(int i) {
+  stringstream name;
+  name << "sensor_" << i;
+  return name.str();
+}
+
+SqlitePointRecord::_sp openRecord(const string& path) {
+  SqlitePointRecord::_sp record(new SqlitePointRecord);
+  record->setConnectionString(path);
+  record->dbConnect();
+  return record;
+}
+
+double seconds(boost::timer::cpu_timer& timer) {
+  return (double)timer.elapsed().wall / 1e9;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  const string path = "sqlite_select_profiling.sqlite";
+  remove(path.c_str());
+  {
+    // two days of points, then a long gap, then one more day.
+    SqlitePointRecord::_sp record = openRecord(path);
+    for (int i = 0; i < nSeries; ++i) {
+      record->registerAndGetIdentifierForSeriesWithUnits(seriesName(i), RTX_DIMENSIONLESS);
+      vector<Point> points;
+      for (time_t t = start; t < start + (gapDays + 3) * day; t += period) {
+        if (t < start + 2 * day || t >= start + (gapDays + 2) * day) {
+          points.push_back(Point(t, (double)(rand() % 10000) / 100., Point::opc_good, 1.));
+        }
+      }
+      record->addPoints(seriesName(i), points);
+    }
+  }
+
+  SqlitePointRecord::_sp record = openRecord(path);
+  size_t count = 0;
+
+  boost::timer::cpu_timer timer;
+  for (int i = 0; i < nSeries; ++i) {
+    record->registerAndGetIdentifierForSeriesWithUnits(seriesName(i), RTX_DIMENSIONLESS);
+  }
+  cout << "register " << nSeries << " series:       " << seconds(timer) << " s" << endl;
+
+  timer.start();
+  for (int i = 0; i < nSeries; ++i) {
+    PointRecord::time_pair_t range = record->range(seriesName(i));
+    count += (range.second - range.first) / period;
+  }
+  cout << "range of each:              " << seconds(timer) << " s" << endl;
+
+  timer.start();
+  for (int i = 0; i < nSeries; ++i) {
+    for (time_t t = start + day; t < start + 2 * day; t += hour) {
+      count += record->pointsInRange(seriesName(i), t, t + hour - 1).size();
+    }
+  }
+  cout << "24 one-hour selects each:   " << seconds(timer) << " s" << endl;
+
+  timer.start();
+  for (int i = 0; i < nSeries; ++i) {
+    count += record->pointBefore(seriesName(i), start + (gapDays + 2) * day).isValid;
+  }
+  cout << "point before a gap, each:   " << seconds(timer) << " s" << endl;
+
+  timer.start();
+  for (int i = 0; i < nSeries; ++i) {
+    count += record->pointAfter(seriesName(i), start + 2 * day).isValid;
+  }
+  cout << "point after a gap, each:    " << seconds(timer) << " s" << endl;
+
+  remove(path.c_str());
+  cout << "(" << count << ")" << endl;
+  return 0;
+}
@@ -0,0 +1,89 @@
+//
+//  state_queue_profiling.cpp
+//  data_access_profiling
+//
+//  a solver and a state writer passing frames through NetworkStateFrames, as
+//  Model::runExtendedPeriod does. the writer is usually quick but stalls now and
+//  then (a database checkpoint, say). run with a two-frame ring (one step in
+//  flight) and a deeper ring, and report how long the solver waited on the writer,
+//  the deepest queue and the largest writer lag, and check every step was saved
+//  in order.
+//
+
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "NetworkStateFrames.h"
+
+using namespace std;
+using namespace RTX;
+
+const time_t start = 1400000000;
+const time_t step = 300;
+const int nSteps = 200;
+const int nJunctions = 10000;
+const int solveMs = 10;
+const int saveMs = 2;
+const int stallMs = 60;
+const int stallEvery = 8;
+
+
+// saves frames in order; good is false if a step is missing, repeated, or wrong.
+void writer(NetworkStateFrames* frames, bool* good) {
+  NetworkStateFrames::Frame* frame;
+  time_t expected = start;
+  int saved = 0;
+  while (frames->nextQueuedFrame(frame)) {
+    const vector<double>& head = frame->values(0, NetworkStateFrames::Head);
+    if (frame->time != expected || head.size() != nJunctions || head.back() != (double)frame->time) {
+      *good = false;
+    }
+    expected += step;
+    int ms = (++saved % stallEvery == 0) ? stallMs : saveMs;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(ms));
+    frames->finishFrame();
+  }
+  if (saved != nSteps) {
+    *good = false;
+  }
+}
+
+bool simulate(size_t capacity) {
+  NetworkStateFrames frames(capacity);
+  bool good = true;
+  boost::thread writerThread(writer, &frames, &good);
+
+  double waited = 0;
+  size_t deepest = 0;
+  time_t maxLag = 0;
+  boost::timer::cpu_timer total;
+  for (int i = 0; i < nSteps; ++i) {
+    time_t t = start + i * step;
+    boost::this_thread::sleep(boost::posix_time::milliseconds(solveMs));
+
+    boost::timer::cpu_timer timer;
+    NetworkStateFrames::Frame& frame = frames.beginFrame(t);
+    waited += (double)timer.elapsed().wall / 1e9;
+    frame.values(0, NetworkStateFrames::Head).assign(nJunctions, (double)t);
+    frames.commitFrame();
+
+    deepest = max(deepest, frames.queueDepth());
+    maxLag = max(maxLag, frames.writerLag());
+  }
+  frames.close();
+  writerThread.join();
+
+  cout << "ring of " << capacity << ": " << (double)total.elapsed().wall / 1e9 << " s, solver waited " << waited << " s, deepest queue " << deepest << ", largest lag " << maxLag << " s, " << (good ? "all steps saved in order" : "STEPS LOST") << endl;
+  return good;
+}
+
+
+int main(int argc, const char * argv[])
+{
+  bool good = simulate(2);
+  good = simulate(8) && good;
+  return good ? 0 : 1;
+}
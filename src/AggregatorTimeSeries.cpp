@@ -10,7 +10,9 @@
 #include <limits>
 
 #include "AggregatorTimeSeries.h"
+#include "TimeSeriesFetchPool.h"
 #include <boost/foreach.hpp>
+#include <boost/bind/bind.hpp>
 #include <boost/range/adaptors.hpp>
 #include <set>
 
@@ -178,8 +180,8 @@ Point AggregatorTimeSeries::pointAfter(time_t time) {
 
 
 
-std::set<time_t> AggregatorTimeSeries::timeValuesInRange(TimeRange range) {
-  set<time_t> timeList;
+TimeGrid AggregatorTimeSeries::timeValuesInRange(TimeRange range) {
+  TimeGrid timeList;
   
   if (this->clock()) {
     // align the query with the clock
@@ -188,21 +190,47 @@ std::set<time_t> AggregatorTimeSeries::timeValuesInRange(TimeRange range) {
   else {
     // get the set of times from the aggregator sources
     BOOST_FOREACH(AggregatorSource aggSource, this->sources()) {
-      set<time_t> sourceTimes = aggSource.timeseries->timeValuesInRange(range);
-      BOOST_FOREACH(time_t t, sourceTimes) {
-        timeList.insert(t);
-      }
+      timeList = timeList.unionWith(aggSource.timeseries->timeValuesInRange(range));
     }
   }
   return timeList;
 }
 
+std::vector<TimeSeries::_sp> AggregatorTimeSeries::upstreamSeries() {
+  std::vector<TimeSeries::_sp> upstream;
+  BOOST_FOREACH(AggregatorSource aggSource, this->sources()) {
+    upstream.push_back(aggSource.timeseries);
+  }
+  return upstream;
+}
+
+TimeRange AggregatorTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  bool isSource = false;
+  BOOST_FOREACH(AggregatorSource aggSource, this->sources()) {
+    if (aggSource.timeseries == upstream) {
+      isSource = true;
+      break;
+    }
+  }
+  if (!upstream || !isSource) {
+    return TimeRange();
+  }
+  
+  TimeRange componentRange = range;
+  time_t leftSeekTime = upstream->timeBefore(range.start + 1);
+  time_t rightSeekTime = upstream->timeAfter(range.end - 1);
+  componentRange.start = leftSeekTime > 0 ? leftSeekTime : range.start;
+  componentRange.end = rightSeekTime > 0 ? rightSeekTime : range.end;
+  return componentRange;
+}
+
 TimeSeries::PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange range) {
-  set<time_t> droppedTimes;
   vector<Point> aggregated;
   double nSources = (double)(this->sources().size());
   
-  set<time_t> desiredTimes = this->timeValuesInRange(range);
+  TimeGrid desiredTimes = this->timeValuesInRange(range);
+  vector<bool> dropped(desiredTimes.size(), false);
+  aggregated.reserve(desiredTimes.size());
   
   // pre-load a vector of points.
   BOOST_FOREACH(time_t now, desiredTimes) {
@@ -223,29 +251,33 @@ TimeSeries::PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange
     aggregated.push_back(p);
   }
   
-  BOOST_FOREACH(AggregatorSource aggSource, this->sources()) {
-    TimeSeries::_sp sourceTs = aggSource.timeseries;
-    double multiplier = aggSource.multiplier;
-    TimeRange componentRange = range;
-    time_t leftSeekTime = sourceTs->timeBefore(range.start + 1);
-    time_t rightSeekTime = sourceTs->timeAfter(range.end - 1);
-    componentRange.start = leftSeekTime > 0 ? leftSeekTime : range.start;
-    componentRange.end = rightSeekTime > 0 ? rightSeekTime : range.end;
+  // fetch the components side-by-side, then fold them in source order.
+  vector<AggregatorSource> aggSources = this->sources();
+  vector<TimeSeries::_sp> components;
+  BOOST_FOREACH(const AggregatorSource& aggSource, aggSources) {
+    components.push_back(aggSource.timeseries);
+  }
+  TimeSeriesFetchPool::RangeFunction componentRange = boost::bind(&AggregatorTimeSeries::upstreamRange, this, boost::placeholders::_1, range);
+  vector<PointCollection> componentCollections = TimeSeriesFetchPool::pointCollections(components, componentRange);
+  
+  for (size_t iSource = 0; iSource < aggSources.size(); ++iSource) {
+    double multiplier = aggSources[iSource].multiplier;
     
-    PointCollection componentCollection = sourceTs->pointCollection(componentRange);
+    PointCollection& componentCollection = componentCollections[iSource];
     componentCollection.resample(desiredTimes);
     componentCollection.convertToUnits(this->units());
     
-    // make it easy to find any times that were dropped (bad points from a source series)
-    map<time_t, Point> sourcePointMap;
-    BOOST_FOREACH(const Point& p, componentCollection.points) {
-      sourcePointMap[p.time] = p;
-    }
-    
-    // do the aggregation.
-    BOOST_FOREACH(Point& p, aggregated) {
-      if (sourcePointMap.count(p.time) > 0) {
-        Point pointToAggregate = sourcePointMap[p.time] * multiplier;
+    // the resampled component is an ordered subset of the desired times, so walk both in step.
+    // any desired time the component doesn't have was dropped (bad points from a source series)
+    vector<Point>::const_iterator sourceIt = componentCollection.points.begin();
+    vector<Point>::const_iterator sourceEnd = componentCollection.points.end();
+    for (size_t i = 0; i < aggregated.size(); ++i) {
+      Point& p = aggregated[i];
+      while (sourceIt != sourceEnd && sourceIt->time < p.time) {
+        ++sourceIt;
+      }
+      if (sourceIt != sourceEnd && sourceIt->time == p.time) {
+        Point pointToAggregate = (*sourceIt) * multiplier;
         
         switch (_mode) {
           case AggregatorModeSum:
@@ -277,20 +309,21 @@ TimeSeries::PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange
         
       }
       else {
-        droppedTimes.insert(p.time); // if any member is missing, then remove the point from the output
+        dropped[i] = true; // if any member is missing, then remove the point from the output
       }
     }
   }
   
   // prune dropped points from aggregation result.
   vector<Point> goodPoints;
-  BOOST_FOREACH(const Point& p, aggregated) {
-    if (droppedTimes.count(p.time) == 0) {
-      goodPoints.push_back(p);
+  goodPoints.reserve(aggregated.size());
+  for (size_t i = 0; i < aggregated.size(); ++i) {
+    if (!dropped[i]) {
+      goodPoints.push_back(aggregated[i]);
     }
   }
   
-  PointCollection data(goodPoints, this->units());
+  PointCollection data(std::move(goodPoints), this->units());
   data.resample(desiredTimes);
   
   return data;
@@ -69,7 +69,9 @@ namespace RTX {
     
   protected:
     PointCollection filterPointsInRange(TimeRange range);
-    std::set<time_t> timeValuesInRange(TimeRange range);
+    std::vector<TimeSeries::_sp> upstreamSeries();
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
+    TimeGrid timeValuesInRange(TimeRange range);
     bool canSetSource(TimeSeries::_sp ts);
     void didSetSource(TimeSeries::_sp ts);
 
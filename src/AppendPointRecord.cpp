@@ -0,0 +1,380 @@
+//
+//  AppendPointRecord.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "AppendPointRecord.h"
+
+#include <algorithm>
+#include <limits>
+#include <boost/foreach.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace RTX;
+using namespace std;
+
+namespace {
+  bool _timeBefore(const Point& p, time_t t) {
+    return p.time < t;
+  }
+}
+
+
+#pragma mark - Series
+
+AppendPointRecord::Series::Series(Units u) : units(u), _size(0), _generation(0) {
+  for (int k = 0; k < nBlocks; ++k) {
+    _blocks[k].store(NULL);
+  }
+}
+
+AppendPointRecord::Series::~Series() {
+  for (int k = 0; k < nBlocks; ++k) {
+    delete[] _blocks[k].load();
+  }
+}
+
+
+size_t AppendPointRecord::Series::blockStart(int k) {
+  return (size_t)RTX_APPEND_BLOCK_SIZE * (((size_t)1 << k) - 1);
+}
+
+Point* AppendPointRecord::Series::block(int k) const {
+  return _blocks[k].load(std::memory_order_acquire);
+}
+
+Point& AppendPointRecord::Series::slot(size_t i) const {
+  int k = 0;
+  while (blockStart(k + 1) <= i) {
+    ++k;
+  }
+  return this->block(k)[i - blockStart(k)];
+}
+
+
+size_t AppendPointRecord::Series::lowerBound(size_t size, time_t time) const {
+  for (int k = 0; k < nBlocks && blockStart(k) < size; ++k) {
+    size_t begin = blockStart(k);
+    size_t end = min(blockStart(k + 1), size);
+    Point* b = this->block(k);
+    if (b[end - begin - 1].time >= time) {
+      // it's in this block
+      return begin + (size_t)(lower_bound(b, b + (end - begin), time, &_timeBefore) - b);
+    }
+  }
+  return size;
+}
+
+
+void AppendPointRecord::Series::copy(size_t from, size_t to, std::vector<Point>& out) const {
+  out.reserve(out.size() + (to - from));
+  for (int k = 0; k < nBlocks && blockStart(k) < to; ++k) {
+    size_t begin = max(blockStart(k), from);
+    size_t end = min(blockStart(k + 1), to);
+    if (begin < end) {
+      Point* b = this->block(k);
+      out.insert(out.end(), b + (begin - blockStart(k)), b + (end - blockStart(k)));
+    }
+  }
+}
+
+
+// a seqlock, entered only by readers: appends don't touch anything a reader can see
+// until the length is published. only a rewind changes the generation.
+size_t AppendPointRecord::Series::beginRead() const {
+  size_t generation;
+  while ((generation = _generation.load(std::memory_order_acquire)) & 1) {
+    boost::this_thread::yield();
+  }
+  return generation;
+}
+
+bool AppendPointRecord::Series::endRead(size_t generation) const {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return _generation.load(std::memory_order_relaxed) == generation;
+}
+
+
+void AppendPointRecord::Series::append(const Point* first, const Point* last) {
+  if (first == last) {
+    return;
+  }
+
+  size_t n = _size.load(std::memory_order_relaxed);
+  size_t generation = _generation.load(std::memory_order_relaxed);
+  const bool rewind = (n > 0 && first->time <= this->slot(n - 1).time);
+  if (rewind) {
+    _generation.store(generation + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    n = this->lowerBound(n, first->time);
+    _size.store(n, std::memory_order_relaxed);
+  }
+
+  int k = 0;
+  while (blockStart(k + 1) <= n) {
+    ++k;
+  }
+  for (const Point* p = first; p != last; ++p) {
+    if (p + 1 != last && (p + 1)->time == p->time) {
+      continue; // the later of two points at the same time wins
+    }
+    if (n == blockStart(k + 1)) {
+      ++k;
+    }
+    Point* b = _blocks[k].load(std::memory_order_relaxed);
+    if (!b) {
+      b = new Point[blockStart(k + 1) - blockStart(k)];
+      _blocks[k].store(b, std::memory_order_release);
+    }
+    b[n - blockStart(k)] = *p;
+    ++n;
+  }
+
+  _size.store(n, std::memory_order_release);
+  if (rewind) {
+    _generation.store(generation + 2, std::memory_order_release);
+  }
+}
+
+void AppendPointRecord::Series::clear() {
+  // a rewind to nothing. storage is kept: a reader may still be looking at it.
+  size_t generation = _generation.load(std::memory_order_relaxed);
+  _generation.store(generation + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _size.store(0, std::memory_order_relaxed);
+  _generation.store(generation + 2, std::memory_order_release);
+}
+
+
+Point AppendPointRecord::Series::pointAt(time_t time) const {
+  Point p;
+  size_t generation;
+  do {
+    generation = this->beginRead();
+    size_t n = _size.load(std::memory_order_acquire);
+    size_t i = this->lowerBound(n, time);
+    p = (i < n && this->slot(i).time == time) ? this->slot(i) : Point();
+  } while (!this->endRead(generation));
+  return p;
+}
+
+Point AppendPointRecord::Series::pointBefore(time_t time) const {
+  Point p;
+  size_t generation;
+  do {
+    generation = this->beginRead();
+    size_t n = _size.load(std::memory_order_acquire);
+    size_t i = this->lowerBound(n, time);
+    p = (i > 0) ? this->slot(i - 1) : Point();
+  } while (!this->endRead(generation));
+  return p;
+}
+
+Point AppendPointRecord::Series::pointAfter(time_t time) const {
+  Point p;
+  if (time == numeric_limits<time_t>::max()) {
+    return p;
+  }
+  size_t generation;
+  do {
+    generation = this->beginRead();
+    size_t n = _size.load(std::memory_order_acquire);
+    size_t i = this->lowerBound(n, time + 1);
+    p = (i < n) ? this->slot(i) : Point();
+  } while (!this->endRead(generation));
+  return p;
+}
+
+std::vector<Point> AppendPointRecord::Series::pointsInRange(time_t start, time_t end) const {
+  vector<Point> points;
+  if (end < start) {
+    return points;
+  }
+  size_t generation;
+  do {
+    points.clear();
+    generation = this->beginRead();
+    size_t n = _size.load(std::memory_order_acquire);
+    size_t from = this->lowerBound(n, start);
+    size_t to = (end == numeric_limits<time_t>::max()) ? n : this->lowerBound(n, end + 1);
+    this->copy(from, to, points);
+  } while (!this->endRead(generation));
+  return points;
+}
+
+Point AppendPointRecord::Series::first() const {
+  Point p;
+  size_t generation;
+  do {
+    generation = this->beginRead();
+    size_t n = _size.load(std::memory_order_acquire);
+    p = (n > 0) ? this->slot(0) : Point();
+  } while (!this->endRead(generation));
+  return p;
+}
+
+Point AppendPointRecord::Series::last() const {
+  Point p;
+  size_t generation;
+  do {
+    generation = this->beginRead();
+    size_t n = _size.load(std::memory_order_acquire);
+    p = (n > 0) ? this->slot(n - 1) : Point();
+  } while (!this->endRead(generation));
+  return p;
+}
+
+
+#pragma mark - AppendPointRecord
+
+AppendPointRecord::AppendPointRecord() {
+  _index.reset(new SeriesVector_t());
+}
+
+
+std::ostream& AppendPointRecord::toStream(std::ostream &stream) {
+  stream << "Append-only Point Record" << std::endl;
+  return stream;
+}
+
+
+bool AppendPointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) {
+  handle_t handle = this->handleForIdentifier(recordName);
+  boost::mutex::scoped_lock lock(_indexMutex);
+  boost::shared_ptr<const SeriesVector_t> index = boost::atomic_load(&_index);
+  if ((size_t)handle < index->size() && (*index)[handle]) {
+    return true;
+  }
+  // copy-on-write: readers holding the old index keep using it.
+  boost::shared_ptr<SeriesVector_t> newIndex(new SeriesVector_t(*index));
+  if ((size_t)handle >= newIndex->size()) {
+    newIndex->resize(handle + 1);
+  }
+  (*newIndex)[handle] = Series_sp(new Series(units));
+  boost::atomic_store(&_index, boost::shared_ptr<const SeriesVector_t>(newIndex));
+  return true;
+}
+
+const std::map<std::string,Units> AppendPointRecord::identifiersAndUnits() {
+  std::map<std::string,Units> ids;
+  boost::shared_ptr<const SeriesVector_t> index = boost::atomic_load(&_index);
+  for (size_t handle = 0; handle < index->size(); ++handle) {
+    if ((*index)[handle]) {
+      ids[this->identifierForHandle((handle_t)handle)] = (*index)[handle]->units;
+    }
+  }
+  return ids;
+}
+
+
+AppendPointRecord::Series_sp AppendPointRecord::series(handle_t handle) {
+  boost::shared_ptr<const SeriesVector_t> index = boost::atomic_load(&_index);
+  if (handle < 0 || (size_t)handle >= index->size()) {
+    return Series_sp();
+  }
+  return (*index)[handle];
+}
+
+
+Point AppendPointRecord::point(const string& identifier, time_t time) {
+  return this->point(this->existingHandle(identifier), time);
+}
+
+Point AppendPointRecord::pointBefore(const string& identifier, time_t time) {
+  return this->pointBefore(this->existingHandle(identifier), time);
+}
+
+Point AppendPointRecord::pointAfter(const string& identifier, time_t time) {
+  return this->pointAfter(this->existingHandle(identifier), time);
+}
+
+std::vector<Point> AppendPointRecord::pointsInRange(const string& identifier, time_t startTime, time_t endTime) {
+  return this->pointsInRange(this->existingHandle(identifier), startTime, endTime);
+}
+
+void AppendPointRecord::addPoint(const string& identifier, Point point) {
+  this->addPoint(this->existingHandle(identifier), point);
+}
+
+void AppendPointRecord::addPoints(const string& identifier, const std::vector<Point>& points) {
+  this->addPoints(this->existingHandle(identifier), points);
+}
+
+
+Point AppendPointRecord::point(handle_t handle, time_t time) {
+  Series_sp s = this->series(handle);
+  return s ? s->pointAt(time) : Point();
+}
+
+Point AppendPointRecord::pointBefore(handle_t handle, time_t time) {
+  Series_sp s = this->series(handle);
+  return s ? s->pointBefore(time) : Point();
+}
+
+Point AppendPointRecord::pointAfter(handle_t handle, time_t time) {
+  Series_sp s = this->series(handle);
+  return s ? s->pointAfter(time) : Point();
+}
+
+std::vector<Point> AppendPointRecord::pointsInRange(handle_t handle, time_t startTime, time_t endTime) {
+  Series_sp s = this->series(handle);
+  return s ? s->pointsInRange(startTime, endTime) : vector<Point>();
+}
+
+
+void AppendPointRecord::addPoint(handle_t handle, Point point) {
+  Series_sp s = this->series(handle);
+  if (s) {
+    s->append(&point, &point + 1);
+  }
+}
+
+void AppendPointRecord::addPoints(handle_t handle, const std::vector<Point>& points) {
+  Series_sp s = this->series(handle);
+  if (!s || points.empty()) {
+    return;
+  }
+  if (std::is_sorted(points.begin(), points.end(), &Point::comparePointTime)) {
+    s->append(&points.front(), &points.front() + points.size());
+  }
+  else {
+    vector<Point> ordered(points);
+    std::sort(ordered.begin(), ordered.end(), &Point::comparePointTime);
+    s->append(&ordered.front(), &ordered.front() + ordered.size());
+  }
+}
+
+
+void AppendPointRecord::reset() {
+  boost::shared_ptr<const SeriesVector_t> index = boost::atomic_load(&_index);
+  BOOST_FOREACH(const Series_sp& s, *index) {
+    if (s) {
+      s->clear();
+    }
+  }
+}
+
+void AppendPointRecord::reset(const string& identifier) {
+  Series_sp s = this->series(this->existingHandle(identifier));
+  if (s) {
+    s->clear();
+  }
+}
+
+
+Point AppendPointRecord::firstPoint(const string& id) {
+  Series_sp s = this->series(this->existingHandle(id));
+  return s ? s->first() : Point();
+}
+
+Point AppendPointRecord::lastPoint(const string& id) {
+  Series_sp s = this->series(this->existingHandle(id));
+  return s ? s->last() : Point();
+}
+
+PointRecord::time_pair_t AppendPointRecord::range(const string& id) {
+  return make_pair(this->firstPoint(id).time, this->lastPoint(id).time);
+}
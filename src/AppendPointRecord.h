@@ -0,0 +1,113 @@
+//
+//  AppendPointRecord.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__AppendPointRecord__
+#define __epanet_rtx__AppendPointRecord__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "PointRecord.h"
+
+namespace RTX {
+
+  /*!
+   \class AppendPointRecord
+   \brief An in-memory PointRecord for series that grow forward in time, written by one thread and read by any number.
+
+   Made for simulation output: Model::saveNetworkStates appends one point per state per step, while ModelPerformance or a dashboard scans the same series. Points are stored in blocks that are never moved once allocated, and a new point becomes visible by publishing the series' length, so readers take no locks and never wait on the writer.
+
+   Each series must have at most one writer at a time. A point at or before the last time rewinds the series: everything from that time on is replaced, as when a simulation is re-run from an earlier time. Readers that overlap a rewind retry their read. reset() empties series the same way, but keeps their storage for reuse; memory is only returned when the record is destroyed.
+
+   Registering a series copies the identifier index, so register every series before writing to any of them.
+   */
+
+  class AppendPointRecord : public PointRecord {
+
+  public:
+    RTX_SHARED_POINTER(AppendPointRecord);
+    AppendPointRecord();
+    virtual ~AppendPointRecord() {};
+
+    virtual bool registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units);
+    const virtual std::map<std::string,Units> identifiersAndUnits();
+
+    virtual Point point(const string& identifier, time_t time);
+    virtual Point pointBefore(const string& identifier, time_t time);
+    virtual Point pointAfter(const string& identifier, time_t time);
+    virtual std::vector<Point> pointsInRange(const string& identifier, time_t startTime, time_t endTime);
+    virtual void addPoint(const string& identifier, Point point);
+    virtual void addPoints(const string& identifier, const std::vector<Point>& points);
+    
+    virtual Point point(handle_t handle, time_t time);
+    virtual Point pointBefore(handle_t handle, time_t time);
+    virtual Point pointAfter(handle_t handle, time_t time);
+    virtual std::vector<Point> pointsInRange(handle_t handle, time_t startTime, time_t endTime);
+    virtual void addPoint(handle_t handle, Point point);
+    virtual void addPoints(handle_t handle, const std::vector<Point>& points);
+    
+    virtual void reset();
+    virtual void reset(const string& identifier);
+    virtual Point firstPoint(const string& id);
+    virtual Point lastPoint(const string& id);
+    virtual time_pair_t range(const string& id);
+
+    virtual std::ostream& toStream(std::ostream &stream);
+
+  private:
+    // one series' points, in time order. single writer, lock-free readers.
+    class Series {
+    public:
+      Series(Units units);
+      ~Series();
+      Units units;
+
+      void append(const Point* first, const Point* last); // ordered
+      void clear();
+
+      Point pointAt(time_t time) const;
+      Point pointBefore(time_t time) const;
+      Point pointAfter(time_t time) const;
+      std::vector<Point> pointsInRange(time_t start, time_t end) const;
+      Point first() const;
+      Point last() const;
+
+    private:
+      Series(const Series&);
+      Series& operator=(const Series&);
+
+      // block k holds (RTX_APPEND_BLOCK_SIZE << k) points, so 48 blocks never run out.
+      enum { nBlocks = 48 };
+      static size_t blockStart(int k);
+      Point* block(int k) const;
+      Point& slot(size_t i) const;
+      size_t lowerBound(size_t size, time_t time) const; // first index with time >= time
+      void copy(size_t from, size_t to, std::vector<Point>& out) const;
+      size_t beginRead() const;
+      bool endRead(size_t generation) const; // false if the writer rewound meanwhile: read again
+
+      std::atomic<Point*> _blocks[nBlocks];
+      std::atomic<size_t> _size;       // published length
+      std::atomic<size_t> _generation; // odd while the writer rewinds
+    };
+    typedef boost::shared_ptr<Series> Series_sp;
+    typedef std::vector<Series_sp> SeriesVector_t; // by handle
+
+    Series_sp series(handle_t handle);
+
+    boost::shared_ptr<const SeriesVector_t> _index; // replaced, never modified, so a reader's snapshot stays valid
+    boost::mutex _indexMutex; // serializes replacing the index
+  };
+
+}
+
+#endif /* defined(__epanet_rtx__AppendPointRecord__) */
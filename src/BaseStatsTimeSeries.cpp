@@ -50,19 +50,10 @@ BaseStatsTimeSeries::StatsSamplingMode_t BaseStatsTimeSeries::samplingMode() {
 }
 
 
-BaseStatsTimeSeries::pointSummaryMap_t BaseStatsTimeSeries::filterSummaryCollection(std::set<time_t> times) {
-  
-  if (times.size() == 0) {
-    return pointSummaryMap_t();
-  }
-  
-  TimeSeries::_sp sourceTs = this->source();
-  time_t fromTime = *(times.begin());
-  time_t toTime = *(times.rbegin());
-  
+void BaseStatsTimeSeries::windowDistances(time_t& lagDistance, time_t& leadDistance) {
   time_t windowLen = this->window()->period();
   
-  time_t lagDistance  = 0,
+  lagDistance = 0;
   leadDistance = 0;
   
   switch (this->samplingMode()) {
@@ -85,6 +76,27 @@ BaseStatsTimeSeries::pointSummaryMap_t BaseStatsTimeSeries::filterSummaryCollect
     }
     default: break;
   }
+}
+
+TimeRange BaseStatsTimeSeries::windowedRange(TimeRange range) {
+  time_t lagDistance, leadDistance;
+  this->windowDistances(lagDistance, leadDistance);
+  return TimeRange(range.start - lagDistance, range.end + leadDistance);
+}
+
+
+BaseStatsTimeSeries::pointSummaryMap_t BaseStatsTimeSeries::filterSummaryCollection(const TimeGrid& times) {
+  
+  if (times.size() == 0) {
+    return pointSummaryMap_t();
+  }
+  
+  TimeSeries::_sp sourceTs = this->source();
+  time_t fromTime = times.front();
+  time_t toTime = times.back();
+  
+  time_t lagDistance, leadDistance;
+  this->windowDistances(lagDistance, leadDistance);
   
   
   pointSummaryMap_t outSummaries;
@@ -67,12 +67,14 @@ namespace RTX {
     
   protected:
     virtual PointCollection filterPointsInRange(TimeRange range) = 0; // pure virtual. don't use this class directly.
-    pointSummaryMap_t filterSummaryCollection(std::set<time_t> times);
+    pointSummaryMap_t filterSummaryCollection(const TimeGrid& times);
+    TimeRange windowedRange(TimeRange range); // range widened by the sampling window
     
   private:
     Clock::_sp _window;
     bool _summaryOnly;
     StatsSamplingMode_t _samplingMode;
+    void windowDistances(time_t& lagDistance, time_t& leadDistance);
   };
 }
 
@@ -8,18 +8,36 @@
 
 #include "BufferPointRecord.h"
 #include <iostream>
+#include <algorithm>
+#include <limits>
 #include <boost/foreach.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/thread/locks.hpp>
 
 using namespace RTX;
 using namespace std;
 
-using boost::signals2::mutex;
-using boost::interprocess::scoped_lock;
+typedef boost::shared_lock<boost::shared_mutex> ReadLock;
+typedef boost::unique_lock<boost::shared_mutex> WriteLock;
+
+namespace {
+  BufferPointRecord::Coverage_t::interval_type _closedRange(time_t start, time_t end) {
+    return BufferPointRecord::Coverage_t::interval_type::closed(start, end);
+  }
+  
+  time_t _chunkIndex(time_t t) {
+    // floor, also for negative times
+    time_t d = RTX_BUFFER_CHUNK_DURATION;
+    return (t >= 0) ? (t / d) : -((-t + d - 1) / d);
+  }
+}
 
 
-BufferPointRecord::BufferPointRecord(int defaultCapacity) {
+BufferPointRecord::BufferPointRecord(int defaultCapacity) : _operation(0), _hits(0), _misses(0) {
   _defaultCapacity = defaultCapacity;
+  _nAllocated = 0;
+  _budget = RTX_BUFFER_DEFAULT_BUDGET;
+  _evictions = 0;
+  _evictedPoints = 0;
 }
 
 
@@ -36,299 +54,565 @@ std::ostream& BufferPointRecord::toStream(std::ostream &stream) {
 
 bool BufferPointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) {
   // register the recordName internally and generate a buffer and mutex
+  handle_t handle = this->handleForIdentifier(recordName);
+  WriteLock mapLock(_mapMutex);
   
-  if (_keyedBuffers.find(recordName) != _keyedBuffers.end()) {
-    // got the name - do the units match?
-    Buffer b = _keyedBuffers[recordName];
-    if (b.units == units) {
-      // total match! use it.
-      return true;
-    }
+  if ((size_t)handle >= _buffers.size()) {
+    _buffers.resize(handle + 1);
   }
   
-  // check to see that it's not there
-  if (_keyedBuffers.find(recordName) == _keyedBuffers.end()) {
-    Buffer b;
-    b.circularBuffer.set_capacity(_defaultCapacity);
-    b.units = units;
-    _keyedBuffers[recordName] = b;
+  // got the name? keep what's there, whether or not the units match.
+  if (!_buffers[handle]) {
+    // storage is allocated on first insertion; registering thousands of series costs nothing.
+    Buffer_sp b(new Buffer);
+    b->units = units;
+    b->mutex.reset(new boost::shared_mutex);
+    _buffers[handle] = b;
   }
   
   return true;
 }
 
 const std::map<std::string,Units> BufferPointRecord::identifiersAndUnits() {
+  ReadLock mapLock(_mapMutex);
   std::map<std::string,Units> ids;
-  BOOST_FOREACH(StringBufferPair p, _keyedBuffers) {
-    ids[p.first] = p.second.units;
+  for (size_t handle = 0; handle < _buffers.size(); ++handle) {
+    if (_buffers[handle]) {
+      ids[this->identifierForHandle((handle_t)handle)] = _buffers[handle]->units;
+    }
   }
   return ids;
 }
 
+
+BufferPointRecord::Buffer* BufferPointRecord::buffer(handle_t handle) {
+  if (handle < 0 || (size_t)handle >= _buffers.size()) {
+    return NULL;
+  }
+  return _buffers[handle].get();
+}
+
+
+#pragma mark - Identifiers
+
+// identifiers are looked up once, then it's the same as by handle.
+
 Point BufferPointRecord::point(const string& identifier, time_t time) {
-  
   Point bp = PointRecord::point(identifier,time);
   if (bp.isValid) {
     return bp;
   }
+  return this->point(this->existingHandle(identifier), time);
+}
+
+Point BufferPointRecord::pointBefore(const string& identifier, time_t time) {
+  return this->pointBefore(this->existingHandle(identifier), time);
+}
+
+Point BufferPointRecord::pointAfter(const string& identifier, time_t time) {
+  return this->pointAfter(this->existingHandle(identifier), time);
+}
+
+std::vector<Point> BufferPointRecord::pointsInRange(const string& identifier, time_t startTime, time_t endTime) {
+  return this->pointsInRange(this->existingHandle(identifier), startTime, endTime);
+}
+
+void BufferPointRecord::addPoint(const string& identifier, Point point) {
   
-  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  PointRecord::addPoint(identifier, point);
   
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(identifier);
-  if (it == _keyedBuffers.end()) {
-    // nobody here by that name
-    return Point();
-  }
+  // do something more interesting in your derived class.
+  // why nothing smart? because how can you ensure that a point you want to insert here is contiguous?
+  // there's no way without knowing about clocks and all that business.
   
-  // get the constituents
-  PointBuffer_t& buffer = (it->second.circularBuffer);
+}
+
+void BufferPointRecord::addPoints(const string& identifier, const std::vector<Point>& points) {
+  this->addPoints(this->existingHandle(identifier), points);
+}
+
+void BufferPointRecord::addPointsInRange(const string& identifier, const std::vector<Point>& points, time_t start, time_t end) {
+  this->addPointsInRange(this->existingHandle(identifier), points, start, end);
+}
+
+bool BufferPointRecord::isCovered(const string& identifier, time_t start, time_t end) {
+  return this->isCovered(this->existingHandle(identifier), start, end);
+}
+
+std::vector<PointRecord::time_pair_t> BufferPointRecord::gapsInRange(const string& identifier, time_t start, time_t end) {
+  return this->gapsInRange(this->existingHandle(identifier), start, end);
+}
+
+
+#pragma mark - Handles
+
+Point BufferPointRecord::point(handle_t handle, time_t time) {
   
-  if (buffer.empty()) {
+  ReadLock mapLock(_mapMutex);
+  
+  Buffer* b = this->buffer(handle);
+  if (!b) {
+    // nobody here by that name
+    ++_misses;
     return Point();
   }
   
-  Point pFirst = buffer.front();
-  Point pLast = buffer.back();
+  ReadLock seriesLock(*(b->mutex));
+  
+  // get the constituents
+  const PointBuffer_t& buffer = (b->circularBuffer);
   
-  if (pFirst.time <= time && time <= pLast.time) {
+  if (!buffer.empty() && buffer.front().time <= time && time <= buffer.back().time) {
     // search the buffer
     Point finder(time, 0);
-    PointBuffer_t::iterator startIterator = buffer.begin();
-    PointBuffer_t::iterator pbIt = std::lower_bound(startIterator, buffer.end(), finder, &Point::comparePointTime);
+    PointBuffer_t::const_iterator pbIt = std::lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
     if (pbIt != buffer.end() && pbIt->time == time) {
-      Point p = *pbIt;
-      PointRecord::addPoint(identifier, p);
-      return p;
-    }
-    else {
-      return Point();
+      ++_hits;
+      this->touchIfIdle(handle, pbIt, pbIt + 1);
+      return *pbIt;
     }
   }
   
-  
+  // not here. if the time is covered, that is an answer too.
+  if (boost::icl::contains(b->coverage, time)) {
+    ++_hits;
+  }
+  else {
+    ++_misses;
+  }
   return Point();
 }
 
 
 
-Point BufferPointRecord::pointBefore(const string& identifier, time_t time) {
+Point BufferPointRecord::pointBefore(handle_t handle, time_t time) {
   
-  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  ReadLock mapLock(_mapMutex);
   
   Point foundPoint;
-  //TimePointPair_t finder(time, PointPair_t(0,0));
   Point finder(time, 0);
   
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
+  Buffer* b = this->buffer(handle);
+  if (b) {
+    ReadLock seriesLock(*(b->mutex));
+    
     // get the constituents
-    PointBuffer_t& buffer = (it->second.circularBuffer);
+    const PointBuffer_t& buffer = (b->circularBuffer);
+    const Coverage_t& coverage = (b->coverage);
     
-    PointBuffer_t::const_iterator it  = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
-    if (it != buffer.begin()) {
-      // we're not at the beginning, so there is a point before time
-      if (it != buffer.end()) {
-        // and we're not at the end, so the point is within the continuous buffer
-        // we want the previous point
-        foundPoint = *(--it);
-        PointRecord::addPoint(identifier, foundPoint);
-        return foundPoint;
-      }
-      else if ((--it)->time == time - 1) {
-        // edge case where end of buffer is adjacent to requested time
-        foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
+    PointBuffer_t::const_iterator pIt = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
+    if (pIt != buffer.begin()) {
+      --pIt;
+      // it's only the previous point if nothing can be missing between it and the requested time
+      if (boost::icl::contains(coverage, _closedRange(pIt->time, time - 1))) {
+        foundPoint = *pIt;
+        ++_hits;
+        this->touchIfIdle(handle, pIt, pIt + 1);
         return foundPoint;
       }
     }
   }
   
+  ++_misses;
   return foundPoint;
 }
 
 
-Point BufferPointRecord::pointAfter(const string& identifier, time_t time) {
+Point BufferPointRecord::pointAfter(handle_t handle, time_t time) {
   
-  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  ReadLock mapLock(_mapMutex);
   
   Point foundPoint;
-  //TimePointPair_t finder(time, PointPair_t(0,0));
   Point finder(time, 0);
   
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
+  Buffer* b = this->buffer(handle);
+  if (b) {
+    ReadLock seriesLock(*(b->mutex));
+    
     // get the constituents
-    PointBuffer_t& buffer = (it->second.circularBuffer);
+    const PointBuffer_t& buffer = (b->circularBuffer);
+    const Coverage_t& coverage = (b->coverage);
     
-    PointBuffer_t::const_iterator it = upper_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
-    if (it != buffer.end()) {
-      // OK we're not at the end, so there is a point after time
-      if (it != buffer.begin() || (it->time == time + 1)) {
-        // either we're not at the beginning, so the point is within the continuous buffer -
-        // or edge case where beginning of buffer is adjacent to requested time
-        foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
+    PointBuffer_t::const_iterator pIt = upper_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
+    if (pIt != buffer.end()) {
+      // same here: the gap between the requested time and this point must be known
+      if (boost::icl::contains(coverage, _closedRange(time + 1, pIt->time))) {
+        foundPoint = *pIt;
+        ++_hits;
+        this->touchIfIdle(handle, pIt, pIt + 1);
         return foundPoint;
       }
     }
   }
   
+  ++_misses;
   return foundPoint;
 }
 
 
-std::vector<Point> BufferPointRecord::pointsInRange(const string& identifier, time_t startTime, time_t endTime) {
+std::vector<Point> BufferPointRecord::pointsInRange(handle_t handle, time_t startTime, time_t endTime) {
   
-  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  ReadLock mapLock(_mapMutex);
   
   std::vector<Point> pointVector;
   
   //TimePointPair_t finder(startTime, PointPair_t(0,0));
   Point finder(startTime, 0);
   
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
+  Buffer* b = this->buffer(handle);
+  if (b) {
+    ReadLock seriesLock(*(b->mutex));
+    
     // get the constituents
-    PointBuffer_t& buffer = (it->second.circularBuffer);
+    const PointBuffer_t& buffer = (b->circularBuffer);
+    
+    PointBuffer_t::const_iterator first = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
+    PointBuffer_t::const_iterator last = upper_bound(first, buffer.end(), Point(endTime, 0), &Point::comparePointTime);
+    pointVector.assign(first, last); // random-access, so this is a single allocation
     
-    PointBuffer_t::const_iterator it = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
-    while ( (it != buffer.end()) && (it->time <= endTime) ) {
-      Point newPoint = *it;
-      pointVector.push_back(newPoint);
-      it++;
+    this->touchIfIdle(handle, first, last);
+    if (startTime <= endTime && boost::icl::contains(b->coverage, _closedRange(startTime, endTime))) {
+      ++_hits;
+      return pointVector;
     }
   }
   
+  ++_misses;
   return pointVector;
 }
 
 
-void BufferPointRecord::addPoint(const string& identifier, Point point) {
-  
-  PointRecord::addPoint(identifier, point);
+void BufferPointRecord::addPoint(handle_t handle, Point point) {
+  PointRecord::addPoint(this->identifierForHandle(handle), point);
+}
+
+
+void BufferPointRecord::addPoints(handle_t handle, const std::vector<Point>& points) {
+  if (points.size() == 0) {
+    return;
+  }
   
-  // do something more interesting in your derived class.
-  // why nothing smart? because how can you ensure that a point you want to insert here is contiguous?
-  // there's no way without knowing about clocks and all that business.
+  // make sure they're in order. callers nearly always hand us ordered points, so only copy if we have to sort.
+  vector<Point> sortedPoints;
+  const bool inOrder = std::is_sorted(points.begin(), points.end(), &Point::comparePointTime);
+  if (!inOrder) {
+    sortedPoints = points;
+    std::sort(sortedPoints.begin(), sortedPoints.end(), &Point::comparePointTime);
+  }
+  const vector<Point>& ordered = inOrder ? points : sortedPoints;
   
+  // a batch of points is taken to be complete from its first point to its last.
+  this->addOrdered(handle, ordered, ordered.front().time, ordered.back().time);
 }
 
 
-void BufferPointRecord::addPoints(const string& identifier, std::vector<Point> points) {
-  if (points.size() == 0) {
+void BufferPointRecord::addPointsInRange(handle_t handle, const std::vector<Point>& points, time_t start, time_t end) {
+  if (end < start) {
     return;
   }
   
-  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  // only the points within the range, in order
+  vector<Point> ordered;
+  ordered.reserve(points.size());
+  BOOST_FOREACH(const Point& p, points) {
+    if (start <= p.time && p.time <= end) {
+      ordered.push_back(p);
+    }
+  }
+  if (!std::is_sorted(ordered.begin(), ordered.end(), &Point::comparePointTime)) {
+    std::sort(ordered.begin(), ordered.end(), &Point::comparePointTime);
+  }
   
-  // check the cache size, and upgrade if needed.
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
-    PointBuffer_t& buffer = (it->second.circularBuffer);
-    size_t capacity = buffer.capacity();
-    if (capacity < points.size()) {
-      // plenty of room
-      buffer.set_capacity(points.size() + capacity);
+  this->addOrdered(handle, ordered, start, end);
+}
+
+
+bool BufferPointRecord::isCovered(handle_t handle, time_t start, time_t end) {
+  ReadLock mapLock(_mapMutex);
+  Buffer* b = this->buffer(handle);
+  if (!b || end < start) {
+    return false;
+  }
+  ReadLock seriesLock(*(b->mutex));
+  return boost::icl::contains(b->coverage, _closedRange(start, end));
+}
+
+
+std::vector<PointRecord::time_pair_t> BufferPointRecord::gapsInRange(handle_t handle, time_t start, time_t end) {
+  vector<time_pair_t> gaps;
+  if (end < start) {
+    return gaps;
+  }
+  
+  Coverage_t missing;
+  missing += _closedRange(start, end);
+  
+  {
+    ReadLock mapLock(_mapMutex);
+    Buffer* b = this->buffer(handle);
+    if (b) {
+      ReadLock seriesLock(*(b->mutex));
+      missing -= b->coverage;
     }
+  }
+  
+  BOOST_FOREACH(const Coverage_t::interval_type& gap, missing) {
+    gaps.push_back(make_pair(boost::icl::first(gap), boost::icl::last(gap)));
+  }
+  return gaps;
+}
+
+
+#pragma mark - Private
+
+void BufferPointRecord::addOrdered(handle_t handle, const std::vector<Point>& ordered, time_t start, time_t end) {
+  size_t operation = ++_operation;
+  {
+    ReadLock mapLock(_mapMutex);
+    Buffer* b = this->buffer(handle);
+    if (!b) {
+      return;
+    }
+    WriteLock seriesLock(*(b->mutex));
+    this->insertOrdered(handle, *b, ordered, start, end, operation);
+  }
+  // eviction takes the locks of whichever series it trims, so it runs with none held.
+  this->evictToBudget(operation);
+}
+
+
+// caller holds the series' write lock. ordered is sorted, and within [start,end].
+void BufferPointRecord::insertOrdered(handle_t handle, Buffer& b, const std::vector<Point>& ordered, time_t start, time_t end, size_t operation) {
+  PointBuffer_t& buffer = b.circularBuffer;
+  
+  // grow rather than wrap: a series being scanned keeps what it has scanned. the budget,
+  // not the buffer's capacity, decides what goes.
+  const size_t allocated = buffer.capacity();
+  size_t needed = buffer.size() + ordered.size();
+  if (buffer.capacity() < needed) {
+    size_t capacity = std::max(needed, std::max(2 * buffer.capacity(), _defaultCapacity));
+    buffer.set_capacity(capacity);
+  }
+  
+  if (ordered.empty()) {
+    // nothing to store, but the range is now known to be empty
+  }
+  else if (buffer.empty() || buffer.back().time < ordered.front().time) {
+    // append
+    buffer.insert(buffer.end(), ordered.begin(), ordered.end());
+  }
+  else if (ordered.back().time < buffer.front().time) {
+    // prepend
+    buffer.insert(buffer.begin(), ordered.begin(), ordered.end());
+  }
+  else {
+    // interleaved: merge, keeping the existing point where times collide.
+    vector<Point> merged;
+    merged.reserve(needed);
+    PointBuffer_t::const_iterator eIt = buffer.begin(), eEnd = buffer.end();
+    vector<Point>::const_iterator nIt = ordered.begin(), nEnd = ordered.end();
+    while (eIt != eEnd || nIt != nEnd) {
+      if (nIt == nEnd || (eIt != eEnd && eIt->time <= nIt->time)) {
+        if (nIt != nEnd && nIt->time == eIt->time) {
+          ++nIt;
+        }
+        merged.push_back(*eIt++);
+      }
+      else {
+        merged.push_back(*nIt++);
+      }
+    }
+    buffer.clear();
+    buffer.insert(buffer.end(), merged.begin(), merged.end());
+  }
+  
+  b.coverage += _closedRange(start, end);
+  
+  boost::mutex::scoped_lock lruLock(_lruMutex);
+  _nAllocated += buffer.capacity() - allocated;
+  this->touch(handle, ordered.begin(), ordered.end(), operation);
+}
+
+
+// mark the chunks holding these (ordered) points as most recently used. caller holds _lruMutex.
+template<class Iterator>
+void BufferPointRecord::touch(handle_t handle, Iterator first, Iterator last, size_t operation) {
+  bool haveChunk = false;
+  time_t current = 0;
+  for (Iterator it = first; it != last; ++it) {
+    time_t index = _chunkIndex(it->time);
+    if (haveChunk && index == current) {
+      continue;
+    }
+    haveChunk = true;
+    current = index;
     
-    // figure out the insert order...
-    // if the set we're inserting has to be prepended to the buffer...
-    
-    time_t firstInsertionTime = points.front().time;
-    time_t lastInsertionTime = points.back().time;
-    
-    PointRecord::time_pair_t existingRange = BufferPointRecord::range(identifier);
-    
-    // make sure they're in order
-    std::sort(points.begin(), points.end(), &Point::comparePointTime);
-    
-    // scoped for clarity
+    ChunkKey_t key(handle, index);
+    ChunkMap_t::iterator chunkIt = _chunks.find(key);
+    if (chunkIt == _chunks.end()) {
+      _lru.push_front(key);
+      Chunk c;
+      c.lruPosition = _lru.begin();
+      c.lastTouch = operation;
+      _chunks[key] = c;
+    }
+    else {
+      _lru.splice(_lru.begin(), _lru, chunkIt->second.lruPosition);
+      chunkIt->second.lastTouch = operation;
+    }
+  }
+}
+
+
+// readers don't queue up behind each other for the lru: if it's busy, skip the update.
+template<class Iterator>
+void BufferPointRecord::touchIfIdle(handle_t handle, Iterator first, Iterator last) {
+  boost::mutex::scoped_lock lruLock(_lruMutex, boost::try_to_lock);
+  if (lruLock.owns_lock()) {
+    this->touch(handle, first, last, ++_operation);
+  }
+}
+
+
+void BufferPointRecord::evictToBudget(size_t operation) {
+  while (true) {
+    ChunkKey_t key;
     {
-      // more gap detection? right on!
-      bool gap = true;
-      
-      if (firstInsertionTime <= existingRange.second && existingRange.second < lastInsertionTime) {
-        // some of these new points need to be inserted ono the end.
-        // fast-fwd along the new points vector, ignoring any points that will not be appended.
-        gap = false;
-        Point finder(existingRange.second, 0);
-        vector<Point>::const_iterator pIt = upper_bound(points.begin(), points.end(), finder, &Point::comparePointTime);
-        // now insert these trailing points.
-        while (pIt != points.end()) {
-          if (pIt->time > existingRange.second) {
-            //BufferPointRecord::addPoint(identifier, *pIt);
-            // append to circular buffer.
-            buffer.push_back(*pIt);
-          }
-          else {
-            cerr << "BufferPointRecord: inserted points not ordered correctly" << endl;
-          }
-          ++pIt;
-        }
-      } // appending
-      
-      if (firstInsertionTime < existingRange.first && existingRange.first <= lastInsertionTime) {
-        // some of the new points need to be pre-pended to the buffer.
-        // insert onto front (reverse iteration)
-        gap = false;
-        vector<Point>::const_reverse_iterator pIt = points.rbegin();
-
-        while (pIt != points.rend()) {
-          // make this smarter? using upper_bound maybe? todo - figure out upper_bound with a reverse_iterator
-          // skip overlapping points.
-          
-          if (pIt->time < existingRange.first) {
-            buffer.push_front(*pIt);
-          }
-          // else { /* skip */ }
-          
-          ++pIt;
-        }
-      } // prepending
-      
-      if (existingRange.first <= firstInsertionTime && lastInsertionTime <= existingRange.second) {
-        // complete overlap -- why did we even try to add these?
-        gap = false;
-      } // complete overlap
-      
-      // gap means that the points we're trying to insert do not overlap the existing points.
-      // therefore, there's no guarantee of contiguity. so our only option is to clear out the existing cache
-      // and insert the new points all by themselves.
-      if (gap) {
-        // clear the buffer first.
-        buffer.clear();
-        
-        // add new points.
-        BOOST_FOREACH(Point p, points) {
-          buffer.push_back(p);
-        }
-      } // gap
-    }// scoped
+      boost::mutex::scoped_lock lruLock(_lruMutex);
+      if (_budget == 0 || _nAllocated * sizeof(Point) <= _budget || _lru.empty()) {
+        return;
+      }
+      key = _lru.back();
+      ChunkMap_t::iterator chunkIt = _chunks.find(key);
+      if (chunkIt->second.lastTouch == operation) {
+        return; // everything left was touched just now. overshoot, rather than evict what's being used.
+      }
+      _lru.pop_back();
+      _chunks.erase(chunkIt);
+    }
+    this->evictChunk(key);
+  }
+}
+
+
+// the chunk is already out of the lru; drop its points.
+void BufferPointRecord::evictChunk(const ChunkKey_t& key) {
+  time_t chunkStart = key.second * (time_t)RTX_BUFFER_CHUNK_DURATION;
+  time_t chunkEnd = chunkStart + (time_t)RTX_BUFFER_CHUNK_DURATION - 1;
+  size_t nEvicted = 0;
+  {
+    ReadLock mapLock(_mapMutex);
+    Buffer* b = this->buffer(key.first);
+    if (!b) {
+      return;
+    }
+    WriteLock seriesLock(*(b->mutex));
+    PointBuffer_t& buffer = b->circularBuffer;
+    PointBuffer_t::iterator first = lower_bound(buffer.begin(), buffer.end(), Point(chunkStart, 0), &Point::comparePointTime);
+    PointBuffer_t::iterator last = upper_bound(first, buffer.end(), Point(chunkEnd, 0), &Point::comparePointTime);
+    nEvicted = (size_t)(last - first);
+    buffer.erase(first, last);
+    b->coverage -= _closedRange(chunkStart, chunkEnd);
+    size_t released = this->shrink(buffer);
+    
+    boost::mutex::scoped_lock lruLock(_lruMutex);
+    _nAllocated -= released;
+    ++_evictions;
+    _evictedPoints += nEvicted;
   }
 }
 
 
+// give back storage once most of it is unused, so a series doesn't hold on to its peak
+// allocation after eviction. returns the number of points' worth released.
+size_t BufferPointRecord::shrink(PointBuffer_t& buffer) {
+  size_t allocated = buffer.capacity();
+  if (buffer.empty()) {
+    PointBuffer_t().swap(buffer);
+  }
+  else if (buffer.size() < allocated / 4) {
+    buffer.set_capacity(std::max(buffer.size(), std::min(_defaultCapacity, allocated)));
+  }
+  return allocated - buffer.capacity();
+}
+
 
 void BufferPointRecord::reset() {
-  _keyedBuffers.clear();
+  WriteLock mapLock(_mapMutex);
+  _buffers.clear();
+  boost::mutex::scoped_lock lruLock(_lruMutex);
+  _lru.clear();
+  _chunks.clear();
+  _nAllocated = 0;
 }
 
 void BufferPointRecord::reset(const string& identifier) {
-  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(identifier);
-  if (it != _keyedBuffers.end()) {
-    PointBuffer_t& buffer = (it->second.circularBuffer);
-    buffer.clear();
+  handle_t handle = this->existingHandle(identifier);
+  ReadLock mapLock(_mapMutex);
+  Buffer* b = this->buffer(handle);
+  if (!b) {
+    return;
+  }
+  WriteLock seriesLock(*(b->mutex));
+  PointBuffer_t& buffer = (b->circularBuffer);
+  size_t released = buffer.capacity();
+  PointBuffer_t().swap(buffer);
+  b->coverage.clear();
+  
+  // forget its chunks
+  boost::mutex::scoped_lock lruLock(_lruMutex);
+  _nAllocated -= released;
+  ChunkMap_t::iterator chunkIt = _chunks.lower_bound(ChunkKey_t(handle, std::numeric_limits<time_t>::min()));
+  while (chunkIt != _chunks.end() && chunkIt->first.first == handle) {
+    _lru.erase(chunkIt->second.lruPosition);
+    _chunks.erase(chunkIt++);
   }
 }
 
 
+size_t BufferPointRecord::memoryBudget() {
+  boost::mutex::scoped_lock lruLock(_lruMutex);
+  return _budget;
+}
+
+void BufferPointRecord::setMemoryBudget(size_t bytes) {
+  {
+    boost::mutex::scoped_lock lruLock(_lruMutex);
+    _budget = bytes;
+  }
+  this->evictToBudget(++_operation);
+}
+
+BufferPointRecord::CacheStatistics BufferPointRecord::cacheStatistics() {
+  boost::mutex::scoped_lock lruLock(_lruMutex);
+  CacheStatistics stats;
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.evictions = _evictions;
+  stats.evictedPoints = _evictedPoints;
+  stats.bytes = _nAllocated * sizeof(Point);
+  stats.budget = _budget;
+  return stats;
+}
+
+void BufferPointRecord::resetCacheStatistics() {
+  boost::mutex::scoped_lock lruLock(_lruMutex);
+  _hits = 0;
+  _misses = 0;
+  _evictions = 0;
+  _evictedPoints = 0;
+}
+
+
 
 Point BufferPointRecord::firstPoint(const string& id) {
   Point foundPoint;
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(id);
-  if (it != _keyedBuffers.end()) {
-    PointBuffer_t& buffer = (it->second.circularBuffer);
+  handle_t handle = this->existingHandle(id);
+  ReadLock mapLock(_mapMutex);
+  Buffer* b = this->buffer(handle);
+  if (b) {
+    ReadLock seriesLock(*(b->mutex));
+    PointBuffer_t& buffer = (b->circularBuffer);
     if (buffer.empty()) {
       return foundPoint;
     }
@@ -339,11 +623,13 @@ Point BufferPointRecord::firstPoint(const string& id) {
 
 Point BufferPointRecord::lastPoint(const string& id) {
   Point foundPoint;
-  KeyedBufferMap_t::iterator it = _keyedBuffers.find(id);
-  if (it != _keyedBuffers.end()) {
+  handle_t handle = this->existingHandle(id);
+  ReadLock mapLock(_mapMutex);
+  Buffer* b = this->buffer(handle);
+  if (b) {
     // get the constituents
-    //boost::signals2::mutex *mutex = (it->second.second.get());
-    PointBuffer_t& buffer = (it->second.circularBuffer);
+    ReadLock seriesLock(*(b->mutex));
+    PointBuffer_t& buffer = (b->circularBuffer);
     
     if (buffer.empty()) {
       return foundPoint;
@@ -22,25 +22,62 @@
 #include "PointRecord.h"
 
 #include <boost/circular_buffer.hpp>
-#include <boost/signals2/mutex.hpp>
+#include <boost/icl/interval_set.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <list>
+#include <atomic>
 
 using std::string;
 
 namespace RTX {
   
+  /*!
+   \class BufferPointRecord
+   \brief An in-memory PointRecord, keyed by identifier.
+   
+   Alongside the points, each identifier keeps an index of the time ranges known to be complete: every point that exists within a covered range is in the buffer, so a covered range with no points is known to be empty. Adding an ordered vector of points covers the span from its first to its last point; addPointsInRange covers an explicit (possibly wider) range. Disjoint ranges are kept side by side.
+   
+   Memory is bounded per record rather than per series: a series' buffer grows as far as it is scanned, and when the record as a whole goes over its byte budget, the least recently used chunks (RTX_BUFFER_CHUNK_DURATION seconds of one series) are evicted, along with their coverage. The budget counts allocated buffer capacity, not just the points held, and a buffer is shrunk once eviction leaves most of it unused. Chunks touched by the operation in progress are never evicted by it, so a single long fetch may overshoot the budget until the next insertion.
+   
+   Each series has its own reader-writer lock, and the identifier map is only locked exclusively to register or reset everything. Reads of any series proceed concurrently, including reads of the same series; a write blocks only readers of the series it writes. The LRU order is bookkeeping shared by all series: a read that finds it busy skips its update rather than wait, so under heavy contention recency is approximate.
+   */
+  
+  /*!
+   \fn void BufferPointRecord::setMemoryBudget(size_t bytes)
+   \brief Set the byte budget for point storage allocated by this record. Zero means no limit.
+   */
+  
+  /*!
+   \fn std::vector<PointRecord::time_pair_t> BufferPointRecord::gapsInRange(const string& identifier, time_t start, time_t end)
+   \brief The parts of [start,end] that are not known to be complete, in order.
+   */
+  
   class BufferPointRecord : public PointRecord {
     
   public:
     
 //     types and small container for the actual buffers
     typedef boost::circular_buffer<Point> PointBuffer_t;
+    typedef boost::icl::interval_set<time_t> Coverage_t;
     class Buffer {
     public:
       Units units;
       PointBuffer_t circularBuffer;
+      Coverage_t coverage; // closed ranges known to be complete
+      boost::shared_ptr<boost::shared_mutex> mutex;
+    };
+    typedef boost::shared_ptr<Buffer> Buffer_sp;
+    typedef std::vector<Buffer_sp> BufferVector_t; // by handle
+    
+    class CacheStatistics {
+    public:
+      CacheStatistics() : hits(0), misses(0), evictions(0), evictedPoints(0), bytes(0), budget(0) {};
+      size_t hits, misses;  // reads answered entirely from memory, or not
+      size_t evictions, evictedPoints; // chunks, points
+      size_t bytes, budget; // bytes allocated for points, whether or not in use
     };
-    typedef std::map<std::string, Buffer> KeyedBufferMap_t;
-    typedef std::pair<std::string, Buffer> StringBufferPair;
     
     RTX_SHARED_POINTER(BufferPointRecord);
     BufferPointRecord(int defaultCapacity = RTX_BUFFER_DEFAULT_CACHESIZE);
@@ -54,7 +91,20 @@ namespace RTX {
     virtual Point pointAfter(const string& identifier, time_t time);
     virtual std::vector<Point> pointsInRange(const string& identifier, time_t startTime, time_t endTime);
     virtual void addPoint(const string& identifier, Point point);
-    virtual void addPoints(const string& identifier, std::vector<Point> points);
+    virtual void addPoints(const string& identifier, const std::vector<Point>& points);
+    void addPointsInRange(const string& identifier, const std::vector<Point>& points, time_t start, time_t end); // points are all there is in [start,end]
+    bool isCovered(const string& identifier, time_t start, time_t end);
+    std::vector<time_pair_t> gapsInRange(const string& identifier, time_t start, time_t end);
+    
+    virtual Point point(handle_t handle, time_t time);
+    virtual Point pointBefore(handle_t handle, time_t time);
+    virtual Point pointAfter(handle_t handle, time_t time);
+    virtual std::vector<Point> pointsInRange(handle_t handle, time_t startTime, time_t endTime);
+    virtual void addPoint(handle_t handle, Point point);
+    virtual void addPoints(handle_t handle, const std::vector<Point>& points);
+    void addPointsInRange(handle_t handle, const std::vector<Point>& points, time_t start, time_t end);
+    bool isCovered(handle_t handle, time_t start, time_t end);
+    std::vector<time_pair_t> gapsInRange(handle_t handle, time_t start, time_t end);
     virtual void reset();
     virtual void reset(const string& identifier);
     virtual Point firstPoint(const string& id);
@@ -63,13 +113,46 @@ namespace RTX {
     
     virtual std::ostream& toStream(std::ostream &stream);
     
+    size_t memoryBudget();
+    void setMemoryBudget(size_t bytes);
+    CacheStatistics cacheStatistics();
+    void resetCacheStatistics();
     
   protected:
     
   private:
-    KeyedBufferMap_t _keyedBuffers;
+    typedef std::pair<handle_t, time_t> ChunkKey_t; // series, chunk index
+    class Chunk {
+    public:
+      std::list<ChunkKey_t>::iterator lruPosition;
+      size_t lastTouch;
+    };
+    typedef std::map<ChunkKey_t, Chunk> ChunkMap_t;
+    
+    Buffer* buffer(handle_t handle); // NULL if not registered. caller holds _mapMutex.
+    void addOrdered(handle_t handle, const std::vector<Point>& ordered, time_t start, time_t end);
+    void insertOrdered(handle_t handle, Buffer& buffer, const std::vector<Point>& ordered, time_t start, time_t end, size_t operation);
+    template<class Iterator> void touch(handle_t handle, Iterator first, Iterator last, size_t operation);
+    template<class Iterator> void touchIfIdle(handle_t handle, Iterator first, Iterator last);
+    void evictToBudget(size_t operation);
+    void evictChunk(const ChunkKey_t& key);
+    size_t shrink(PointBuffer_t& buffer); // caller holds the series' write lock
+    
+    // lock order: _mapMutex, then a series' mutex, then _lruMutex.
+    // _mapMutex guards the _buffers vector itself; it is only locked exclusively to register or reset.
+    BufferVector_t _buffers;
+    boost::shared_mutex _mapMutex;
     size_t _defaultCapacity;
-    boost::signals2::mutex _bigMutex;
+    
+    // lru bookkeeping, most recent at the front. guarded by _lruMutex.
+    boost::mutex _lruMutex;
+    std::list<ChunkKey_t> _lru;
+    ChunkMap_t _chunks;
+    size_t _nAllocated, _budget; // points' worth of buffer capacity, bytes
+    size_t _evictions, _evictedPoints;
+    
+    std::atomic<size_t> _operation; // tells which chunks an operation touched
+    std::atomic<size_t> _hits, _misses;
   };
   
   std::ostream& operator<< (std::ostream &out, BufferPointRecord &pr);
@@ -131,18 +131,19 @@ time_t Clock::timeAfter(time_t time) {
   }
 }
 
-std::set< time_t > Clock::timeValuesInRange(TimeRange range) {
-  std::set<time_t> timeList;
-  if (!isValid(range.start)) {
-    range.start = timeAfter(range.start);
-  }
-  for (time_t thisTime = range.start; thisTime <= range.end; thisTime = timeAfter(thisTime)) {
-    if (thisTime == 0) {
-      break;
-    }
-    timeList.insert(thisTime);
-  }
-  return timeList;
+TimeGrid Clock::timeValuesInRange(TimeRange range) {
+  if (!_isRegular || period() <= 0) {
+    return TimeGrid();
+  }
+  time_t first = range.start;
+  if (!isValid(first)) {
+    first = timeAfter(first);
+  }
+  if (first == 0 || first > range.end) {
+    return TimeGrid();
+  }
+  size_t count = (size_t)((range.end - first) / period()) + 1;
+  return TimeGrid(first, period(), count);
 }
 
 
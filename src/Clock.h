@@ -14,6 +14,7 @@
 #include <set>
 #include "rtxMacros.h"
 #include "TimeRange.h"
+#include "TimeGrid.h"
 
 namespace RTX {
   
@@ -69,11 +70,10 @@ namespace RTX {
    \param time A time value.
    \return A unix-time value representing the previous step in the pattern.
    
-   \fn std::vector<time_t> Clock::timeValuesInRange(time_t start, time_t end)
+   \fn TimeGrid Clock::timeValuesInRange(TimeRange range)
    \brief Get a list of time values that are valid within a range.
-   \param start A range start time.
-   \param end A range end time.
-   \return A vector of time_t values that are valid for this clock within the specified range.
+   \param range The time range.
+   \return A regular TimeGrid of the time values that are valid for this clock within the specified range. Nothing is allocated per time value.
    
    */
   
@@ -101,7 +101,7 @@ namespace RTX {
     void setPeriod(int p);
     time_t start();
     void setStart(time_t startTime);
-    virtual std::set< time_t > timeValuesInRange(TimeRange range);
+    virtual TimeGrid timeValuesInRange(TimeRange range);
     virtual std::ostream& toStream(std::ostream &stream);
     
   private:
@@ -79,15 +79,28 @@ void CorrelatorTimeSeries::setLagSeconds(int nSeconds) {
 
 #pragma mark - superclass overrides
 
-TimeSeries::PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange range) {
-  
-  PointCollection data(vector<Point>(), this->units());
-  if (!this->correlatorTimeSeries() || !this->source()) {
-    return data;
+std::vector<TimeSeries::_sp> CorrelatorTimeSeries::upstreamSeries() {
+  std::vector<TimeSeries::_sp> upstream = TimeSeriesFilter::upstreamSeries();
+  if (this->correlatorTimeSeries()) {
+    upstream.push_back(this->correlatorTimeSeries());
+  }
+  return upstream;
+}
+
+TimeRange CorrelatorTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || !this->correlatorTimeSeries() || !this->source()) {
+    return TimeRange();
   }
   
   // force pre-cache
   TimeRange preFetchRange(range.start - this->correlationWindow()->period(), range.end + _lagSeconds);
+  if (upstream == this->source()) {
+    return preFetchRange;
+  }
+  if (upstream != this->correlatorTimeSeries()) {
+    return TimeRange();
+  }
+  
   TimeRange correlatorFetchRange = preFetchRange;
   // widen for inclusion of lags
   time_t correlatorPrior = correlatorFetchRange.start - this->lagSeconds();
@@ -96,6 +109,19 @@ TimeSeries::PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange
   correlatorFetchRange.start = this->correlatorTimeSeries()->timeBefore(correlatorPrior + 1);
   correlatorFetchRange.end = this->correlatorTimeSeries()->timeAfter(correlatorNext - 1);
   correlatorFetchRange.correctWithRange(TimeRange(correlatorPrior,correlatorNext)); // get rid of zero-range
+  return correlatorFetchRange;
+}
+
+
+TimeSeries::PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange range) {
+  
+  PointCollection data(vector<Point>(), this->units());
+  if (!this->correlatorTimeSeries() || !this->source()) {
+    return data;
+  }
+  
+  TimeRange preFetchRange = this->upstreamRange(this->source(), range);
+  TimeRange correlatorFetchRange = this->upstreamRange(this->correlatorTimeSeries(), range);
   
   PointCollection m_primaryCollection = this->source()->pointCollection(preFetchRange);
   PointCollection m_secondaryCollection = this->correlatorTimeSeries()->pointCollection(correlatorFetchRange);
@@ -104,7 +130,7 @@ TimeSeries::PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange
   TimeSeries::_sp sourceTs = this->source();
   time_t windowWidth = this->correlationWindow()->period();
   
-  set<time_t> sampleTimes;
+  TimeGrid sampleTimes;
   if (this->clock()) {
     sampleTimes = this->clock()->timeValuesInRange(range);
   }
@@ -119,9 +145,9 @@ TimeSeries::PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange
     TimeRange q(t-windowWidth, t);
     PointCollection sourceCollection = m_primaryCollection.trimmedToRange(q); //sourceTs->pointCollection(q);
     
-    set<time_t> sourceTimeValues = sourceCollection.times();
+    TimeGrid sourceTimeValues = sourceCollection.times();
     
-    set<time_t> lagEvaluationTimes = m_primaryCollection.trimmedToRange(TimeRange(t - _lagSeconds, t + _lagSeconds)).times();
+    TimeGrid lagEvaluationTimes = m_primaryCollection.trimmedToRange(TimeRange(t - _lagSeconds, t + _lagSeconds)).times();
     if (lagEvaluationTimes.size() == 0) {
       continue; // next time.
     }
@@ -184,7 +210,7 @@ TimeSeries::PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange
     
   }
   
-  return PointCollection(thePoints, RTX_DIMENSIONLESS);
+  return PointCollection(std::move(thePoints), RTX_DIMENSIONLESS);
 }
 
 bool CorrelatorTimeSeries::canSetSource(TimeSeries::_sp ts) {
@@ -38,6 +38,8 @@ namespace RTX {
     
   protected:
     PointCollection filterPointsInRange(TimeRange range);
+    std::vector<TimeSeries::_sp> upstreamSeries();
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     bool canSetSource(TimeSeries::_sp ts);
     void didSetSource(TimeSeries::_sp ts);
     bool canChangeToUnits(Units units);
@@ -11,6 +11,9 @@
 #include <sstream>
 #include <set>
 #include <vector>
+#include <utility>
+#include <algorithm>
+#include <iterator>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <string>
@@ -52,25 +55,14 @@ std::string DbPointRecord::Query::nameAndWhereClause() {
   return ss.str();
 }
 
-DbPointRecord::request_t::request_t(string id, time_t start, time_t end) : id(id), range(make_pair(start, end)) {
-  
-}
-
-bool DbPointRecord::request_t::contains(std::string id, time_t t) {
-  if (this->range.first <= t && t <= this->range.second && RTX_STRINGS_ARE_EQUAL(id, this->id)) {
-    return true;
-  }
-  return false;
-}
-
-
-
-DbPointRecord::DbPointRecord() : request("",0,0) {
+DbPointRecord::DbPointRecord() {
   _searchDistance = 60*60*24*7; // 1-week
+  _lookaheadDistance = 60*60*12;
   errorMessage = "Not Connected";
   _readOnly = false;
   _filterType = OpcPassThrough;
   _identifiersAndUnitsCache = std::map<std::string,Units>();
+  this->setMaxConcurrentReads(1); // one connection, one reader. raise this for backends that can take more.
 }
 
 
@@ -174,77 +166,81 @@ time_t DbPointRecord::searchDistance() {
   return _searchDistance;
 }
 
+void DbPointRecord::setLookaheadDistance(time_t time) {
+  _lookaheadDistance = time;
+}
+
+time_t DbPointRecord::lookaheadDistance() {
+  return _lookaheadDistance;
+}
+
+
+// by name: look up the handle once, then the same as below.
 
 Point DbPointRecord::point(const string& id, time_t time) {
+  return this->point(this->handleForIdentifier(id), time);
+}
+
+Point DbPointRecord::pointBefore(const string& id, time_t time) {
+  return this->pointBefore(this->handleForIdentifier(id), time);
+}
+
+Point DbPointRecord::pointAfter(const string& id, time_t time) {
+  return this->pointAfter(this->handleForIdentifier(id), time);
+}
+
+std::vector<Point> DbPointRecord::pointsInRange(const string& id, time_t startTime, time_t endTime) {
+  return this->pointsInRange(this->handleForIdentifier(id), startTime, endTime);
+}
+
+void DbPointRecord::addPoint(const string& id, Point point) {
+  this->addPoint(this->handleForIdentifier(id), point);
+}
+
+void DbPointRecord::addPoints(const string& id, const std::vector<Point>& points) {
+  this->addPoints(this->handleForIdentifier(id), points);
+}
+
+
+Point DbPointRecord::point(handle_t handle, time_t time) {
   
-  Point p = DB_PR_SUPER::point(id, time);
+  Point p = DB_PR_SUPER::point(handle, time);
   
   if (!p.isValid) {
     
-    // see if we just asked the db for something in this range.
-    // if so, and Super couldn't find it, then it's just not here.
+    // if we already know everything about this time, and Super couldn't find it, then it's just not here.
     // todo -- check staleness
     
-    if (request.contains(id, time)) {
+    if (DB_PR_SUPER::isCovered(handle, time, time)) {
       return Point();
     }
     
+    // fetch (and cache) the neighborhood, so that nearby requests are served from memory.
     time_t margin = 60*60*12;
-    time_t start = time - margin, end = time + margin;
-    
-    // do the request, and cache the request parameters.
+    vector<Point> pVec = this->pointsInRange(handle, time - margin, time + margin);
     
-    vector<Point> pVec = this->selectRange(id, start, end);
-    pVec = this->pointsWithOpcFilter(pVec);
-    
-    if (pVec.size() > 0) {
-      request = request_t(id, pVec.front().time, pVec.back().time);
-    }
-    else {
-      request = request_t(id,0,0);
-    }
-    
-    
-    vector<Point>::const_iterator pIt = pVec.begin();
-    while (pIt != pVec.end()) {
-      if (pIt->time == time) {
-        p = *pIt;
-      }
-      else if (pIt->time > time) {
-        break;
-      }
-      ++pIt;
+    vector<Point>::const_iterator pIt = lower_bound(pVec.begin(), pVec.end(), Point(time, 0), &Point::comparePointTime);
+    if (pIt != pVec.end() && pIt->time == time) {
+      p = *pIt;
     }
-    // cache this latest result set
-    DB_PR_SUPER::addPoints(id, pVec);
   }
   
-  
-  
   return p;
 }
 
 
-Point DbPointRecord::pointBefore(const string& id, time_t time) {
+Point DbPointRecord::pointBefore(handle_t handle, time_t time) {
   
-  Point p = DB_PR_SUPER::pointBefore(id, time);
+  Point p = DB_PR_SUPER::pointBefore(handle, time);
   
   if (!p.isValid) {
-    // check if last request covered before
-    if (request.contains(id, time-1)) {
-      return Point();
-    }
-    PointRecord::time_pair_t range = DB_PR_SUPER::range(id);
-    request = request_t(id, time, time);
-    p = this->selectPrevious(id, time);
+    p = this->selectPrevious(this->identifierForHandle(handle), time);
     p = this->pointWithOpcFilter(p);
     
-    if (range.first <= time && time <= range.second) {
-      // then we know this is continuous. add the point.
-      DB_PR_SUPER::addPoint(id, p);
-    }
-    else {
-      request = request_t("",0,0);
+    if (p.isValid && p.time < time) {
+      // nothing lies between this point and the requested time: remember that.
+      boost::mutex::scoped_lock lock(_inFlightMutex);
+      DB_PR_SUPER::addPointsInRange(handle, vector<Point>(1, p), p.time, time - 1);
     }
   }
   
@@ -252,34 +248,24 @@ Point DbPointRecord::pointBefore(const string& id, time_t time) {
 }
 
 
-Point DbPointRecord::pointAfter(const string& id, time_t time) {
+Point DbPointRecord::pointAfter(handle_t handle, time_t time) {
   
-  Point p = DB_PR_SUPER::pointAfter(id, time);
+  Point p = DB_PR_SUPER::pointAfter(handle, time);
   
   if (!p.isValid) {
     // lookahead prefetching
-    time_t distance = 60*60*12;
-    this->pointsInRange(id, time, time + distance);
-    p = DB_PR_SUPER::pointAfter(id, time);
+    this->pointsInRange(handle, time, time + _lookaheadDistance);
+    p = DB_PR_SUPER::pointAfter(handle, time);
   }
   
-  
   if (!p.isValid) {
-    // check if last request covered after
-    if (request.contains(id, time+1)) {
-      return Point();
-    }
-    PointRecord::time_pair_t range = DB_PR_SUPER::range(id);
-    request = request_t(id, time, time);
-    p = this->selectNext(id, time);
+    p = this->selectNext(this->identifierForHandle(handle), time);
     p = this->pointWithOpcFilter(p);
     
-    if (range.first <= time && time <= range.second) {
-      // then we know this is continuous. add the point.
-      DB_PR_SUPER::addPoint(id, p);
-    }
-    else {
-      request = request_t("",0,0);
+    if (p.isValid && p.time > time) {
+      // nothing lies between the requested time and this point: remember that.
+      boost::mutex::scoped_lock lock(_inFlightMutex);
+      DB_PR_SUPER::addPointsInRange(handle, vector<Point>(1, p), time + 1, p.time);
     }
   }
   
@@ -287,79 +273,256 @@ Point DbPointRecord::pointAfter(const string& id, time_t time) {
 }
 
 
-std::vector<Point> DbPointRecord::pointsInRange(const string& id, time_t startTime, time_t endTime) {
+std::vector<Point> DbPointRecord::pointsInRange(handle_t handle, time_t startTime, time_t endTime) {
   
-  PointRecord::time_pair_t range = DB_PR_SUPER::range(id);
+  // only query the parts of the range we don't already know about.
+  vector<PointRecord::time_pair_t> gaps = DB_PR_SUPER::gapsInRange(handle, startTime, endTime);
+  if (gaps.empty()) {
+    return DB_PR_SUPER::pointsInRange(handle, startTime, endTime);
+  }
+  const string id = this->identifierForHandle(handle); // the database only knows names
+  
+  // what we have, plus what we fetch. the buffer only holds points within covered ranges,
+  // so the two never overlap. assemble the result here rather than reading it back from
+  // the buffer, in case the new points push older ones out.
+  vector<Point> cached;
+  vector<Point> fetched;
+  
+  vector<InFlight_sp> claims;
+  vector< pair<InFlight_sp, PointRecord::time_pair_t> > theirs;
+  {
+    boost::mutex::scoped_lock lock(_inFlightMutex);
+    cached = DB_PR_SUPER::pointsInRange(handle, startTime, endTime);
+    this->claimGaps(handle, startTime, endTime, claims, theirs);
+  }
   
-  // if the requested range is not in memcache, then fetch it.
-  if ( !(range.first <= startTime && endTime <= range.second) ) {
-    vector<Point> left;
-    vector<Point> right;
-    
-    time_t qstart, qend;
-    if (startTime < range.first && endTime < range.second  && endTime > range.first) {
-      // left-fill query
-      qstart = startTime;
-      qend = range.first;
-      right = DB_PR_SUPER::pointsInRange(id, range.first, endTime);
+  // db hits, for our pieces.
+  for (size_t i = 0; i < claims.size(); ++i) {
+    boost::shared_ptr< vector<Point> > newPoints;
+    try {
+      vector<Point> selected = this->selectRange(id, claims[i]->range.first, claims[i]->range.second);
+      newPoints.reset(new vector<Point>(this->cacheSelected(handle, std::move(selected), claims[i]->range.first, claims[i]->range.second)));
+    } catch (...) {
+      // don't leave anyone waiting on a query that isn't coming.
+      this->abandonClaims(claims);
+      throw;
     }
-    else if (range.first < startTime && range.second < endTime && startTime < range.second ) {
-      // right-fill query
-      qstart = range.second;
-      qend = endTime;
-      left = DB_PR_SUPER::pointsInRange(id, startTime, range.second);
+    fetched.insert(fetched.end(), newPoints->begin(), newPoints->end());
+    this->finishClaim(claims[i], newPoints);
+  }
+  
+  // then share in everyone else's.
+  for (size_t i = 0; i < theirs.size(); ++i) {
+    const InFlight_sp& f = theirs[i].first;
+    const PointRecord::time_pair_t& piece = theirs[i].second;
+    boost::shared_ptr< vector<Point> > shared;
+    {
+      boost::mutex::scoped_lock lock(_inFlightMutex);
+      while (!f->done) {
+        _inFlightCondition.wait(lock);
+      }
+      shared = f->points;
     }
-    else {
-      // full overlap -- todo - generate two queries...
-      qstart = startTime;
-      qend = endTime;
+    if (!shared) {
+      // their select failed; try it ourselves.
+      vector<Point> newPoints = this->cacheSelected(handle, this->selectRange(id, piece.first, piece.second), piece.first, piece.second);
+      fetched.insert(fetched.end(), newPoints.begin(), newPoints.end());
+      continue;
     }
-    // db hit
-    vector<Point> newPoints = this->selectRange(id, qstart, qend);
-    newPoints = this->pointsWithOpcFilter(newPoints);
-    
-    vector<Point> merged;
-    merged.reserve(newPoints.size() + left.size() + right.size());
-    merged.insert(merged.end(), left.begin(), left.end());
-    merged.insert(merged.end(), newPoints.begin(), newPoints.end());
-    merged.insert(merged.end(), right.begin(), right.end());
-
-    set<time_t> addedTimes;
-    vector<Point> deDuped;
-    deDuped.reserve(merged.size());
-    BOOST_FOREACH(const Point& p, merged) {
-      if (addedTimes.count(p.time) == 0) {
-        addedTimes.insert(p.time);
-        if (startTime <= p.time && p.time <= endTime) {
-          deDuped.push_back(p);
+    vector<Point>::const_iterator from = lower_bound(shared->cbegin(), shared->cend(), Point(piece.first, 0), &Point::comparePointTime);
+    vector<Point>::const_iterator to = upper_bound(from, shared->cend(), Point(piece.second, 0), &Point::comparePointTime);
+    fetched.insert(fetched.end(), from, to);
+  }
+  
+  if (!std::is_sorted(fetched.begin(), fetched.end(), &Point::comparePointTime)) {
+    std::sort(fetched.begin(), fetched.end(), &Point::comparePointTime);
+  }
+  if (cached.empty()) {
+    return fetched;
+  }
+  
+  vector<Point> merged;
+  merged.reserve(cached.size() + fetched.size());
+  std::merge(cached.begin(), cached.end(), fetched.begin(), fetched.end(), back_inserter(merged), &Point::comparePointTime);
+  return merged;
+}
+
+
+void DbPointRecord::preFetchRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime) {
+  
+  // claim whatever isn't known or already on its way, for every series at once.
+  vector<string> batch;
+  vector<InFlight_sp> claims;
+  time_t batchStart = endTime, batchEnd = startTime;
+  {
+    boost::mutex::scoped_lock lock(_inFlightMutex);
+    BOOST_FOREACH(const string& id, ids) {
+      handle_t handle = this->existingHandle(id);
+      if (handle == RTX_NO_HANDLE) {
+        continue; // never registered here
+      }
+      vector< pair<InFlight_sp, PointRecord::time_pair_t> > theirs; // others will cache those
+      size_t nClaimed = claims.size();
+      this->claimGaps(handle, startTime, endTime, claims, theirs);
+      if (claims.size() > nClaimed) {
+        batch.push_back(id);
+        batchStart = min(batchStart, claims[nClaimed]->range.first);
+        batchEnd = max(batchEnd, claims.back()->range.second);
+      }
+    }
+  }
+  if (batch.empty()) {
+    return;
+  }
+  
+  // one round trip for the lot. each claim then takes its own piece.
+  map<string, vector<Point> > selected;
+  try {
+    selected = this->selectRanges(batch, batchStart, batchEnd);
+  } catch (...) {
+    this->abandonClaims(claims);
+    throw;
+  }
+  
+  BOOST_FOREACH(const InFlight_sp& claim, claims) {
+    const vector<Point>& points = selected[this->identifierForHandle(claim->handle)];
+    boost::shared_ptr< vector<Point> > newPoints(new vector<Point>(this->cacheSelected(claim->handle, points, claim->range.first, claim->range.second)));
+    this->finishClaim(claim, newPoints);
+  }
+}
+
+
+std::map<std::string, std::vector<Point> > DbPointRecord::selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime) {
+  // one query per series, for backends that can't do better.
+  map<string, vector<Point> > selected;
+  BOOST_FOREACH(const string& id, ids) {
+    selected[id] = this->selectRange(id, startTime, endTime);
+  }
+  return selected;
+}
+
+
+#pragma mark - Single-flight
+
+// caller holds _inFlightMutex. splits the gaps in a range into pieces someone else is already
+// selecting, and pieces we claim. a fetch lands in the buffer before it leaves the in-flight
+// list, and everything lands in the buffer under the lock, so under the lock every part of
+// the range is either covered (and read by the caller), in flight, or free.
+void DbPointRecord::claimGaps(handle_t handle, time_t startTime, time_t endTime, std::vector<InFlight_sp>& claims, std::vector< std::pair<InFlight_sp, PointRecord::time_pair_t> >& theirs) {
+  
+  vector<PointRecord::time_pair_t> gaps = DB_PR_SUPER::gapsInRange(handle, startTime, endTime);
+  
+  vector<InFlight_sp> overlapping;
+  BOOST_FOREACH(const InFlight_sp& f, _inFlight) {
+    if (f->handle == handle && f->range.first <= endTime && startTime <= f->range.second) {
+      overlapping.push_back(f);
+    }
+  }
+  
+  vector<PointRecord::time_pair_t> mine;
+  BOOST_FOREACH(const PointRecord::time_pair_t& gap, gaps) {
+    // claims never overlap each other, so walk this gap past each one in turn.
+    time_t cursor = gap.first;
+    bool more = true;
+    while (more) {
+      InFlight_sp next;
+      BOOST_FOREACH(const InFlight_sp& f, overlapping) {
+        if (f->range.second >= cursor && f->range.first <= gap.second && (!next || f->range.first < next->range.first)) {
+          next = f;
+        }
+      }
+      if (!next) {
+        mine.push_back(make_pair(cursor, gap.second));
+        more = false;
+      }
+      else {
+        if (cursor < next->range.first) {
+          mine.push_back(make_pair(cursor, next->range.first - 1));
         }
+        theirs.push_back(make_pair(next, make_pair(max(cursor, next->range.first), min(gap.second, next->range.second))));
+        more = (next->range.second < gap.second);
+        cursor = next->range.second + 1;
       }
     }
-    
-    request = (deDuped.size() > 0) ? request_t(id, deDuped.front().time, deDuped.back().time) : request_t(id,0,0);
-    
-    DB_PR_SUPER::addPoints(id, deDuped);
-    
-    return deDuped;
   }
   
-  return DB_PR_SUPER::pointsInRange(id, startTime, endTime);
+  BOOST_FOREACH(const PointRecord::time_pair_t& piece, mine) {
+    InFlight_sp claim(new InFlight);
+    claim->handle = handle;
+    claim->range = piece;
+    claim->done = false;
+    _inFlight.push_back(claim);
+    claims.push_back(claim);
+  }
+}
+
+
+void DbPointRecord::finishClaim(InFlight_sp claim, boost::shared_ptr< std::vector<Point> > points) {
+  boost::mutex::scoped_lock lock(_inFlightMutex);
+  claim->points = points;
+  claim->done = true;
+  _inFlight.erase(std::find(_inFlight.begin(), _inFlight.end(), claim));
+  _inFlightCondition.notify_all();
+}
+
+
+void DbPointRecord::abandonClaims(const std::vector<InFlight_sp>& claims) {
+  boost::mutex::scoped_lock lock(_inFlightMutex);
+  BOOST_FOREACH(const InFlight_sp& claim, claims) {
+    if (!claim->done) {
+      claim->done = true; // with no points: waiters select it themselves
+      _inFlight.erase(std::find(_inFlight.begin(), _inFlight.end(), claim));
+    }
+  }
+  _inFlightCondition.notify_all();
+}
+
+
+std::vector<Point> DbPointRecord::cacheSelected(handle_t handle, std::vector<Point> newPoints, time_t start, time_t end) {
+  newPoints = this->pointsWithOpcFilter(std::move(newPoints));
   
+  // de-dupe and trim in place
+  set<time_t> addedTimes;
+  size_t nKept = 0;
+  for (size_t i = 0; i < newPoints.size(); ++i) {
+    const time_t t = newPoints[i].time;
+    if (addedTimes.count(t) == 0) {
+      addedTimes.insert(t);
+      if (start <= t && t <= end) {
+        newPoints[nKept++] = newPoints[i];
+      }
+    }
+  }
+  newPoints.resize(nKept);
+  if (!std::is_sorted(newPoints.begin(), newPoints.end(), &Point::comparePointTime)) {
+    std::sort(newPoints.begin(), newPoints.end(), &Point::comparePointTime);
+  }
+  
+  // the range is now known, even if it's empty.
+  {
+    boost::mutex::scoped_lock lock(_inFlightMutex);
+    DB_PR_SUPER::addPointsInRange(handle, newPoints, start, end);
+  }
+  return newPoints;
 }
 
 
-void DbPointRecord::addPoint(const string& id, Point point) {
+void DbPointRecord::addPoint(handle_t handle, Point point) {
   if (!this->readonly()) {
-    DB_PR_SUPER::addPoint(id, point);
-    this->insertSingle(id, point);
+    DB_PR_SUPER::addPoint(handle, point);
+    this->insertSingle(this->identifierForHandle(handle), point);
   }
 }
 
 
-void DbPointRecord::addPoints(const string& id, std::vector<Point> points) {
+void DbPointRecord::addPoints(handle_t handle, const std::vector<Point>& points) {
   if (!this->readonly()) {
-    DB_PR_SUPER::addPoints(id, points);
-    this->insertRange(id, points);
+    {
+      // a write covers its span in the buffer: see claimGaps
+      boost::mutex::scoped_lock lock(_inFlightMutex);
+      DB_PR_SUPER::addPoints(handle, points);
+    }
+    this->insertRange(this->identifierForHandle(handle), points);
   }
 }
 
@@ -437,16 +600,17 @@ void DbPointRecord::removeOpcFilterCode(unsigned int code) {
 
 
 vector<Point> DbPointRecord::pointsWithOpcFilter(std::vector<Point> points) {
-  vector<Point> out;
-  
-  BOOST_FOREACH(Point p, points) {
-    Point outPoint = this->pointWithOpcFilter(p);
+  // filters in place; callers hand over their buffer with std::move.
+  size_t nKept = 0;
+  for (size_t i = 0; i < points.size(); ++i) {
+    Point outPoint = this->pointWithOpcFilter(points[i]);
     if (outPoint.isValid) {
-      out.push_back(outPoint);
+      points[nKept++] = outPoint;
     }
   }
+  points.resize(nKept);
   
-  return out;
+  return points;
 }
 
 Point DbPointRecord::pointWithOpcFilter(Point p) {
@@ -24,6 +24,10 @@ namespace RTX {
    
    Base class for database-connected PointRecord classes.
    
+   Ranges that are already known are served from the buffer. The rest are selected once: if another thread is already selecting an overlapping range of the same series, the caller waits for that query and shares its result instead of issuing its own.
+   
+   preFetchRanges() brings the same range of many series into the buffer with one selectRanges() call. The default selects each series in turn; subclasses override it to do the lot in a single query.
+   
    */
   
   class DbPointRecord : public DB_PR_SUPER {
@@ -60,7 +64,17 @@ namespace RTX {
     std::vector<Point> pointsInRange(const string& id, time_t startTime, time_t endTime);
     
     void addPoint(const string& id, Point point);
-    void addPoints(const string& id, std::vector<Point> points);
+    void addPoints(const string& id, const std::vector<Point>& points);
+    
+    Point point(handle_t handle, time_t time);
+    Point pointBefore(handle_t handle, time_t time);
+    Point pointAfter(handle_t handle, time_t time);
+    std::vector<Point> pointsInRange(handle_t handle, time_t startTime, time_t endTime);
+    void addPoint(handle_t handle, Point point);
+    void addPoints(handle_t handle, const std::vector<Point>& points);
+    
+    void preFetchRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime);
+    
     void reset();
     void reset(const string& id);
     virtual void invalidate(const string& identifier);
@@ -77,6 +91,8 @@ namespace RTX {
     // db searching prefs
     void setSearchDistance(time_t time);
     time_t searchDistance();
+    void setLookaheadDistance(time_t time); // how far past a missing pointAfter() to load
+    time_t lookaheadDistance();
     
     /*--------------------------------------------*/
     //! OPC quality filter :: blacklist / whitelist
@@ -98,7 +114,7 @@ namespace RTX {
     void removeOpcFilterCode(unsigned int code);
     
     Point pointWithOpcFilter(Point p);
-    std::vector<Point> pointsWithOpcFilter(std::vector<Point> points);
+    std::vector<Point> pointsWithOpcFilter(std::vector<Point> points); // filters in place: pass with std::move to avoid a copy
     
     
     
@@ -127,29 +143,41 @@ namespace RTX {
     virtual std::vector<Point> selectRange(const std::string& id, time_t startTime, time_t endTime)=0;
     virtual Point selectNext(const std::string& id, time_t time)=0;
     virtual Point selectPrevious(const std::string& id, time_t time)=0;
+    virtual std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime);
     
     // insertions or alterations: may choose to ignore / deny
     virtual void insertSingle(const std::string& id, Point point)=0;
-    virtual void insertRange(const std::string& id, std::vector<Point> points)=0;
+    virtual void insertRange(const std::string& id, const std::vector<Point>& points)=0;
     virtual void removeRecord(const std::string& id)=0;
     virtual bool insertIdentifierAndUnits(const std::string& id, Units units)=0;
     
     std::map<std::string,Units> _identifiersAndUnitsCache; /// for subs to use
     time_t _lastIdRequest;
     
-    class request_t {
+  private:
+    // a range of one series being selected right now
+    class InFlight {
     public:
+      handle_t handle;
       PointRecord::time_pair_t range;
-      std::string id;
-      request_t(std::string id, time_t start, time_t end);
-      bool contains(std::string id, time_t t);
+      bool done;
+      boost::shared_ptr< std::vector<Point> > points; // set when done; null if the select failed
     };
-    request_t request;
+    typedef boost::shared_ptr<InFlight> InFlight_sp;
     
+    // caller holds _inFlightMutex
+    void claimGaps(handle_t handle, time_t startTime, time_t endTime, std::vector<InFlight_sp>& claims, std::vector< std::pair<InFlight_sp, PointRecord::time_pair_t> >& theirs);
+    void finishClaim(InFlight_sp claim, boost::shared_ptr< std::vector<Point> > points);
+    void abandonClaims(const std::vector<InFlight_sp>& claims);
+    std::vector<Point> cacheSelected(handle_t handle, std::vector<Point> points, time_t start, time_t end); // filter, trim, and buffer
+    
+    std::vector<InFlight_sp> _inFlight;
+    boost::mutex _inFlightMutex;
+    boost::condition_variable _inFlightCondition;
     
-  private:
     std::string _connectionString;
     time_t _searchDistance;
+    time_t _lookaheadDistance;
     bool _readOnly;
     std::set<unsigned int> _opcFilterCodes;
     OpcFilterType _filterType;
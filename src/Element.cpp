@@ -8,11 +8,15 @@
 
 #include "Element.h"
 
+#include <math.h>
+
 using namespace RTX;
 
 Element::Element(const std::string& name) {
   setName(name);
   setUserDescription("");
+  _engineIndex = -1;
+  _stateOrdinal = -1;
 }
 Element::~Element() {
   
@@ -33,6 +37,31 @@ std::string Element::userDescription() {
   return _userDescription;
 }
 
+int Element::engineIndex() {
+  return _engineIndex;
+}
+
+void Element::setEngineIndex(int index) {
+  _engineIndex = index;
+}
+
+double Element::state(NetworkStateFrames::state_t state) {
+  NetworkStateFrames::Frame* frame = _stateFrames ? _stateFrames->latestFrame() : NULL;
+  if (!frame) {
+    return NAN;
+  }
+  return frame->value(this->type(), state, _stateOrdinal);
+}
+
+void Element::setStateFrames(NetworkStateFrames::_sp frames, int ordinal) {
+  _stateFrames = frames;
+  _stateOrdinal = ordinal;
+}
+
+int Element::stateOrdinal() {
+  return _stateOrdinal;
+}
+
 Element::element_t Element::type() {
   return _type;
 }
@@ -14,6 +14,7 @@
 #include "rtxMacros.h"
 #include "TimeSeries.h"
 #include "PointRecord.h"
+#include "NetworkStateFrames.h"
 
 
 namespace RTX {
@@ -48,6 +49,15 @@ namespace RTX {
     std::string userDescription();
     void setUserDescription(const std::string& description);
     
+    // position of this element in the simulation engine, so that models can skip name lookups. -1 until a model assigns one.
+    int engineIndex();
+    void setEngineIndex(int index);
+    
+    // latest simulated value of a state, read from the state frames of the model this element belongs to. NAN until a model has fetched one.
+    double state(NetworkStateFrames::state_t state);
+    void setStateFrames(NetworkStateFrames::_sp frames, int ordinal);
+    int stateOrdinal();
+    
   protected:
     Element(const std::string& name);
     virtual ~Element();
@@ -57,6 +67,9 @@ namespace RTX {
     std::string _name;
     element_t _type;
     std::string _userDescription;
+    int _engineIndex;
+    NetworkStateFrames::_sp _stateFrames;
+    int _stateOrdinal;
   };
   
   std::ostream& operator<< (std::ostream &out, Element &e);
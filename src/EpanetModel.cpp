@@ -146,18 +146,26 @@ void EpanetModel::useEpanetFile(const std::string& filename) {
     OW_API_CHECK( OW_getnodeid(_enModel, iNode, enName), "OW_getnodeid" );
     // and keep track of the epanet-toolkit index of this element
     _nodeIndex[string(enName)] = iNode;
+    Node::_sp existing = this->nodeWithName(string(enName));
+    if (existing) {
+      existing->setEngineIndex(iNode);
+    }
   }
   
   for (int iLink = 1; iLink <= linkCount; iLink++) {
     OW_API_CHECK(OW_getlinkid(_enModel, iLink, enName), "OW_getlinkid");
     // keep track of this element index
     _linkIndex[string(enName)] = iLink;
+    Link::_sp existing = this->linkWithName(string(enName));
+    if (existing) {
+      existing->setEngineIndex(iLink);
+    }
   }
   
   
   // get the valve types
   BOOST_FOREACH(Valve::_sp v, this->valves()) {
-    int enIdx = _linkIndex[v->name()];
+    int enIdx = this->linkIndex(*v);
     EN_LinkType type = EN_PIPE;
     OW_getlinktype(_enModel, enIdx, &type);
     if (type == EN_PIPE) {
@@ -326,6 +334,8 @@ void EpanetModel::createRtxWrappers() {
         throw "Node Type Unknown";
     } // switch nodeType
     
+    newJunction->setEngineIndex(iNode);
+    
     // set units for new element
     newJunction->head()->setUnits(headUnits());
     newJunction->pressure()->setUnits(pressureUnits());
@@ -429,6 +439,7 @@ void EpanetModel::createRtxWrappers() {
     
     
     // now that the pipe is created, set some basic properties.
+    newPipe->setEngineIndex(iLink);
     newPipe->setDiameter(diameter);
     newPipe->setLength(length);
     newPipe->setRoughness(rough);
@@ -505,21 +516,21 @@ std::ostream& EpanetModel::toStream(std::ostream &stream) {
 
 /* setting simulation parameters */
 
-void EpanetModel::setReservoirHead(const string& reservoir, double level) {
-  setNodeValue(EN_TANKLEVEL, reservoir, level);
+void EpanetModel::setReservoirHead(const Reservoir::_sp& reservoir, double level) {
+  setNodeValue(EN_TANKLEVEL, *reservoir, level);
 }
 
-void EpanetModel::setReservoirQuality(const string& reservoir, double quality) {
-  setNodeValue(EN_SOURCEQUAL, reservoir, quality);
+void EpanetModel::setReservoirQuality(const Reservoir::_sp& reservoir, double quality) {
+  setNodeValue(EN_SOURCEQUAL, *reservoir, quality);
 }
 
-void EpanetModel::setTankLevel(const string& tank, double level) {
-  // just refer to the reservoir method, since in epanet they are the same thing.
-  setReservoirHead(tank, level);
+void EpanetModel::setTankLevel(const Tank::_sp& tank, double level) {
+  // same as the reservoir method, since in epanet they are the same thing.
+  setNodeValue(EN_TANKLEVEL, *tank, level);
 }
 
-void EpanetModel::setJunctionDemand(const string& junction, double demand) {
-  int nodeIndex = _nodeIndex[junction];
+void EpanetModel::setJunctionDemand(const Junction::_sp& junction, double demand) {
+  int nodeIndex = this->nodeIndex(*junction);
   // Junction demand is total demand - so deal with multiple categories
   int numDemands = 0;
   OW_API_CHECK( OW_getnumdemands(_enModel, nodeIndex, &numDemands), "OW_getnumdemands()");
@@ -530,68 +541,119 @@ void EpanetModel::setJunctionDemand(const string& junction, double demand) {
   OW_API_CHECK( OW_setbasedemand(_enModel, nodeIndex, numDemands, demand), "OW_setbasedemand()" );
 }
 
-void EpanetModel::setJunctionQuality(const std::string& junction, double quality) {
+void EpanetModel::setJunctionQuality(const Junction::_sp& junction, double quality) {
   // todo - add more source types, depending on time series dimension?
-  setNodeValue(EN_SOURCETYPE, junction, SETPOINT);
-  setNodeValue(EN_SOURCEQUAL, junction, quality);
+  setNodeValue(EN_SOURCETYPE, *junction, SETPOINT);
+  setNodeValue(EN_SOURCEQUAL, *junction, quality);
 }
 
-void EpanetModel::setPipeStatus(const string& pipe, Pipe::status_t status) {
-  setLinkValue(EN_STATUS, pipe, status);
+void EpanetModel::setPipeStatus(const Pipe::_sp& pipe, Pipe::status_t status) {
+  setLinkValue(EN_STATUS, *pipe, status);
 }
 
-void EpanetModel::setPumpStatus(const string& pump, Pipe::status_t status) {
-  // call the setPipeStatus method, since they are the same in epanet.
-  setPipeStatus(pump, status);
+void EpanetModel::setPumpStatus(const Pump::_sp& pump, Pipe::status_t status) {
+  // same as the setPipeStatus method, since they are the same in epanet.
+  setLinkValue(EN_STATUS, *pump, status);
 }
 
-void EpanetModel::setPumpSetting(const string& pump, double setting) {
-  setLinkValue(EN_SETTING, pump, setting);
+void EpanetModel::setPumpSetting(const Pump::_sp& pump, double setting) {
+  setLinkValue(EN_SETTING, *pump, setting);
 }
 
-void EpanetModel::setValveSetting(const string& valve, double setting) {
-  setLinkValue(EN_SETTING, valve, setting);
+void EpanetModel::setValveSetting(const Valve::_sp& valve, double setting) {
+  setLinkValue(EN_SETTING, *valve, setting);
 }
 
 #pragma mark Getters
 
-double EpanetModel::junctionDemand(const string &junction) {
-  return getNodeValue(EN_DEMAND, junction);
+double EpanetModel::junctionDemand(const Junction::_sp& junction) {
+  return getNodeValue(EN_DEMAND, *junction);
+}
+
+double EpanetModel::junctionHead(const Junction::_sp& junction) {
+  return getNodeValue(EN_HEAD, *junction);
+}
+double EpanetModel::junctionPressure(const Junction::_sp& junction) {
+  return getNodeValue(EN_PRESSURE, *junction);
 }
 
-double EpanetModel::junctionHead(const string &junction) {
-  return getNodeValue(EN_HEAD, junction);
+double EpanetModel::junctionQuality(const Junction::_sp& junction) {
+  return getNodeValue(EN_QUALITY, *junction);
 }
-double EpanetModel::junctionPressure(const string &junction) {
-  return getNodeValue(EN_PRESSURE, junction);
+
+double EpanetModel::reservoirLevel(const Reservoir::_sp& reservoir) {
+  return getNodeValue(EN_TANKLEVEL, *reservoir);
 }
 
-double EpanetModel::junctionQuality(const string &junction) {
-  return getNodeValue(EN_QUALITY, junction);
+double EpanetModel::tankLevel(const Tank::_sp& tank) {
+  return getNodeValue(EN_HEAD, *tank) - tank->elevation(); // node elevation & head in same Epanet units
 }
 
-double EpanetModel::reservoirLevel(const string &reservoir) {
-  return getNodeValue(EN_TANKLEVEL, reservoir);
+double EpanetModel::tankVolume(const Tank::_sp& tank) {
+  return getNodeValue(EN_TANKVOLUME, *tank);
 }
 
-double EpanetModel::tankLevel(const string &tank) {
-  return junctionHead(tank) - nodeWithName(tank)->elevation(); // node elevation & head in same Epanet units
+double EpanetModel::tankFlow(const Tank::_sp& tank) {
+  return getNodeValue(EN_DEMAND, *tank);
 }
 
-double EpanetModel::tankVolume(const string& tank) {
-  return getNodeValue(EN_TANKVOLUME, tank);
+double EpanetModel::pipeFlow(const Pipe::_sp& pipe) {
+  return getLinkValue(EN_FLOW, *pipe);
 }
 
-double EpanetModel::tankFlow(const string& tank) {
-  return getNodeValue(EN_DEMAND, tank);
+double EpanetModel::pumpEnergy(const Pump::_sp& pump) {
+  return getLinkValue(EN_ENERGY, *pump);
 }
 
-double EpanetModel::pipeFlow(const string &pipe) {
-  return getLinkValue(EN_FLOW, pipe);
+#pragma mark Bulk
+
+void EpanetModel::getNodeValues(int epanetCode, std::vector<double>& values) {
+  int nodeCount;
+  OW_API_CHECK( OW_getcount(_enModel, EN_NODECOUNT, &nodeCount), "OW_getcount EN_NODECOUNT" );
+  values.resize(nodeCount + 1);
+  values[0] = 0;
+  for (int iNode = 1; iNode <= nodeCount; iNode++) {
+    OW_API_CHECK(OW_getnodevalue(_enModel, iNode, epanetCode, &values[iNode]), "OW_getnodevalue");
+  }
 }
 
-double EpanetModel::pumpEnergy(const string &pump) {
-  return getLinkValue(EN_ENERGY, pump);
+void EpanetModel::getLinkValues(int epanetCode, std::vector<double>& values) {
+  int linkCount;
+  OW_API_CHECK( OW_getcount(_enModel, EN_LINKCOUNT, &linkCount), "OW_getcount EN_LINKCOUNT" );
+  values.resize(linkCount + 1);
+  values[0] = 0;
+  for (int iLink = 1; iLink <= linkCount; iLink++) {
+    OW_API_CHECK(OW_getlinkvalue(_enModel, iLink, epanetCode, &values[iLink]), "OW_getlinkvalue");
+  }
+}
+
+bool EpanetModel::engineStates(engineState_t state, std::vector<double>& values) {
+  switch (state) {
+    case NodeHead:
+      this->getNodeValues(EN_HEAD, values);
+      break;
+    case NodePressure:
+      this->getNodeValues(EN_PRESSURE, values);
+      break;
+    case NodeDemand:
+      this->getNodeValues(EN_DEMAND, values);
+      break;
+    case NodeQuality:
+      this->getNodeValues(EN_QUALITY, values);
+      break;
+    case LinkFlow:
+      this->getLinkValues(EN_FLOW, values);
+      break;
+    default:
+      return false;
+  }
+  return true;
+}
+
+void EpanetModel::setPipeStatuses(const std::vector<Pipe::_sp>& pipes, const std::vector<Pipe::status_t>& statuses) {
+  for (size_t i = 0; i < pipes.size(); ++i) {
+    OW_API_CHECK(OW_setlinkvalue(_enModel, this->linkIndex(*pipes[i]), EN_STATUS, statuses[i]), "OW_setlinkvalue");
+  }
 }
 
 #pragma mark - Sim options
@@ -832,14 +894,14 @@ void EpanetModel::applyInitialQuality() {
   // Junctions
   BOOST_FOREACH(Junction::_sp junc, this->junctions()) {
     double qual = junc->initialQuality();
-    int iNode = _nodeIndex[junc->name()];
+    int iNode = this->nodeIndex(*junc);
     OW_API_CHECK(OW_setnodevalue(_enModel, iNode, EN_INITQUAL, qual), "OW_setnodevalue - EN_INITQUAL");
   }
   
   // Tanks
   BOOST_FOREACH(Tank::_sp tank, this->tanks()) {
     double qual = tank->initialQuality();
-    int iNode = _nodeIndex[tank->name()];
+    int iNode = this->nodeIndex(*tank);
     OW_API_CHECK(OW_setnodevalue(_enModel, iNode, EN_INITQUAL, qual), "OW_setnodevalue - EN_INITQUAL");
   }
   
@@ -856,15 +918,15 @@ void EpanetModel::updateEngineWithElementProperties(Element::_sp e) {
     case Element::TANK:
     {
       Tank::_sp t = boost::dynamic_pointer_cast<Tank>(e);
-      this->setNodeValue(EN_MINLEVEL, t->name(), t->minLevel());
-      this->setNodeValue(EN_MAXLEVEL, t->name(), t->maxLevel());
+      this->setNodeValue(EN_MINLEVEL, *t, t->minLevel());
+      this->setNodeValue(EN_MAXLEVEL, *t, t->maxLevel());
     }
     case Element::JUNCTION:
     case Element::RESERVOIR:
     {
       Junction::_sp j = boost::dynamic_pointer_cast<Junction>(e);
-      this->setNodeValue(EN_ELEVATION, j->name(), j->elevation());
-      this->setNodeValue(EN_BASEDEMAND, j->name(), j->baseDemand());
+      this->setNodeValue(EN_ELEVATION, *j, j->elevation());
+      this->setNodeValue(EN_BASEDEMAND, *j, j->baseDemand());
       this->setComment(j, j->userDescription());
     }
       
@@ -878,10 +940,10 @@ void EpanetModel::updateEngineWithElementProperties(Element::_sp e) {
     case Element::PIPE:
     {
       Pipe::_sp p = boost::dynamic_pointer_cast<Pipe>(e);
-      this->setLinkValue(EN_DIAMETER, p->name(), p->diameter());
-      this->setLinkValue(EN_ROUGHNESS, p->name(), p->roughness());
-      this->setLinkValue(EN_LENGTH, p->name(), p->length());
-      this->setLinkValue(EN_STATUS, p->name(), p->fixedStatus());
+      this->setLinkValue(EN_DIAMETER, *p, p->diameter());
+      this->setLinkValue(EN_ROUGHNESS, *p, p->roughness());
+      this->setLinkValue(EN_LENGTH, *p, p->length());
+      this->setLinkValue(EN_STATUS, *p, p->fixedStatus());
       this->setComment(p, p->userDescription());
     }
       
@@ -898,26 +960,41 @@ void EpanetModel::updateEngineWithElementProperties(Element::_sp e) {
 #pragma mark -
 #pragma mark Internal Private Methods
 
-double EpanetModel::getNodeValue(int epanetCode, const string& node) {
-  int nodeIndex = _nodeIndex[node];
+int EpanetModel::nodeIndex(Element& node) {
+  int index = node.engineIndex();
+  if (index < 0) {
+    // an element the wrappers didn't create: find it once, and remember.
+    index = _nodeIndex[node.name()];
+    node.setEngineIndex(index);
+  }
+  return index;
+}
+
+int EpanetModel::linkIndex(Element& link) {
+  int index = link.engineIndex();
+  if (index < 0) {
+    index = _linkIndex[link.name()];
+    link.setEngineIndex(index);
+  }
+  return index;
+}
+
+double EpanetModel::getNodeValue(int epanetCode, Element& node) {
   double value;
-  OW_API_CHECK(OW_getnodevalue(_enModel, nodeIndex, epanetCode, &value), "OW_getnodevalue");
+  OW_API_CHECK(OW_getnodevalue(_enModel, this->nodeIndex(node), epanetCode, &value), "OW_getnodevalue");
   return value;
 }
-void EpanetModel::setNodeValue(int epanetCode, const string& node, double value) {
-  int nodeIndex = _nodeIndex[node];
-  OW_API_CHECK(OW_setnodevalue(_enModel, nodeIndex, epanetCode, value), "OW_setnodevalue");
+void EpanetModel::setNodeValue(int epanetCode, Element& node, double value) {
+  OW_API_CHECK(OW_setnodevalue(_enModel, this->nodeIndex(node), epanetCode, value), "OW_setnodevalue");
 }
 
-double EpanetModel::getLinkValue(int epanetCode, const string& link) {
-  int linkIndex = _linkIndex[link];
+double EpanetModel::getLinkValue(int epanetCode, Element& link) {
   double value;
-  OW_API_CHECK(OW_getlinkvalue(_enModel, linkIndex, epanetCode, &value), "OW_getlinkvalue");
+  OW_API_CHECK(OW_getlinkvalue(_enModel, this->linkIndex(link), epanetCode, &value), "OW_getlinkvalue");
   return value;
 }
-void EpanetModel::setLinkValue(int epanetCode, const string& link, double value) {
-  int linkIndex = _linkIndex[link];
-  OW_API_CHECK(OW_setlinkvalue(_enModel, linkIndex, epanetCode, value), "OW_setlinkvalue");
+void EpanetModel::setLinkValue(int epanetCode, Element& link, double value) {
+  OW_API_CHECK(OW_setlinkvalue(_enModel, this->linkIndex(link), epanetCode, value), "OW_setlinkvalue");
 }
 
 void EpanetModel::setComment(Element::_sp element, const std::string& comment)
@@ -928,7 +1005,7 @@ void EpanetModel::setComment(Element::_sp element, const std::string& comment)
     case Element::TANK:
     case Element::RESERVOIR:
     {
-      int nodeIndex = _nodeIndex[element->name()];
+      int nodeIndex = this->nodeIndex(*element);
       OW_API_CHECK(OW_setnodecomment(_enModel, nodeIndex, comment.c_str()), "OW_setnodecomment");
     }
       break;
@@ -936,7 +1013,7 @@ void EpanetModel::setComment(Element::_sp element, const std::string& comment)
     case Element::PUMP:
     case Element::VALVE:
     {
-      int linkIndex = _linkIndex[element->name()];
+      int linkIndex = this->linkIndex(*element);
       OW_API_CHECK(OW_setlinkcomment(_enModel, linkIndex, comment.c_str()), "OW_setlinkcomment");
     }
       break;
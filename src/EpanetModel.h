@@ -42,33 +42,41 @@ namespace RTX {
     virtual std::ostream& toStream(std::ostream &stream);
     OW_Project *epanetModelPointer();
     
+    // whole-network arrays, indexed by engine index (the toolkit counts from 1, so values[0] is unused)
+    void getNodeValues(int epanetCode, std::vector<double>& values);
+    void getLinkValues(int epanetCode, std::vector<double>& values);
+    
   protected:
     // overridden accessors
     // node elements
-    double reservoirLevel(const std::string& reservoir);
-    double tankLevel(const std::string& tank);
-    double tankVolume(const std::string& tank);
-    double tankFlow(const std::string& tank);
-    double junctionDemand(const std::string& junction);
-    double junctionHead(const std::string& junction);
-    double junctionPressure(const std::string& junction);
-    double junctionQuality(const std::string& junction);
+    double reservoirLevel(const Reservoir::_sp& reservoir);
+    double tankLevel(const Tank::_sp& tank);
+    double tankVolume(const Tank::_sp& tank);
+    double tankFlow(const Tank::_sp& tank);
+    double junctionDemand(const Junction::_sp& junction);
+    double junctionHead(const Junction::_sp& junction);
+    double junctionPressure(const Junction::_sp& junction);
+    double junctionQuality(const Junction::_sp& junction);
     // link elements
-    double pipeFlow(const std::string& pipe);
-    double pumpEnergy(const std::string& pump);
+    double pipeFlow(const Pipe::_sp& pipe);
+    double pumpEnergy(const Pump::_sp& pump);
     
     // hydraulic
-    void setReservoirHead(const std::string& reservoir, double level);
-    void setReservoirQuality(const string& reservoir, double quality);
-    void setTankLevel(const std::string& tank, double level);
-    void setJunctionDemand(const std::string& junction, double demand);
-    void setPipeStatus(const std::string& pipe, Pipe::status_t status);
-    void setPumpStatus(const std::string& pump, Pipe::status_t status);
-    void setPumpSetting(const std::string& pump, double setting);
-    void setValveSetting(const std::string& valve, double setting);
+    void setReservoirHead(const Reservoir::_sp& reservoir, double level);
+    void setReservoirQuality(const Reservoir::_sp& reservoir, double quality);
+    void setTankLevel(const Tank::_sp& tank, double level);
+    void setJunctionDemand(const Junction::_sp& junction, double demand);
+    void setPipeStatus(const Pipe::_sp& pipe, Pipe::status_t status);
+    void setPumpStatus(const Pump::_sp& pump, Pipe::status_t status);
+    void setPumpSetting(const Pump::_sp& pump, double setting);
+    void setValveSetting(const Valve::_sp& valve, double setting);
     
     // quality
-    void setJunctionQuality(const std::string& junction, double quality);
+    void setJunctionQuality(const Junction::_sp& junction, double quality);
+    
+    // bulk
+    bool engineStates(engineState_t state, std::vector<double>& values);
+    void setPipeStatuses(const std::vector<Pipe::_sp>& pipes, const std::vector<Pipe::status_t>& statuses);
     
     virtual void disableControls();
     virtual void enableControls();
@@ -86,10 +94,12 @@ namespace RTX {
     void updateEngineWithElementProperties(Element::_sp e);
     
     // protected accessors
-    double getNodeValue(int epanetCode, const std::string& node);
-    void setNodeValue(int epanetCode, const std::string& node, double value);
-    double getLinkValue(int epanetCode, const std::string& link);
-    void setLinkValue(int epanetCode, const std::string& link, double value);
+    int nodeIndex(Element& node); // the element's engine index, looked up by name only the first time
+    int linkIndex(Element& link);
+    double getNodeValue(int epanetCode, Element& node);
+    void setNodeValue(int epanetCode, Element& node, double value);
+    double getLinkValue(int epanetCode, Element& link);
+    void setLinkValue(int epanetCode, Element& link, double value);
     void setComment(Element::_sp element, const std::string& comment);
     
     OW_Project *_enModel; // protected scope so subclasses can use epanet api
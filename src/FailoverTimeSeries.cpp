@@ -59,22 +59,32 @@ void FailoverTimeSeries::swapSourceWithFailover() {
 
 
 
-set<time_t> FailoverTimeSeries::timeValuesInRange(TimeRange range) {
+TimeGrid FailoverTimeSeries::timeValuesInRange(TimeRange range) {
   if (!this->failoverTimeseries() || this->clock()) {
     return TimeSeriesFilter::timeValuesInRange(range);
   }
   else if (!this->clock()) {
-    set<time_t> times;
     PointCollection pc = this->filterPointsInRange(range);
     return pc.times();
   }
   
-  return set<time_t>();
+  return TimeGrid();
 }
 
-TimeSeries::PointCollection FailoverTimeSeries::filterPointsInRange(TimeRange range) {
+std::vector<TimeSeries::_sp> FailoverTimeSeries::upstreamSeries() {
+  std::vector<TimeSeries::_sp> upstream = TimeSeriesFilter::upstreamSeries();
+  if (this->failoverTimeseries()) {
+    upstream.push_back(this->failoverTimeseries());
+  }
+  return upstream;
+}
+
+TimeRange FailoverTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
   if (!this->failoverTimeseries()) {
-    return TimeSeriesFilter::filterPointsInRange(range);
+    return TimeSeriesFilter::upstreamRange(upstream, range);
+  }
+  if (!upstream || (upstream != this->source() && upstream != this->failoverTimeseries())) {
+    return TimeRange();
   }
   
   TimeRange qPrimary = range;
@@ -82,13 +92,17 @@ TimeSeries::PointCollection FailoverTimeSeries::filterPointsInRange(TimeRange ra
   time_t priNext = this->source()->timeAfter(range.end - 1);
   qPrimary = TimeRange(priPrev,priNext);
   
+  // make this valid & queryable
+  qPrimary.correctWithRange(range);
+  
+  if (upstream == this->source()) {
+    return qPrimary;
+  }
+  
   TimeRange qSecondary = range;
   time_t secPrev = this->failoverTimeseries()->timeBefore(range.start + 1);
   time_t secNext = this->failoverTimeseries()->timeAfter(range.end - 1);
   qSecondary = TimeRange(secPrev,secNext);
-  
-  // make these valid & queryable
-  qPrimary.correctWithRange(range);
   qSecondary.correctWithRange(range);
   
   // this is to make sure we have enough secondary data to fill leading & trailing gaps
@@ -99,6 +113,18 @@ TimeSeries::PointCollection FailoverTimeSeries::filterPointsInRange(TimeRange ra
     qSecondary.end = qPrimary.end;
   }
   
+  return qSecondary;
+}
+
+
+TimeSeries::PointCollection FailoverTimeSeries::filterPointsInRange(TimeRange range) {
+  if (!this->failoverTimeseries()) {
+    return TimeSeriesFilter::filterPointsInRange(range);
+  }
+  
+  TimeRange qPrimary = this->upstreamRange(this->source(), range);
+  TimeRange qSecondary = this->upstreamRange(this->failoverTimeseries(), range);
+  
   // get source and secondary data
   PointCollection primaryData = this->source()->pointCollection(qPrimary);
   PointCollection secondaryData = this->failoverTimeseries()->pointCollection(qSecondary);
@@ -166,13 +192,13 @@ TimeSeries::PointCollection FailoverTimeSeries::filterPointsInRange(TimeRange ra
     
   }
   
-  PointCollection outData(merged, this->units());
+  PointCollection outData(std::move(merged), this->units());
   
   if (this->willResample()) {
     outData.resample(this->timeValuesInRange(range));
   }
   else {
-    outData = outData.trimmedToRange(range);
+    outData.trimToRange(range);
   }
   
   return outData;
@@ -20,23 +20,33 @@ FirstDerivative::~FirstDerivative() {
 }
 
 
-TimeSeries::PointCollection FirstDerivative::filterPointsInRange(TimeRange range) {
-  PointCollection data(vector<Point>(), this->units());
-  
-  vector<Point> outPoints;
-  Units fromUnits = this->source()->units();
+TimeRange FirstDerivative::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
   
   TimeRange qRange = range;
   if (this->willResample()) {
     // expand range
-    qRange.start = this->source()->timeBefore(range.start + 1);
-    qRange.end = this->source()->timeAfter(range.end - 1);
+    qRange.start = upstream->timeBefore(range.start + 1);
+    qRange.end = upstream->timeAfter(range.end - 1);
   }
   
   // one prior
-  qRange.start = this->source()->timeBefore(qRange.start);
+  qRange.start = upstream->timeBefore(qRange.start);
   
   qRange.correctWithRange(range);
+  return qRange;
+}
+
+
+TimeSeries::PointCollection FirstDerivative::filterPointsInRange(TimeRange range) {
+  PointCollection data(vector<Point>(), this->units());
+  
+  vector<Point> outPoints;
+  Units fromUnits = this->source()->units();
+  
+  TimeRange qRange = this->upstreamRange(this->source(), range);
   PointCollection sourceData = this->source()->pointCollection(qRange);
   
   if (sourceData.count() < 2) {
@@ -59,10 +69,10 @@ TimeSeries::PointCollection FirstDerivative::filterPointsInRange(TimeRange range
   }
   
   
-  data.points = outPoints;
+  data.points.swap(outPoints);
   
   if (this->willResample()) {
-    set<time_t> timeValues = this->timeValuesInRange(range);
+    TimeGrid timeValues = this->timeValuesInRange(range);
     data.resample(timeValues);
   }
   
@@ -22,6 +22,7 @@ namespace RTX {
     
   protected:
     PointCollection filterPointsInRange(TimeRange range);
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     bool canSetSource(TimeSeries::_sp ts);
     void didSetSource(TimeSeries::_sp ts);
     bool canChangeToUnits(Units units);
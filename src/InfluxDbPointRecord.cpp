@@ -6,6 +6,7 @@
 #include <map>
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/join.hpp>
 
 
 
@@ -442,6 +443,36 @@ std::vector<Point> InfluxDbPointRecord::selectRange(const std::string& id, time_
 }
 
 
+std::map<std::string, std::vector<Point> > InfluxDbPointRecord::selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime) {
+  std::map<std::string, std::vector<Point> > selected;
+  
+  // one request, one statement per series. influx answers each statement in its own result.
+  vector<string> statements, statementIds;
+  BOOST_FOREACH(const string& id, ids) {
+    selected[id]; // every series gets an entry, even if it's empty
+    string dbId = _influxIdForTsId(id);
+    if (dbId.empty()) {
+      continue;
+    }
+    DbPointRecord::Query q = this->queryPartsFromMetricId(dbId);
+    q.where.push_back("time >= " + to_string(startTime) + "s");
+    q.where.push_back("time <= " + to_string(endTime) + "s");
+    statements.push_back(q.selectStr());
+    statementIds.push_back(id);
+  }
+  if (statements.empty()) {
+    return selected;
+  }
+  
+  string url = this->urlForQuery(boost::algorithm::join(statements, ";"));
+  JsonDocPtr doc = this->jsonFromPath(url);
+  for (size_t i = 0; i < statementIds.size(); ++i) {
+    selected[statementIds[i]] = this->pointsFromJson(doc, (rapidjson::SizeType)i);
+  }
+  return selected;
+}
+
+
 Point InfluxDbPointRecord::selectNext(const std::string& id, time_t time) {
   std::vector<Point> points;
   string dbId = _influxIdForTsId(id);
@@ -491,7 +522,7 @@ void InfluxDbPointRecord::insertSingle(const std::string& id, Point point) {
   
 }
 
-void InfluxDbPointRecord::insertRange(const std::string& id, std::vector<Point> points) {
+void InfluxDbPointRecord::insertRange(const std::string& id, const std::vector<Point>& points) {
   vector<Point> insertionPoints;
   string dbId = _influxIdForTsId(id);
   
@@ -669,10 +700,10 @@ JsonDocPtr InfluxDbPointRecord::jsonFromPath(const std::string &url) {
   return documentOut;
 }
 
-vector<Point> InfluxDbPointRecord::pointsFromJson(JsonDocPtr doc) {
+vector<Point> InfluxDbPointRecord::pointsFromJson(JsonDocPtr doc, rapidjson::SizeType statement) {
   vector<Point> points;
   
-  // multiple time series might be returned eventually, but for now it's just a single-value array.
+  // one result per statement in the query; each holds a single series.
   
   if (doc == NULL || !doc->IsObject()) {
     return points;
@@ -684,16 +715,16 @@ vector<Point> InfluxDbPointRecord::pointsFromJson(JsonDocPtr doc) {
   
   const rapidjson::SizeType zero = 0;
   const rapidjson::Value& results = (*doc)["results"];
-  if (!results.IsArray() || results.Size() == 0) {
+  if (!results.IsArray() || results.Size() <= statement) {
     return points;
   }
   
-  const rapidjson::Value& rzero = results[zero];
-  if(!rzero.IsObject() || !rzero.HasMember("series")) {
+  const rapidjson::Value& result = results[statement];
+  if(!result.IsObject() || !result.HasMember("series")) {
     return points;
   }
   
-  const rapidjson::Value& series = rzero["series"];
+  const rapidjson::Value& series = result["series"];
   if (!series.IsArray() || series.Size() == 0) {
     return points;
   }
@@ -741,7 +772,7 @@ vector<Point> InfluxDbPointRecord::pointsFromJson(JsonDocPtr doc) {
 
 
 
-const string InfluxDbPointRecord::insertionDataFromPoints(const string& tsName, vector<Point> points) {
+const string InfluxDbPointRecord::insertionDataFromPoints(const string& tsName, const vector<Point>& points) {
   
   /*
    As you can see in the example below, you can post multiple points to multiple series at the same time by separating each point with a new line. Batching points in this manner will result in much higher performance.
@@ -42,9 +42,10 @@ namespace RTX {
     virtual std::vector<Point> selectRange(const std::string& id, time_t startTime, time_t endTime);
     virtual Point selectNext(const std::string& id, time_t time);
     virtual Point selectPrevious(const std::string& id, time_t time);
+    virtual std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime);
     
     virtual void insertSingle(const std::string& id, Point point);
-    virtual void insertRange(const std::string& id, std::vector<Point> points);
+    virtual void insertRange(const std::string& id, const std::vector<Point>& points);
     virtual void removeRecord(const std::string& id);
     
   private:
@@ -59,16 +60,16 @@ namespace RTX {
     
     
     JsonDocPtr jsonFromPath(const std::string& url);
-    const std::string insertionDataFromPoints(const std::string& tsName, std::vector<Point> points);
+    const std::string insertionDataFromPoints(const std::string& tsName, const std::vector<Point>& points);
     
 //    JsonDocPtr insertionJsonFromPoints(const std::string& tsName, std::vector<Point> points);
 //    const std::string serializedJson(JsonDocPtr doc);
-    std::vector<Point> pointsFromJson(JsonDocPtr doc);
+    std::vector<Point> pointsFromJson(JsonDocPtr doc, rapidjson::SizeType statement = 0);
     const std::string urlForQuery(const std::string& query, bool appendTimePrecision = true); // unencoded query
     const std::string urlEncode(std::string s);
 //    void postPointsWithBody(const std::string& body);
     
-    const std::string insertionStringWithPoints(const std::string& tsName, std::vector<Point> points);
+    const std::string insertionStringWithPoints(const std::string& tsName, const std::vector<Point>& points);
     void sendPointsWithString(const std::string& content);
     
 //    boost::shared_ptr<boost::asio::ip::tcp::socket> _socket;
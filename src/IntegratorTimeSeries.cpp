@@ -22,31 +22,43 @@ Clock::_sp IntegratorTimeSeries::resetClock() {
   return _reset;
 }
 
-TimeSeries::PointCollection IntegratorTimeSeries::filterPointsInRange(TimeRange range) {
-
-  vector<Point> outPoints;
-  Units fromUnits = this->source()->units();
-  PointCollection data(vector<Point>(), fromUnits * RTX_SECOND);
-  
-  if (!this->resetClock()) {
-    return PointCollection(vector<Point>(), this->units());
+TimeRange IntegratorTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source() || !this->resetClock()) {
+    return TimeRange();
   }
   
   // back up to previous reset clock tick
   time_t lastReset = this->resetClock()->timeBefore(range.start + 1);
   
   // lagging area, so get this time or the one before it.
-  time_t leftMostTime = this->source()->timeBefore(lastReset);
+  time_t leftMostTime = upstream->timeBefore(lastReset);
   // to-do :: should we resample the source here, for special cases?
   
   // get next point in case it's out of the specified range
   time_t seekRightTime = range.end - 1;
-  seekRightTime = this->source()->timeAfter(seekRightTime);
+  seekRightTime = upstream->timeAfter(seekRightTime);
   if (seekRightTime > 0) {
     range.end = seekRightTime;
   }
   
-  PointCollection sourceData = this->source()->pointCollection(TimeRange(leftMostTime, range.end));
+  return TimeRange(leftMostTime, range.end);
+}
+
+
+TimeSeries::PointCollection IntegratorTimeSeries::filterPointsInRange(TimeRange range) {
+
+  vector<Point> outPoints;
+  Units fromUnits = this->source()->units();
+  PointCollection data(vector<Point>(), fromUnits * RTX_SECOND);
+  
+  if (!this->resetClock()) {
+    return PointCollection(vector<Point>(), this->units());
+  }
+  
+  TimeRange sourceRange = this->upstreamRange(this->source(), range);
+  range.end = sourceRange.end;
+  
+  PointCollection sourceData = this->source()->pointCollection(sourceRange);
   
   if (sourceData.count() < 2) {
     return data;
@@ -83,11 +95,11 @@ TimeSeries::PointCollection IntegratorTimeSeries::filterPointsInRange(TimeRange
   }
   
   
-  data.points = outPoints;
+  data.points.swap(outPoints);
   data.convertToUnits(this->units());
   
   if (this->willResample()) {
-    set<time_t> timeValues = this->timeValuesInRange(range);
+    TimeGrid timeValues = this->timeValuesInRange(range);
     data.resample(timeValues);
   }
   
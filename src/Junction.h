@@ -37,10 +37,6 @@ namespace RTX {
     TimeSeries::_sp demand();
     TimeSeries::_sp quality();
     
-    // public ivars for temporary (that is, steady-state) solutions
-    double state_head, state_pressure, state_demand, state_quality, state_volume, state_flow;
-    
-    
     // parameters
     TimeSeries::_sp qualitySource();
     void setQualitySource(TimeSeries::_sp quality);
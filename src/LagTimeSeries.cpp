@@ -97,31 +97,36 @@ bool LagTimeSeries::willResample() {
 }
 
 
-set<time_t> LagTimeSeries::timeValuesInRange(TimeRange range) {
+TimeGrid LagTimeSeries::timeValuesInRange(TimeRange range) {
   if (this->clock()) {
     return this->clock()->timeValuesInRange(range);
   }
   TimeRange lagRange = range;
   lagRange.start -= _lag;
   lagRange.end -= _lag;
-  set<time_t> sourceTimes = TimeSeriesFilter::timeValuesInRange(lagRange);
-  set<time_t> outTimes;
-  BOOST_FOREACH(time_t t, sourceTimes) {
-    outTimes.insert(t + _lag);
-  }
-  return outTimes;
+  return TimeSeriesFilter::timeValuesInRange(lagRange).shiftedBy(_lag);
 }
 
-TimeSeries::PointCollection LagTimeSeries::filterPointsInRange(TimeRange range) {
+TimeRange LagTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
   
   TimeRange laggedRange = range;
   laggedRange.start -= _lag;
   laggedRange.end -= _lag;
   TimeRange queryRange = laggedRange;
   
-  queryRange.start = this->source()->timeBefore(queryRange.start + 1);
-  queryRange.end = this->source()->timeAfter(queryRange.end - 1);
+  queryRange.start = upstream->timeBefore(queryRange.start + 1);
+  queryRange.end = upstream->timeAfter(queryRange.end - 1);
   queryRange.correctWithRange(laggedRange);
+  return queryRange;
+}
+
+
+TimeSeries::PointCollection LagTimeSeries::filterPointsInRange(TimeRange range) {
+  
+  TimeRange queryRange = this->upstreamRange(this->source(), range);
   
   PointCollection data = this->source()->pointCollection(queryRange);
   
@@ -133,7 +138,7 @@ TimeSeries::PointCollection LagTimeSeries::filterPointsInRange(TimeRange range)
   bool dataOk = false;
   dataOk = data.convertToUnits(this->units());
   if (dataOk && this->willResample()) {
-    set<time_t> timeValues = this->timeValuesInRange(range);
+    TimeGrid timeValues = this->timeValuesInRange(range);
     dataOk = data.resample(timeValues);
   }
   
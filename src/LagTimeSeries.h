@@ -28,7 +28,8 @@ namespace RTX {
   protected:
     bool willResample();
     PointCollection filterPointsInRange(TimeRange range);
-    std::set<time_t> timeValuesInRange(TimeRange range);
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
+    TimeGrid timeValuesInRange(TimeRange range);
     
   private:
     time_t _lag;
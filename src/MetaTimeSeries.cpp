@@ -10,25 +10,35 @@ MetaTimeSeries::MetaTimeSeries() {
 }
 
 
-TimeSeries::PointCollection MetaTimeSeries::filterPointsInRange(TimeRange range) {
-  
-  PointCollection gaps(vector<Point>(), RTX_DIMENSIONLESS);
-  
-  if (_metaMode == MetaModeGap) {
-    gaps.units = RTX_SECOND;
+TimeRange MetaTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
   }
   
   TimeRange qRange = range;
   if (this->willResample()) {
     // expand range
-    qRange.start = this->source()->timeBefore(range.start + 1);
-    qRange.end = this->source()->timeAfter(range.end - 1);
+    qRange.start = upstream->timeBefore(range.start + 1);
+    qRange.end = upstream->timeAfter(range.end - 1);
   }
   
   // one prior
-  qRange.start = this->source()->timeBefore(qRange.start);
+  qRange.start = upstream->timeBefore(qRange.start);
   
   qRange.correctWithRange(range);
+  return qRange;
+}
+
+
+TimeSeries::PointCollection MetaTimeSeries::filterPointsInRange(TimeRange range) {
+  
+  PointCollection gaps(vector<Point>(), RTX_DIMENSIONLESS);
+  
+  if (_metaMode == MetaModeGap) {
+    gaps.units = RTX_SECOND;
+  }
+  
+  TimeRange qRange = this->upstreamRange(this->source(), range);
   PointCollection sourceData = this->source()->pointCollection(qRange);
   
   if (sourceData.count() < 2) {
@@ -68,7 +78,7 @@ TimeSeries::PointCollection MetaTimeSeries::filterPointsInRange(TimeRange range)
   gaps.convertToUnits(this->units());
   
   if (this->willResample()) {
-    set<time_t> times = this->timeValuesInRange(range);
+    TimeGrid times = this->timeValuesInRange(range);
     gaps.resample(times);
   }
   
@@ -15,6 +15,8 @@
 #include "Units.h"
 
 #include "DbPointRecord.h"
+#include "TimeSeriesFetchPool.h"
+#include "TimeSeriesReadAhead.h"
 
 
 #include <boost/config.hpp>
@@ -39,7 +41,7 @@ Model::Model() : _flowUnits(1), _headUnits(1), _pressureUnits(1) {
   this->initObj();
 }
 Model::~Model() {
-  
+  this->stopStateWriter();
 }
 
 void Model::initObj() {
@@ -51,6 +53,8 @@ void Model::initObj() {
   _relativeError.reset( new TimeSeries() );
   _iterations.reset( new TimeSeries() );
   _convergence.reset( new TimeSeries() );
+  _stateQueueDepth.reset( new TimeSeries() );
+  _stateWriterLag.reset( new TimeSeries() );
   
   _relativeError->setName("simulation_relative_error");
   _relativeError->setUnits(RTX_DIMENSIONLESS);
@@ -58,6 +62,10 @@ void Model::initObj() {
   _iterations->setUnits(RTX_DIMENSIONLESS);
   _convergence->setName("simulation_convergence");
   _convergence->setUnits(RTX_DIMENSIONLESS);
+  _stateQueueDepth->setName("simulation_state_queue_depth");
+  _stateQueueDepth->setUnits(RTX_DIMENSIONLESS);
+  _stateWriterLag->setName("simulation_state_writer_lag");
+  _stateWriterLag->setUnits(RTX_SECOND);
   _doesOverrideDemands = false;
   _shouldRunWaterQuality = false;
   
@@ -71,6 +79,8 @@ void Model::initObj() {
   _name = "Model";
   _shouldCancelSimulation = false;
   _tanksNeedReset = false;
+  _inputReadAheadWindow = 60*60*12;
+  _stateFrames.reset( new NetworkStateFrames(4) );
   
   _simLogCallback = NULL;
 }
@@ -435,6 +445,7 @@ void Model::addJunction(Junction::_sp newJunction) {
     return;
   }
   _junctions.push_back(newJunction);
+  newJunction->setStateFrames(_stateFrames, (int)_junctions.size() - 1);
   add(newJunction);
 }
 void Model::addTank(Tank::_sp newTank) {
@@ -443,6 +454,7 @@ void Model::addTank(Tank::_sp newTank) {
     return;
   }
   _tanks.push_back(newTank);
+  newTank->setStateFrames(_stateFrames, (int)_tanks.size() - 1);
   add(newTank);
 }
 void Model::addReservoir(Reservoir::_sp newReservoir) {
@@ -451,6 +463,7 @@ void Model::addReservoir(Reservoir::_sp newReservoir) {
     return;
   }
   _reservoirs.push_back(newReservoir);
+  newReservoir->setStateFrames(_stateFrames, (int)_reservoirs.size() - 1);
   add(newReservoir);
 }
 void Model::addPipe(Pipe::_sp newPipe) {
@@ -459,6 +472,7 @@ void Model::addPipe(Pipe::_sp newPipe) {
     return;
   }
   _pipes.push_back(newPipe);
+  newPipe->setStateFrames(_stateFrames, (int)_pipes.size() - 1);
   add(newPipe);
 }
 void Model::addPump(Pump::_sp newPump) {
@@ -467,6 +481,7 @@ void Model::addPump(Pump::_sp newPump) {
     return;
   }
   _pumps.push_back(newPump);
+  newPump->setStateFrames(_stateFrames, (int)_pumps.size() - 1);
   add(newPump);
 }
 void Model::addValve(Valve::_sp newValve) {
@@ -475,6 +490,7 @@ void Model::addValve(Valve::_sp newValve) {
     return;
   }
   _valves.push_back(newValve);
+  newValve->setStateFrames(_stateFrames, (int)_valves.size() - 1);
   add(newValve);
 }
 
@@ -561,6 +577,10 @@ std::vector<Valve::_sp> Model::valves() {
   return _valves;
 }
 
+NetworkStateFrames::_sp Model::stateFrames() {
+  return _stateFrames;
+}
+
 
 #pragma mark - Engine
 
@@ -611,6 +631,16 @@ void Model::runExtendedPeriod(time_t start, time_t end) {
   // get the record(s) being used
   set<PointRecord::_sp> stateRecordsUsed = this->recordsForModeledStates();
   
+  // load measured inputs ahead of the simulation clock, so that setting parameters doesn't wait on the database
+  TimeSeriesReadAhead::_sp readAhead;
+  if (_inputReadAheadWindow > 0) {
+    set<TimeSeries::_sp> roots = this->networkInputRootSeries(ElementOptionMeasuredAll);
+    readAhead.reset(new TimeSeriesReadAhead(vector<TimeSeries::_sp>(roots.begin(), roots.end()), _inputReadAheadWindow));
+  }
+  
+  // save states on a writer thread for the whole run, so the solver can get a few steps ahead of the database
+  this->startStateWriter(stateRecordsUsed);
+  
   // Extended period simulation
   while (simulationTime < range.end) {
     
@@ -621,6 +651,10 @@ void Model::runExtendedPeriod(time_t start, time_t end) {
       }
     }
     
+    if (readAhead) {
+      readAhead->advanceTo(simulationTime);
+    }
+    
     // get parameters from the RTX elements, and pull them into the simulation
     setSimulationParameters(simulationTime);
     
@@ -640,22 +674,8 @@ void Model::runExtendedPeriod(time_t start, time_t end) {
       // tell each element to update its derived states (simulation-computed values)
       if (!_simReportClock || _simReportClock->isValid(simulationTime)) {
         
-        // move short-term states into timeseries, and do so concurrently:
-        if (true) {
-          // just make sure the thread is idle...
-          if (_saveStateThread.joinable()) {
-            _saveStateThread.join();
-            // once join() returns, we know the queued operation is complete
-          }
-          // fetch sim results into object short-term storage
-          this->fetchSimulationStates();
-          // spin a new thread
-          boost::thread newSaveStateThread(&Model::saveNetworkStates, this, simulationTime, stateRecordsUsed);
-          _saveStateThread.swap(newSaveStateThread);
-        }
-        else {
-          saveNetworkStates(simulationTime, stateRecordsUsed);
-        }
+        // move short-term states into timeseries, and do so concurrently: queue them for the writer thread
+        this->queueNetworkStates(simulationTime);
       }
       
       // get time to next simulation period
@@ -697,6 +717,15 @@ void Model::runExtendedPeriod(time_t start, time_t end) {
     
   } // simulation while-loop
   
+  // whether finished or cancelled, every step already simulated gets saved before returning
+  size_t queuedSteps = _stateFrames->queueDepth();
+  if (queuedSteps > 0) {
+    stringstream ss;
+    ss << "INFO: Saving " << queuedSteps << " queued simulation steps";
+    this->logLine(ss.str());
+  }
+  this->stopStateWriter();
+  
   {
     scoped_lock<boost::signals2::mutex> l(_simulationInProcessMutex);
     _shouldCancelSimulation = false;
@@ -729,6 +758,7 @@ void Model::runForecast(time_t start, time_t end) {
   
   // get the record(s) being used
   set<PointRecord::_sp> stateRecordsUsed = this->recordsForModeledStates();
+  this->startStateWriter(stateRecordsUsed);
   
   while (simulationTime < end) {
     
@@ -749,7 +779,7 @@ void Model::runForecast(time_t start, time_t end) {
     if (success) {
       // tell each element to update its derived states (simulation-computed values)
       if (!_simReportClock || _simReportClock->isValid(simulationTime)) {
-        saveNetworkStates(simulationTime, stateRecordsUsed);
+        this->queueNetworkStates(simulationTime);
       }
       // get time to next simulation period
       nextSimulationTime = nextHydraulicStep(simulationTime);
@@ -781,6 +811,7 @@ void Model::runForecast(time_t start, time_t end) {
     
   } // simulation loop
   
+  this->stopStateWriter();
   
 }
 
@@ -862,7 +893,7 @@ void Model::_checkTanksForReset(time_t time) {
         // adjust for model limits (epanet rejects otherwise, for example)
         levelValue = (levelValue <= tank->maxLevel()) ? levelValue : tank->maxLevel();
         levelValue = (levelValue >= tank->minLevel()) ? levelValue : tank->minLevel();
-        setTankLevel(tank->name(), levelValue);
+        setTankLevel(tank, levelValue);
       }
       else {
         cerr << "ERR: Invalid head point for Tank " << tank->name() << " at time " << time << endl;
@@ -1001,23 +1032,24 @@ void Model::setSimulationParameters(time_t time) {
         this->logLine(ss.str());
       }
     }
-    // hydraulic junctions - set demand values.
-    BOOST_FOREACH(Junction::_sp junction, this->junctions()) {
+    // hydraulic junctions - set demand values, all at once.
+    vector<Junction::_sp> junctions = this->junctions();
+    vector<double> demands(junctions.size(), 0.0);
+    for (size_t i = 0; i < junctions.size(); ++i) {
+      Junction::_sp junction = junctions[i];
       Point p = junction->demand()->pointAtOrBefore(time);
       if (p.isValid) {
-        double demandValue = Units::convertValue(p.value, junction->demand()->units(), flowUnits());
-        setJunctionDemand(junction->name(), demandValue);
+        demands[i] = Units::convertValue(p.value, junction->demand()->units(), flowUnits());
       }
       else {
-        // default when allocation doesn't/can't set demand -- should this happen?
-        setJunctionDemand(junction->name(), 0.0);
-        
+        // default when allocation doesn't/can't set demand (zero) -- should this happen?
         stringstream ss;
         ss << "ERROR: Invalid flow boundary value for junction " << junction->name() << " :: " << asctime(timeinfo);
         this->logLine(ss.str());
         
       }
     }
+    setJunctionDemands(junctions, demands);
   }
   
   // for reservoirs, set the boundary head and quality conditions
@@ -1027,7 +1059,7 @@ void Model::setSimulationParameters(time_t time) {
       Point p = reservoir->boundaryHead()->pointAtOrBefore(time);
       if (p.isValid) {
         double headValue = Units::convertValue(p.value, reservoir->boundaryHead()->units(), headUnits());
-        setReservoirHead( reservoir->name(), headValue );
+        setReservoirHead( reservoir, headValue );
       }
       else {
         stringstream ss;
@@ -1040,7 +1072,7 @@ void Model::setSimulationParameters(time_t time) {
       Point p = reservoir->boundaryQuality()->pointAtOrBefore(time);
       if (p.isValid) {
         double qualityValue = Units::convertValue(p.value, reservoir->boundaryQuality()->units(), qualityUnits());
-        setReservoirQuality( reservoir->name(), qualityValue );
+        setReservoirQuality( reservoir, qualityValue );
       }
       else {
         stringstream ss;
@@ -1065,7 +1097,7 @@ void Model::setSimulationParameters(time_t time) {
       Point p = valve->statusParameter()->pointAtOrBefore(time);
       if (p.isValid) {
         status = Pipe::status_t((int)(p.value > 0));
-        setPipeStatus( valve->name(), status );
+        setPipeStatus( valve, status );
       }
       else {
         stringstream ss;
@@ -1078,7 +1110,7 @@ void Model::setSimulationParameters(time_t time) {
         Point p = valve->settingParameter()->pointAtOrBefore(time);
         if (p.isValid) {
           // TODO -- set units based on type of valve (pressure or flow model units)
-          setValveSetting( valve->name(), p.value );
+          setValveSetting( valve, p.value );
         }
         else {
           stringstream ss;
@@ -1102,7 +1134,7 @@ void Model::setSimulationParameters(time_t time) {
       Point p = pump->statusParameter()->pointAtOrBefore(time);
       if (p.isValid) {
         status = Pipe::status_t((int)(p.value));
-        setPumpStatus( pump->name(), status );
+        setPumpStatus( pump, status );
       }
       else {
         stringstream ss;
@@ -1114,7 +1146,7 @@ void Model::setSimulationParameters(time_t time) {
       if (status == Pipe::OPEN) {
         Point p = pump->settingParameter()->pointAtOrBefore(time);
         if (p.isValid) {
-          setPumpSetting( pump->name(), p.value );
+          setPumpSetting( pump, p.value );
         }
         else {
           stringstream ss;
@@ -1130,12 +1162,15 @@ void Model::setSimulationParameters(time_t time) {
     }
   }
   
-  // for pipes, set status
+  // for pipes, set status, all at once.
+  vector<Pipe::_sp> statusPipes;
+  vector<Pipe::status_t> statuses;
   BOOST_FOREACH(Pipe::_sp pipe, this->pipes()) {
     if (pipe->statusParameter()) {
       Point p = pipe->statusParameter()->pointAtOrBefore(time);
       if (p.isValid) {
-        setPipeStatus(pipe->name(), Pipe::status_t((int)(p.value)));
+        statusPipes.push_back(pipe);
+        statuses.push_back(Pipe::status_t((int)(p.value)));
       }
       else {
         stringstream ss;
@@ -1145,6 +1180,8 @@ void Model::setSimulationParameters(time_t time) {
     }
   }
   
+  setPipeStatuses(statusPipes, statuses);
+  
   //////////////////////////////
   // water quality parameters //
   //////////////////////////////
@@ -1154,7 +1191,7 @@ void Model::setSimulationParameters(time_t time) {
         Point p = j->qualitySource()->pointAtOrBefore(time);
         if (p.isValid) {
           double quality = Units::convertValue(p.value, j->qualitySource()->units(), qualityUnits());
-          setJunctionQuality(j->name(), quality);
+          setJunctionQuality(j, quality);
         }
         else {
           stringstream ss;
@@ -1170,173 +1207,243 @@ void Model::setSimulationParameters(time_t time) {
 }
 
 
-void Model::fetchSimulationStates() {
+void Model::setJunctionDemands(const vector<Junction::_sp>& junctions, const vector<double>& demands) {
+  for (size_t i = 0; i < junctions.size(); ++i) {
+    this->setJunctionDemand(junctions[i], demands[i]);
+  }
+}
+
+void Model::setPipeStatuses(const vector<Pipe::_sp>& pipes, const vector<Pipe::status_t>& statuses) {
+  for (size_t i = 0; i < pipes.size(); ++i) {
+    this->setPipeStatus(pipes[i], statuses[i]);
+  }
+}
+
+
+template<class T, class P>
+void Model::_engineStatesFor(const vector<T>& elements, const vector<double>& byIndex, double (Model::*single)(const P&), vector<double>& values) {
+  values.resize(elements.size());
+  for (size_t i = 0; i < elements.size(); ++i) {
+    size_t index = (size_t)elements[i]->engineIndex(); // -1 wraps around: not indexed yet
+    values[i] = (index < byIndex.size()) ? byIndex[index] : (this->*single)(elements[i]);
+  }
+}
+
+namespace {
+  // convert one value per element from engine units to the units of each element's series.
+  // the whole array is scaled at once when every series has the same units, as they usually do.
+  template<class T, class E>
+  void _toSeriesUnits(vector<double>& values, const vector<T>& elements, const Units& engineUnits, TimeSeries::_sp (E::*series)()) {
+    if (elements.empty()) {
+      return;
+    }
+    Units common = (elements.front().get()->*series)()->units();
+    bool same = true;
+    BOOST_FOREACH(const T& e, elements) {
+      Units u = (e.get()->*series)()->units();
+      // == ignores offsets, so make sure the two really convert one to one
+      if (!(u == common) || Units::convertValue(0., u, common) != 0.) {
+        same = false;
+        break;
+      }
+    }
+    if (same) {
+      Units::convertValues(values, engineUnits, common);
+    }
+    else {
+      for (size_t i = 0; i < elements.size(); ++i) {
+        values[i] = Units::convertValue(values[i], engineUnits, (elements[i].get()->*series)()->units());
+      }
+    }
+  }
+}
+
+void Model::fetchSimulationStates(NetworkStateFrames::Frame& frame) {
   
   // retrieve results from the hydraulic sim
-  // then insert the state values into elements' "short-term" memory
+  // then insert the state values into a state frame
   
-  // junctions, tanks, reservoirs
-  BOOST_FOREACH(Junction::_sp junction, junctions()) {
-    double head;
-    head = Units::convertValue(junctionHead(junction->name()), headUnits(), junction->head()->units());
-    junction->state_head = head;
-    
-    double pressure;
-    pressure = Units::convertValue(junctionPressure(junction->name()), pressureUnits(), junction->pressure()->units());
-    junction->state_pressure = pressure;
-    
-    // todo - more fine-grained quality data? at wq step resolution...
-    if (this->shouldRunWaterQuality()) {
-      double quality;
-      quality = Units::convertValue(junctionQuality(junction->name()), this->qualityUnits(), junction->quality()->units());
-      junction->state_quality = quality;
-    }
+  // states wanted for every junction or pipe are read for the whole network at once, if the engine can.
+  // the few tanks, reservoirs, and pumps are read one at a time.
+  vector<double> nodeHead, nodePressure, nodeQuality, nodeDemand, linkFlow;
+  this->engineStates(NodeHead, nodeHead);
+  this->engineStates(NodePressure, nodePressure);
+  if (this->shouldRunWaterQuality()) {
+    this->engineStates(NodeQuality, nodeQuality);
   }
-  
-  // only save demand states if
   if (!_doesOverrideDemands) {
-    BOOST_FOREACH(Junction::_sp junction, junctions()) {
-      double demand;
-      demand = Units::convertValue(junctionDemand(junction->name()), flowUnits(), junction->demand()->units());
-      junction->state_demand = demand;
-    }
+    this->engineStates(NodeDemand, nodeDemand);
   }
+  this->engineStates(LinkFlow, linkFlow);
   
-  BOOST_FOREACH(Reservoir::_sp reservoir, reservoirs()) {
-    double head;
-    head = Units::convertValue(junctionHead(reservoir->name()), headUnits(), reservoir->head()->units());
-    reservoir->state_head = head;
-    
-    double quality;
-    quality = Units::convertValue(junctionQuality(reservoir->name()), this->qualityUnits(), reservoir->quality()->units());
-    reservoir->state_quality = quality;
+  // junctions, tanks, reservoirs
+  vector<double>& junctionHead = frame.values(Element::JUNCTION, NetworkStateFrames::Head);
+  this->_engineStatesFor(_junctions, nodeHead, &Model::junctionHead, junctionHead);
+  _toSeriesUnits(junctionHead, _junctions, headUnits(), &Junction::head);
+  
+  vector<double>& junctionPressure = frame.values(Element::JUNCTION, NetworkStateFrames::Pressure);
+  this->_engineStatesFor(_junctions, nodePressure, &Model::junctionPressure, junctionPressure);
+  _toSeriesUnits(junctionPressure, _junctions, pressureUnits(), &Junction::pressure);
+  
+  // todo - more fine-grained quality data? at wq step resolution...
+  if (this->shouldRunWaterQuality()) {
+    vector<double>& junctionQuality = frame.values(Element::JUNCTION, NetworkStateFrames::Quality);
+    this->_engineStatesFor(_junctions, nodeQuality, &Model::junctionQuality, junctionQuality);
+    _toSeriesUnits(junctionQuality, _junctions, this->qualityUnits(), &Junction::quality);
   }
   
-  BOOST_FOREACH(Tank::_sp tank, tanks()) {
-    double head;
-    head = Units::convertValue(junctionHead(tank->name()), headUnits(), tank->head()->units());
-    tank->state_head = head;
-    
-    double level;
-    level = Units::convertValue(tankLevel(tank->name()), headUnits(), tank->head()->units());
-    tank->state_level = level;
-    
-    double quality;
-    quality = Units::convertValue(junctionQuality(tank->name()), this->qualityUnits(), tank->quality()->units());
-    tank->state_quality = quality;
-    
-    double volume;
-    volume = Units::convertValue(tankVolume(tank->name()), this->volumeUnits(), tank->volume()->units());
-    tank->state_volume = volume;
-    
-    double flow;
-    flow = Units::convertValue(tankFlow(tank->name()), this->flowUnits(), tank->flow()->units());
-    tank->state_flow = flow;
-    
+  // only save demand states if
+  if (!_doesOverrideDemands) {
+    vector<double>& junctionDemand = frame.values(Element::JUNCTION, NetworkStateFrames::Demand);
+    this->_engineStatesFor(_junctions, nodeDemand, &Model::junctionDemand, junctionDemand);
+    _toSeriesUnits(junctionDemand, _junctions, flowUnits(), &Junction::demand);
+  }
+  
+  vector<double>& reservoirHead = frame.values(Element::RESERVOIR, NetworkStateFrames::Head);
+  vector<double>& reservoirQuality = frame.values(Element::RESERVOIR, NetworkStateFrames::Quality);
+  reservoirHead.resize(_reservoirs.size());
+  reservoirQuality.resize(_reservoirs.size());
+  for (size_t i = 0; i < _reservoirs.size(); ++i) {
+    Reservoir::_sp reservoir = _reservoirs[i];
+    reservoirHead[i] = Units::convertValue(this->junctionHead(reservoir), headUnits(), reservoir->head()->units());
+    reservoirQuality[i] = Units::convertValue(this->junctionQuality(reservoir), this->qualityUnits(), reservoir->quality()->units());
+  }
+  
+  vector<double>& tankHead = frame.values(Element::TANK, NetworkStateFrames::Head);
+  vector<double>& tankLevel = frame.values(Element::TANK, NetworkStateFrames::Level);
+  vector<double>& tankQuality = frame.values(Element::TANK, NetworkStateFrames::Quality);
+  vector<double>& tankVolume = frame.values(Element::TANK, NetworkStateFrames::Volume);
+  vector<double>& tankFlow = frame.values(Element::TANK, NetworkStateFrames::Flow);
+  tankHead.resize(_tanks.size());
+  tankLevel.resize(_tanks.size());
+  tankQuality.resize(_tanks.size());
+  tankVolume.resize(_tanks.size());
+  tankFlow.resize(_tanks.size());
+  for (size_t i = 0; i < _tanks.size(); ++i) {
+    Tank::_sp tank = _tanks[i];
+    tankHead[i] = Units::convertValue(this->junctionHead(tank), headUnits(), tank->head()->units());
+    tankLevel[i] = Units::convertValue(this->tankLevel(tank), headUnits(), tank->head()->units());
+    tankQuality[i] = Units::convertValue(this->junctionQuality(tank), this->qualityUnits(), tank->quality()->units());
+    tankVolume[i] = Units::convertValue(this->tankVolume(tank), this->volumeUnits(), tank->volume()->units());
+    tankFlow[i] = Units::convertValue(this->tankFlow(tank), this->flowUnits(), tank->flow()->units());
   }
   
   // pipe elements
-  BOOST_FOREACH(Pipe::_sp pipe, pipes()) {
-    double flow;
-    flow = Units::convertValue(pipeFlow(pipe->name()), flowUnits(), pipe->flow()->units());
-    pipe->state_flow = flow;
-  }
+  vector<double>& pipeFlow = frame.values(Element::PIPE, NetworkStateFrames::Flow);
+  this->_engineStatesFor(_pipes, linkFlow, &Model::pipeFlow, pipeFlow);
+  _toSeriesUnits(pipeFlow, _pipes, flowUnits(), &Pipe::flow);
   
-  BOOST_FOREACH(Valve::_sp valve, valves()) {
-    double flow;
-    flow = Units::convertValue(pipeFlow(valve->name()), flowUnits(), valve->flow()->units());
-    valve->state_flow = flow;
-  }
+  vector<double>& valveFlow = frame.values(Element::VALVE, NetworkStateFrames::Flow);
+  this->_engineStatesFor(_valves, linkFlow, &Model::pipeFlow, valveFlow);
+  _toSeriesUnits(valveFlow, _valves, flowUnits(), &Pipe::flow);
   
   // pump energy
-  BOOST_FOREACH(Pump::_sp pump, pumps()) {
-    double flow;
-    flow = Units::convertValue(pipeFlow(pump->name()), flowUnits(), pump->flow()->units());
-    pump->state_flow = flow;
-    
-    double energy;
-    energy = pumpEnergy(pump->name());
-    pump->energy_state = energy;
+  vector<double>& pumpFlow = frame.values(Element::PUMP, NetworkStateFrames::Flow);
+  vector<double>& pumpEnergy = frame.values(Element::PUMP, NetworkStateFrames::Energy);
+  pumpFlow.resize(_pumps.size());
+  pumpEnergy.resize(_pumps.size());
+  for (size_t i = 0; i < _pumps.size(); ++i) {
+    Pump::_sp pump = _pumps[i];
+    pumpFlow[i] = Units::convertValue(this->pipeFlow(pump), flowUnits(), pump->flow()->units());
+    pumpEnergy[i] = this->pumpEnergy(pump);
   }
   
 }
 
 
-void Model::saveNetworkStates(time_t time, std::set<PointRecord::_sp> bulkRecords) {
+void Model::saveNetworkStates(time_t time, NetworkStateFrames::Frame& frame, std::set<PointRecord::_sp> bulkRecords) {
   
   BOOST_FOREACH(PointRecord::_sp r, bulkRecords) {
     r->beginBulkOperation();
   }
   
   
-  // retrieve results from the hydraulic sim
-  // then insert the state values into elements' time series.
+  // insert the state values from a fetched frame into elements' time series.
   
   // junctions, tanks, reservoirs
-  BOOST_FOREACH(Junction::_sp junction, junctions()) {
-    Point headPoint(time, junction->state_head);
+  const vector<double>& junctionHead = frame.values(Element::JUNCTION, NetworkStateFrames::Head);
+  const vector<double>& junctionPressure = frame.values(Element::JUNCTION, NetworkStateFrames::Pressure);
+  const vector<double>& junctionQuality = frame.values(Element::JUNCTION, NetworkStateFrames::Quality);
+  for (size_t i = 0; i < _junctions.size(); ++i) {
+    Junction::_sp junction = _junctions[i];
+    Point headPoint(time, junctionHead[i]);
     junction->head()->insert(headPoint);
     
-    Point pressurePoint(time, junction->state_pressure);
+    Point pressurePoint(time, junctionPressure[i]);
     junction->pressure()->insert(pressurePoint);
     
     // todo - more fine-grained quality data? at wq step resolution...
     if (this->shouldRunWaterQuality()) {
-      Point qualityPoint(time, junction->state_quality);
+      Point qualityPoint(time, junctionQuality[i]);
       junction->quality()->insert(qualityPoint);
     }
   }
   
   // only save demand states if
   if (!_doesOverrideDemands) {
-    BOOST_FOREACH(Junction::_sp junction, junctions()) {
-      Point demandPoint(time, junction->state_demand);
-      junction->demand()->insert(demandPoint);
+    const vector<double>& junctionDemand = frame.values(Element::JUNCTION, NetworkStateFrames::Demand);
+    for (size_t i = 0; i < _junctions.size(); ++i) {
+      Point demandPoint(time, junctionDemand[i]);
+      _junctions[i]->demand()->insert(demandPoint);
     }
   }
   
-  BOOST_FOREACH(Reservoir::_sp reservoir, reservoirs()) {
-    Point headPoint(time, reservoir->state_head);
+  const vector<double>& reservoirHead = frame.values(Element::RESERVOIR, NetworkStateFrames::Head);
+  const vector<double>& reservoirQuality = frame.values(Element::RESERVOIR, NetworkStateFrames::Quality);
+  for (size_t i = 0; i < _reservoirs.size(); ++i) {
+    Reservoir::_sp reservoir = _reservoirs[i];
+    Point headPoint(time, reservoirHead[i]);
     reservoir->head()->insert(headPoint);
     
-    Point qualityPoint(time, reservoir->state_quality);
+    Point qualityPoint(time, reservoirQuality[i]);
     reservoir->quality()->insert(qualityPoint);
   }
   
-  BOOST_FOREACH(Tank::_sp tank, tanks()) {
-    Point headPoint(time, tank->state_head);
+  const vector<double>& tankHead = frame.values(Element::TANK, NetworkStateFrames::Head);
+  const vector<double>& tankLevel = frame.values(Element::TANK, NetworkStateFrames::Level);
+  const vector<double>& tankQuality = frame.values(Element::TANK, NetworkStateFrames::Quality);
+  const vector<double>& tankVolume = frame.values(Element::TANK, NetworkStateFrames::Volume);
+  const vector<double>& tankFlow = frame.values(Element::TANK, NetworkStateFrames::Flow);
+  for (size_t i = 0; i < _tanks.size(); ++i) {
+    Tank::_sp tank = _tanks[i];
+    Point headPoint(time, tankHead[i]);
     tank->head()->insert(headPoint);
     
-    Point levelPoint(time, tank->state_level);
+    Point levelPoint(time, tankLevel[i]);
     tank->level()->insert(levelPoint);
     
-    Point qualityPoint(time, tank->state_quality);
+    Point qualityPoint(time, tankQuality[i]);
     tank->quality()->insert(qualityPoint);
     
-    Point volumePoint(time,tank->state_volume);
+    Point volumePoint(time, tankVolume[i]);
     tank->volume()->insert(volumePoint);
     
-    Point flowPoint(time,tank->state_flow);
+    Point flowPoint(time, tankFlow[i]);
     tank->flow()->insert(flowPoint);
   }
   
   // pipe elements
-  BOOST_FOREACH(Pipe::_sp pipe, pipes()) {
-    Point aPoint(time, pipe->state_flow);
-    pipe->flow()->insert(aPoint);
+  const vector<double>& pipeFlow = frame.values(Element::PIPE, NetworkStateFrames::Flow);
+  for (size_t i = 0; i < _pipes.size(); ++i) {
+    Point aPoint(time, pipeFlow[i]);
+    _pipes[i]->flow()->insert(aPoint);
   }
   
-  BOOST_FOREACH(Valve::_sp valve, valves()) {
-    Point aPoint(time, valve->state_flow);
-    valve->flow()->insert(aPoint);
+  const vector<double>& valveFlow = frame.values(Element::VALVE, NetworkStateFrames::Flow);
+  for (size_t i = 0; i < _valves.size(); ++i) {
+    Point aPoint(time, valveFlow[i]);
+    _valves[i]->flow()->insert(aPoint);
   }
   
   // pump energy
-  BOOST_FOREACH(Pump::_sp pump, pumps()) {
-    Point flowPoint(time, pump->state_flow);
+  const vector<double>& pumpFlow = frame.values(Element::PUMP, NetworkStateFrames::Flow);
+  const vector<double>& pumpEnergy = frame.values(Element::PUMP, NetworkStateFrames::Energy);
+  for (size_t i = 0; i < _pumps.size(); ++i) {
+    Pump::_sp pump = _pumps[i];
+    Point flowPoint(time, pumpFlow[i]);
     pump->flow()->insert(flowPoint);
     
-    Point energyPoint(time, pump->energy_state);
+    Point energyPoint(time, pumpEnergy[i]);
     pump->energy()->insert(energyPoint);
   }
   
@@ -1346,6 +1453,46 @@ void Model::saveNetworkStates(time_t time, std::set<PointRecord::_sp> bulkRecord
   }
 }
 
+
+void Model::startStateWriter(set<PointRecord::_sp> bulkRecords) {
+  this->stopStateWriter(); // in case an earlier run was interrupted
+  _stateFrames->open();
+  boost::thread writer(&Model::saveQueuedNetworkStates, this, bulkRecords);
+  _saveStateThread.swap(writer);
+}
+
+void Model::queueNetworkStates(time_t time) {
+  // waits here if the writer has fallen a full queue behind
+  NetworkStateFrames::Frame& frame = _stateFrames->beginFrame(time);
+  this->fetchSimulationStates(frame);
+  _stateFrames->commitFrame();
+  
+  Point depth(time, (double)_stateFrames->queueDepth());
+  _stateQueueDepth->insert(depth);
+  Point lag(time, (double)_stateFrames->writerLag());
+  _stateWriterLag->insert(lag);
+}
+
+void Model::stopStateWriter() {
+  _stateFrames->close();
+  if (_saveStateThread.joinable()) {
+    _saveStateThread.join();
+  }
+}
+
+void Model::saveQueuedNetworkStates(set<PointRecord::_sp> bulkRecords) {
+  NetworkStateFrames::Frame* frame;
+  while (_stateFrames->nextQueuedFrame(frame)) {
+    try {
+      this->saveNetworkStates(frame->time, *frame, bulkRecords);
+    } catch (std::exception& e) {
+      // drop this step rather than stall the solver
+      cerr << "RTX state writer failed :: " << frame->time << " :: " << e.what() << endl;
+    }
+    _stateFrames->finishFrame();
+  }
+}
+
 void Model::setCurrentSimulationTime(time_t time) {
   scoped_lock<boost::signals2::mutex> bigLock(_simulationInProcessMutex);
   _currentSimulationTime = time;
@@ -1556,15 +1703,30 @@ void Model::fetchElementInputs(TimeRange range) {
   time_t t2 = range.start + chunkSize;
   while (t1 < range.end) {
     TimeRange tr(t1,t2);
-    BOOST_FOREACH(TimeSeries::_sp ts, inputs) {
-      cout << "Pre-fetching " << ts->name()  << " :: Times " << t1 << "-" << t2 << endl;
-      ts->points(tr);
-    }
+    cout << "Pre-fetching " << inputs.size() << " inputs :: Times " << t1 << "-" << t2 << endl;
+    TimeSeriesFetchPool::pointCollections(inputs, tr); // independent series; fetch side-by-side
     t1 += chunkSize;
     t2 = min(t1 + chunkSize, range.end);
   }
 }
 
+void Model::setInputReadAheadWindow(time_t seconds) {
+  _inputReadAheadWindow = seconds;
+}
+
+time_t Model::inputReadAheadWindow() {
+  return _inputReadAheadWindow;
+}
+
+void Model::setStateQueueCapacity(size_t steps) {
+  this->stopStateWriter();
+  _stateFrames->setCapacity(steps);
+}
+
+size_t Model::stateQueueCapacity() {
+  return _stateFrames->capacity();
+}
+
 bool _rtxmodel_isDbRecord(PointRecord::_sp record) {
   return (boost::dynamic_pointer_cast<DbPointRecord>(record)) ? true : false;
 }
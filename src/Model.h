@@ -122,6 +122,7 @@ namespace RTX {
     vector<Pipe::_sp> pipes();
     vector<Pump::_sp> pumps();
     vector<Valve::_sp> valves();
+    NetworkStateFrames::_sp stateFrames(); // simulated states of every element, by ordinal in the lists above
     
     virtual void updateEngineWithElementProperties(Element::_sp e);
     
@@ -145,6 +146,8 @@ namespace RTX {
     TimeSeries::_sp iterations() {return _iterations;}
     TimeSeries::_sp relativeError() {return _relativeError;}
     TimeSeries::_sp convergence() {return _convergence; }
+    TimeSeries::_sp stateQueueDepth() {return _stateQueueDepth;} // reported steps waiting to be saved
+    TimeSeries::_sp stateWriterLag() {return _stateWriterLag;} // simulated seconds the saved states trail the solver
     
     void setTankResetClock(Clock::_sp resetClock);
     
@@ -182,6 +185,12 @@ namespace RTX {
 
     // fetch points for a group of series
     void fetchElementInputs(TimeRange range);
+    // keep measured inputs loaded this far ahead of the simulation clock, on a background thread (0 disables)
+    void setInputReadAheadWindow(time_t seconds);
+    time_t inputReadAheadWindow();
+    // reported steps the solver may run ahead of the thread saving their states (at least 2)
+    void setStateQueueCapacity(size_t steps);
+    size_t stateQueueCapacity();
     
     // units
     Units flowUnits();
@@ -203,36 +212,50 @@ namespace RTX {
   protected:
     
     void setSimulationParameters(time_t time);
-    void fetchSimulationStates();
-    void saveNetworkStates(time_t time, std::set<PointRecord::_sp> bulkOperationRecords);
+    void fetchSimulationStates(NetworkStateFrames::Frame& frame);
+    void saveNetworkStates(time_t time, NetworkStateFrames::Frame& frame, std::set<PointRecord::_sp> bulkOperationRecords);
     
     
     
     // model parameter setting
     // recreating or wrapping basic api functionality here.
-    virtual double reservoirLevel(const string& reservoirName) { return 0; };
-    virtual double tankLevel(const string& tankName) { return 0; };
-    virtual double tankVolume(const std::string& tank) { return 0; };
-    virtual double tankFlow(const std::string& tank) { return 0; };
-    virtual double junctionHead(const string& junction) { return 0; };
-    virtual double junctionPressure(const string& junction) { return 0; };
-    virtual double junctionDemand(const string& junctionName) { return 0; };
-    virtual double junctionQuality(const string& junctionName) { return 0; };
-    virtual double junctionInitialQuality(const string& junctionName) { return 0; };
+    // elements are passed directly, so that an engine can use its own index (Element::engineIndex) instead of looking up names.
+    virtual double reservoirLevel(const Reservoir::_sp& reservoir) { return 0; };
+    virtual double tankLevel(const Tank::_sp& tank) { return 0; };
+    virtual double tankVolume(const Tank::_sp& tank) { return 0; };
+    virtual double tankFlow(const Tank::_sp& tank) { return 0; };
+    virtual double junctionHead(const Junction::_sp& junction) { return 0; };
+    virtual double junctionPressure(const Junction::_sp& junction) { return 0; };
+    virtual double junctionDemand(const Junction::_sp& junction) { return 0; };
+    virtual double junctionQuality(const Junction::_sp& junction) { return 0; };
+    virtual double junctionInitialQuality(const Junction::_sp& junction) { return 0; };
     // link elements
-    virtual double pipeFlow(const string& pipe) { return 0; };
-    virtual double pumpEnergy(const string& pump) { return 0; };
-    
-    virtual void setReservoirHead(const string& reservoir, double level) { };
-    virtual void setReservoirQuality(const string& reservoir, double quality) { };
-    virtual void setTankLevel(const string& tank, double level) { };
-    virtual void setJunctionDemand(const string& junction, double demand) { };
-    virtual void setJunctionQuality(const string& junction, double quality) { };
-    
-    virtual void setPipeStatus(const string& pipe, Pipe::status_t status) { };
-    virtual void setPumpStatus(const string& pump, Pipe::status_t status) { };
-    virtual void setPumpSetting(const std::string& pump, double setting) { };
-    virtual void setValveSetting(const string& valve, double setting) { };
+    virtual double pipeFlow(const Pipe::_sp& pipe) { return 0; };
+    virtual double pumpEnergy(const Pump::_sp& pump) { return 0; };
+    
+    virtual void setReservoirHead(const Reservoir::_sp& reservoir, double level) { };
+    virtual void setReservoirQuality(const Reservoir::_sp& reservoir, double quality) { };
+    virtual void setTankLevel(const Tank::_sp& tank, double level) { };
+    virtual void setJunctionDemand(const Junction::_sp& junction, double demand) { };
+    virtual void setJunctionQuality(const Junction::_sp& junction, double quality) { };
+    
+    virtual void setPipeStatus(const Pipe::_sp& pipe, Pipe::status_t status) { };
+    virtual void setPumpStatus(const Pump::_sp& pump, Pipe::status_t status) { };
+    virtual void setPumpSetting(const Pump::_sp& pump, double setting) { };
+    virtual void setValveSetting(const Valve::_sp& valve, double setting) { };
+    
+    // bulk access, for engines that can move one state for the whole network at once.
+    // values are indexed by Element::engineIndex(). an engine without bulk access returns false and leaves values empty; the accessors above are then used one element at a time.
+    typedef enum {
+      NodeHead,
+      NodePressure,
+      NodeDemand,
+      NodeQuality,
+      LinkFlow
+    } engineState_t;
+    virtual bool engineStates(engineState_t state, std::vector<double>& values) { return false; };
+    virtual void setJunctionDemands(const std::vector<Junction::_sp>& junctions, const std::vector<double>& demands);
+    virtual void setPipeStatuses(const std::vector<Pipe::_sp>& pipes, const std::vector<Pipe::status_t>& statuses);
     
     virtual bool solveSimulation(time_t time) { return 1; };
     virtual time_t nextHydraulicStep(time_t time) { return 0; };
@@ -254,9 +277,15 @@ namespace RTX {
     bool _shouldRunWaterQuality;
     bool _tanksNeedReset;
     void _checkTanksForReset(time_t time);
+    template<class T, class P> void _engineStatesFor(const std::vector<T>& elements, const std::vector<double>& byIndex, double (Model::*single)(const P&), std::vector<double>& values);
     // master list access
     void add(Junction::_sp newJunction);
     void add(Pipe::_sp newPipe);
+    // state persistence
+    void startStateWriter(std::set<PointRecord::_sp> bulkOperationRecords);
+    void queueNetworkStates(time_t time);
+    void stopStateWriter();
+    void saveQueuedNetworkStates(std::set<PointRecord::_sp> bulkOperationRecords);
     
     
     
@@ -275,6 +304,7 @@ namespace RTX {
     vector<Pump::_sp> _pumps;
     vector<Valve::_sp> _valves;
     vector<Dma::_sp> _dmas;
+    NetworkStateFrames::_sp _stateFrames;
     vector<Pipe::_sp> _dmaPipesToIgnore;
     bool _dmaShouldDetectClosedLinks;
     
@@ -282,12 +312,15 @@ namespace RTX {
     TimeSeries::_sp _relativeError;
     TimeSeries::_sp _iterations;
     TimeSeries::_sp _convergence;
+    TimeSeries::_sp _stateQueueDepth;
+    TimeSeries::_sp _stateWriterLag;
     Clock::_sp _tankResetClock;
     int _qualityTimeStep;
     bool _doesOverrideDemands;
     bool _shouldCancelSimulation;
     
     time_t _currentSimulationTime;
+    time_t _inputReadAheadWindow;
     
     Units _flowUnits, _headUnits, _pressureUnits, _qualityUnits, _volumeUnits;
     boost::signals2::mutex _simulationInProcessMutex;
@@ -42,16 +42,17 @@ int MovingAverage::windowSize() {
 
 
 
-TimeSeries::PointCollection MovingAverage::filterPointsInRange(TimeRange range) {
-  vector<Point> filteredPoints;
-  
+TimeRange MovingAverage::resampleRange(TimeRange range) {
   TimeRange rangeToResample = range;
   if (this->willResample()) {
     // expand range
     rangeToResample.start = this->source()->timeBefore(range.start + 1);
     rangeToResample.end = this->source()->timeAfter(range.end - 1);
   }
-  
+  return rangeToResample;
+}
+
+TimeRange MovingAverage::windowedRange(TimeRange rangeToResample, TimeRange range) {
   TimeRange queryRange = rangeToResample;
   queryRange.correctWithRange(range);
   
@@ -80,6 +81,23 @@ TimeSeries::PointCollection MovingAverage::filterPointsInRange(TimeRange range)
       break; // out of for(rightSeek)
     }
   }
+  return queryRange;
+}
+
+TimeRange MovingAverage::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
+  return this->windowedRange(this->resampleRange(range), range);
+}
+
+
+TimeSeries::PointCollection MovingAverage::filterPointsInRange(TimeRange range) {
+  vector<Point> filteredPoints;
+  
+  TimeRange rangeToResample = this->resampleRange(range);
+  TimeRange queryRange = this->windowedRange(rangeToResample, range);
+  int margin = this->windowSize() / 2;
   
   // get the source's points, but
   // only retain valid points.
@@ -175,13 +193,13 @@ TimeSeries::PointCollection MovingAverage::filterPointsInRange(TimeRange range)
   }
   
   
-  PointCollection outData = PointCollection(filteredPoints, source()->units());
+  PointCollection outData = PointCollection(std::move(filteredPoints), source()->units());
   outData.addQualityFlag(Point::rtx_averaged);
   
   bool dataOk = false;
   dataOk = outData.convertToUnits(this->units());
   if (dataOk && this->willResample()) {
-    set<time_t> timeValues = this->timeValuesInRange(range);
+    TimeGrid timeValues = this->timeValuesInRange(range);
     dataOk = outData.resample(timeValues);
   }
   
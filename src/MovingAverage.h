@@ -30,9 +30,12 @@ namespace RTX {
     
   protected:
     PointCollection filterPointsInRange(TimeRange range);
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     
   private:
     int _windowSize;
+    TimeRange resampleRange(TimeRange range);
+    TimeRange windowedRange(TimeRange resampleRange, TimeRange range);
   };
 }
 
@@ -30,12 +30,35 @@ void MultiplierTimeSeries::setMultiplierMode(MultiplierTimeSeries::MultiplierMod
 }
 
 
+vector<TimeSeries::_sp> MultiplierTimeSeries::upstreamSeries() {
+  vector<TimeSeries::_sp> upstream = TimeSeriesFilterSinglePoint::upstreamSeries();
+  if (this->multiplier()) {
+    upstream.push_back(this->multiplier());
+  }
+  return upstream;
+}
+
+TimeRange MultiplierTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  TimeRange sourceRange = TimeSeriesFilterSinglePoint::upstreamRange(this->source(), range);
+  if (!upstream || upstream != this->multiplier()) {
+    return (upstream == this->source()) ? sourceRange : TimeRange();
+  }
+  
+  // each source point is multiplied by the multiplier, resampled at that point's time.
+  // so the span needed is bracketed by the first and last source points.
+  TimeRange effectiveRange;
+  effectiveRange.start = upstream->timeBefore(sourceRange.start + 1);
+  effectiveRange.end = upstream->timeAfter(sourceRange.end - 1);
+  effectiveRange.correctWithRange(sourceRange);
+  return effectiveRange;
+}
+
+
 Point MultiplierTimeSeries::filteredWithSourcePoint(Point sourcePoint) {
   if (!this->multiplier()) {
     return Point();
   }
-  set<time_t> t;
-  t.insert(sourcePoint.time);
+  TimeGrid t(sourcePoint.time, 1, 1);
   
   // get resampled point at this sourcepoint time value
   TimeRange effectiveRange;
@@ -47,7 +70,7 @@ Point MultiplierTimeSeries::filteredWithSourcePoint(Point sourcePoint) {
   
   PointCollection nativePoints = this->multiplier()->pointCollection(effectiveRange);
   nativePoints.resample(t);
-  vector<Point> multiplierPoint = nativePoints.points;
+  const vector<Point>& multiplierPoint = nativePoints.points;
   
   if (multiplierPoint.size() < 1) {
     return Point();
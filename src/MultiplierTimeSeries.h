@@ -34,6 +34,8 @@ namespace RTX {
     
   protected:
     Point filteredWithSourcePoint(Point sourcePoint);
+    std::vector<TimeSeries::_sp> upstreamSeries();
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     virtual bool canSetSource(TimeSeries::_sp ts);
     virtual void didSetSource(TimeSeries::_sp ts);
     virtual bool canChangeToUnits(Units units);
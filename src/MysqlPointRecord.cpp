@@ -332,6 +332,39 @@ std::vector<Point> MysqlPointRecord::selectRange(const std::string& id, time_t s
 }
 
 
+std::map<std::string, std::vector<Point> > MysqlPointRecord::selectRanges(const std::vector<std::string>& ids, time_t start, time_t end) {
+  std::map<std::string, std::vector<Point> > selected;
+  
+  if (!checkConnection()) {
+    this->dbConnect();
+  }
+  
+  if (checkConnection() && !ids.empty()) {
+    // one statement for all the names; the IN list can't be a prepared parameter, so build it to fit.
+    string q = "SELECT name, time, value, quality, confidence FROM points INNER JOIN timeseries_meta USING (series_id) WHERE time >= ? AND time <= ? AND name IN (?";
+    for (size_t i = 1; i < ids.size(); ++i) {
+      q += ",?";
+    }
+    q += ") order by time asc";
+    
+    boost::shared_ptr<sql::PreparedStatement> rangesSelect( _mysqlCon->prepareStatement(q) );
+    rangesSelect->setInt(1, (int)start);
+    rangesSelect->setInt(2, (int)end);
+    for (size_t i = 0; i < ids.size(); ++i) {
+      rangesSelect->setString(3 + (int)i, ids[i]);
+      selected[ids[i]]; // every series gets an entry, even if it's empty
+    }
+    boost::shared_ptr<sql::ResultSet> results(rangesSelect->executeQuery());
+    while (results->next()) {
+      Point point(results->getInt("time"), results->getDouble("value"), Point::PointQuality(results->getInt("quality")), results->getDouble("confidence"));
+      selected[results->getString("name")].push_back(point);
+    }
+  }
+  
+  return selected;
+}
+
+
 Point MysqlPointRecord::selectNext(const std::string& id, time_t time) {
   return selectSingle(id, time, _nextSelect);
 }
@@ -352,7 +385,7 @@ void MysqlPointRecord::insertSingle(const std::string& id, Point point) {
 }
 
 
-void MysqlPointRecord::insertRange(const std::string& id, std::vector<Point> points) {
+void MysqlPointRecord::insertRange(const std::string& id, const std::vector<Point>& points) {
   
   // first get a list of times already stored here, so that we don't have any overlaps.
   vector<Point> existing;
@@ -364,7 +397,7 @@ void MysqlPointRecord::insertRange(const std::string& id, std::vector<Point> poi
   
   vector<time_t> timeList;
   timeList.reserve(existing.size());
-  BOOST_FOREACH(Point p, existing) {
+  BOOST_FOREACH(const Point& p, existing) {
     timeList.push_back(p.time);
   }
   
@@ -372,7 +405,7 @@ void MysqlPointRecord::insertRange(const std::string& id, std::vector<Point> poi
   bool existingRange = (timeList.size() > 0)? true : false;
   
   if (checkConnection()) {
-    BOOST_FOREACH(Point p, points) {
+    BOOST_FOREACH(const Point& p, points) {
       if (existingRange && find(timeList.begin(), timeList.end(), p.time) != timeList.end()) {
         // have it already
         continue;
@@ -74,10 +74,11 @@ namespace RTX {
     virtual std::vector<Point> selectRange(const std::string& id, time_t startTime, time_t endTime);
     virtual Point selectNext(const std::string& id, time_t time);
     virtual Point selectPrevious(const std::string& id, time_t time);
+    virtual std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime);
     
     // insertions or alterations may choose to ignore / deny
     virtual void insertSingle(const std::string& id, Point point);
-    virtual void insertRange(const std::string& id, std::vector<Point> points);
+    virtual void insertRange(const std::string& id, const std::vector<Point>& points);
     virtual void removeRecord(const std::string& id);
     virtual void truncate();
     
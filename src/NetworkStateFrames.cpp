@@ -0,0 +1,136 @@
+//
+//  NetworkStateFrames.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "NetworkStateFrames.h"
+
+#include <math.h>
+
+using namespace RTX;
+using namespace std;
+
+
+NetworkStateFrames::Frame::Frame() : time(0) {
+  
+}
+
+vector<double>& NetworkStateFrames::Frame::values(int kind, state_t state) {
+  return _values[kind][state];
+}
+
+double NetworkStateFrames::Frame::value(int kind, state_t state, int ordinal) {
+  const vector<double>& v = _values[kind][state];
+  if (ordinal < 0 || (size_t)ordinal >= v.size()) {
+    return NAN;
+  }
+  return v[ordinal];
+}
+
+
+NetworkStateFrames::NetworkStateFrames(size_t capacity) : _committed(0), _finished(0), _closed(false) {
+  _frames.resize(max(capacity, (size_t)2));
+}
+
+size_t NetworkStateFrames::capacity() {
+  boost::mutex::scoped_lock lock(_mutex);
+  return _frames.size();
+}
+
+void NetworkStateFrames::setCapacity(size_t capacity) {
+  boost::mutex::scoped_lock lock(_mutex);
+  _frames.assign(max(capacity, (size_t)2), Frame());
+  _committed = _finished = 0;
+}
+
+
+#pragma mark - Solver
+
+NetworkStateFrames::Frame& NetworkStateFrames::beginFrame(time_t time) {
+  boost::mutex::scoped_lock lock(_mutex);
+  // the slot is free once the frame that last used it, capacity frames ago, is finished.
+  while (_committed - _finished >= _frames.size()) {
+    _changed.wait(lock);
+  }
+  Frame& frame = _frames[_committed % _frames.size()];
+  frame.time = time;
+  return frame;
+}
+
+void NetworkStateFrames::commitFrame() {
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    ++_committed;
+  }
+  _changed.notify_all();
+}
+
+NetworkStateFrames::Frame* NetworkStateFrames::latestFrame() {
+  boost::mutex::scoped_lock lock(_mutex);
+  if (_committed == 0) {
+    return NULL;
+  }
+  return &_frames[(_committed - 1) % _frames.size()];
+}
+
+
+#pragma mark - Writer
+
+bool NetworkStateFrames::nextQueuedFrame(Frame*& frame) {
+  boost::mutex::scoped_lock lock(_mutex);
+  while (_finished == _committed && !_closed) {
+    _changed.wait(lock);
+  }
+  if (_finished == _committed) {
+    return false;
+  }
+  frame = &_frames[_finished % _frames.size()];
+  return true;
+}
+
+void NetworkStateFrames::finishFrame() {
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    ++_finished;
+  }
+  _changed.notify_all();
+}
+
+void NetworkStateFrames::close() {
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _closed = true;
+  }
+  _changed.notify_all();
+}
+
+void NetworkStateFrames::open() {
+  boost::mutex::scoped_lock lock(_mutex);
+  _closed = false;
+}
+
+void NetworkStateFrames::flush() {
+  boost::mutex::scoped_lock lock(_mutex);
+  while (_finished < _committed) {
+    _changed.wait(lock);
+  }
+}
+
+
+#pragma mark - Metrics
+
+size_t NetworkStateFrames::queueDepth() {
+  boost::mutex::scoped_lock lock(_mutex);
+  return _committed - _finished;
+}
+
+time_t NetworkStateFrames::writerLag() {
+  boost::mutex::scoped_lock lock(_mutex);
+  if (_finished == _committed) {
+    return 0;
+  }
+  return _frames[(_committed - 1) % _frames.size()].time - _frames[_finished % _frames.size()].time;
+}
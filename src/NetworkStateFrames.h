@@ -0,0 +1,108 @@
+//
+//  NetworkStateFrames.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__NetworkStateFrames__
+#define __epanet_rtx__NetworkStateFrames__
+
+#include <vector>
+#include <time.h>
+#include <boost/thread.hpp>
+
+#include "rtxMacros.h"
+
+namespace RTX {
+
+  /*!
+   \class NetworkStateFrames
+   \brief A bounded ring of frames of simulated network states, passed from the solver to a writer.
+
+   A frame holds the states of a whole network at one step, as one contiguous array per kind of element and state. Arrays are indexed by an element's ordinal: its position in the model's list of elements of that kind (Model::junctions(), Model::tanks(), ...). The kind is the Element::element_t of that list.
+
+   At each reporting step the solver takes the next frame with beginFrame(), fills it, and queues it with commitFrame(); it is then the latest frame, which elements read through Element::state(). A writer takes queued frames in order with nextQueuedFrame(), persists them, and hands each back with finishFrame(). The solver can fill a frame while up to capacity - 1 earlier frames wait for the writer; beyond that beginFrame() waits for the writer to finish one (backpressure). close() tells the writer that nothing more is coming, once the queue drains.
+
+   Metrics: queueDepth() is the number of frames committed but not yet finished, and writerLag() is the simulated time between the latest frame and the oldest one not yet finished.
+   */
+
+  /*!
+   \fn NetworkStateFrames::NetworkStateFrames(size_t capacity)
+   \brief A ring of frames. At least two, since the latest frame is never handed back to the solver; two lets the writer persist one step while the solver computes the next.
+
+   \fn std::vector<double>& NetworkStateFrames::Frame::values(int kind, state_t state)
+   \brief The array of one state for every element of one kind. Empty if that state was not fetched.
+
+   \fn NetworkStateFrames::Frame& NetworkStateFrames::beginFrame(time_t time)
+   \brief The next frame for the solver to fill. Waits while the ring is full of frames the writer has not finished.
+
+   \fn bool NetworkStateFrames::nextQueuedFrame(Frame*& frame)
+   \brief The oldest committed frame not yet finished. Waits for one; returns false once the ring is closed and empty.
+
+   \fn void NetworkStateFrames::setCapacity(size_t capacity)
+   \brief Resize the ring. Only while nothing is queued; the latest frame is lost.
+   */
+
+  class NetworkStateFrames {
+  public:
+    RTX_SHARED_POINTER(NetworkStateFrames);
+    typedef enum {
+      Head,
+      Pressure,
+      Demand,
+      Quality,
+      Level,
+      Volume,
+      Flow,
+      Energy
+    } state_t;
+
+    class Frame {
+    public:
+      Frame();
+      time_t time;
+      std::vector<double>& values(int kind, state_t state);
+      double value(int kind, state_t state, int ordinal); // NAN if not fetched
+    private:
+      static const int nKinds = 7; // one per Element::element_t
+      static const int nStates = Energy + 1;
+      std::vector<double> _values[nKinds][nStates];
+    };
+
+    NetworkStateFrames(size_t capacity = 2);
+
+    size_t capacity();
+    void setCapacity(size_t capacity);
+
+    // solver
+    Frame& beginFrame(time_t time);
+    void commitFrame();
+    Frame* latestFrame(); // NULL before the first commit
+
+    // writer
+    bool nextQueuedFrame(Frame*& frame);
+    void finishFrame();
+    void close(); // no more frames; the writer returns once the queue drains
+    void open();
+    void flush(); // wait until every committed frame is finished
+
+    // metrics
+    size_t queueDepth();
+    time_t writerLag();
+
+  private:
+    NetworkStateFrames(const NetworkStateFrames&);
+    NetworkStateFrames& operator=(const NetworkStateFrames&);
+
+    std::vector<Frame> _frames;
+    unsigned long _committed, _finished; // frame n lives in _frames[n % capacity]
+    bool _closed;
+    boost::mutex _mutex;
+    boost::condition_variable _changed;
+  };
+
+}
+
+#endif /* defined(__epanet_rtx__NetworkStateFrames__) */
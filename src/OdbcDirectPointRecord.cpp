@@ -1,10 +1,12 @@
 #include "OdbcDirectPointRecord.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
 
 #include <iostream>
 
 #define RTX_ODBCDIRECT_MAX_RETRY 5
+#define RTX_ODBCDIRECT_MAX_RANGES_IDS 500
 
 using namespace RTX;
 using namespace std;
@@ -120,6 +122,54 @@ std::vector<Point> OdbcDirectPointRecord::selectRange(const std::string& id, tim
   return points;
 }
 
+std::map<std::string, std::vector<Point> > OdbcDirectPointRecord::selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime) {
+  
+  if (RTX_STRINGS_ARE_EQUAL(_querySyntax.multiRangeSelect, "")) {
+    return DbPointRecord::selectRanges(ids, startTime, endTime);
+  }
+  
+  this->checkConnected();
+  
+  map<string, vector<Point> > selected;
+  
+  // the ids go into the query text, so keep the IN list to a size any server will take.
+  for (size_t first = 0; first < ids.size(); first += RTX_ODBCDIRECT_MAX_RANGES_IDS) {
+    vector<string> batch(ids.begin() + first, ids.begin() + min(ids.size(), first + RTX_ODBCDIRECT_MAX_RANGES_IDS));
+    string q = this->stringQueryForRanges(batch, startTime, endTime);
+    map<string, vector<Point> > batchSelected;
+    SQLHSTMT rangeStmt = 0;
+    
+    bool fetchSuccess = false;
+    int iFetchAttempt = 0;
+    do {
+      {
+        scoped_lock<boost::signals2::mutex> lock(_odbcMutex);
+        SQLAllocHandle(SQL_HANDLE_STMT, _handles.SCADAdbc, &rangeStmt);
+        if (SQL_SUCCEEDED(SQLExecDirect(rangeStmt, (SQLCHAR*)q.c_str(), SQL_NTS))) {
+          fetchSuccess = true;
+          batchSelected = this->pointsByTagFromStatement(rangeStmt);
+        }
+        SQLFreeStmt(rangeStmt, SQL_CLOSE);
+        SQLFreeHandle(SQL_HANDLE_STMT, rangeStmt);
+      }
+      
+      if(!fetchSuccess) {
+        {
+          scoped_lock<boost::signals2::mutex> lock(_odbcMutex);
+          cerr << extract_error("SQLExecDirect", rangeStmt, SQL_HANDLE_STMT) << endl;
+          cerr << "query did not succeed: " << q << endl;
+        }
+        this->dbConnect();
+      }
+      ++iFetchAttempt;
+    } while (!fetchSuccess && iFetchAttempt < RTX_ODBCDIRECT_MAX_RETRY);
+    
+    selected.insert(batchSelected.begin(), batchSelected.end()); // batches don't share ids
+  }
+  
+  return selected;
+}
+
 Point OdbcDirectPointRecord::selectNext(const std::string& id, time_t time) {
   scoped_lock<boost::signals2::mutex> lock(_odbcMutex);
   this->checkConnected();
@@ -291,8 +341,19 @@ Point OdbcDirectPointRecord::selectPreviousIteratively(const std::string &id, ti
 
 
 std::string OdbcDirectPointRecord::stringQueryForRange(const std::string& id, time_t start, time_t end) {
+  return this->stringQueryWithIdsAndRange(_querySyntax.rangeSelect, "'" + id + "'", start, end);
+}
+
+std::string OdbcDirectPointRecord::stringQueryForRanges(const std::vector<std::string>& ids, time_t start, time_t end) {
+  vector<string> quoted;
+  BOOST_FOREACH(const string& id, ids) {
+    quoted.push_back("'" + id + "'");
+  }
+  return this->stringQueryWithIdsAndRange(_querySyntax.multiRangeSelect, boost::algorithm::join(quoted, ","), start, end);
+}
+
+std::string OdbcDirectPointRecord::stringQueryWithIdsAndRange(std::string query, const std::string& idStr, time_t start, time_t end) {
   
-  string query = _querySyntax.rangeSelect;
   string startStr,endStr;
   
   if (this->timeFormat() == PointRecordTime::UTC) {
@@ -306,7 +367,6 @@ std::string OdbcDirectPointRecord::stringQueryForRange(const std::string& id, ti
   
   string startDateStr = "'" + startStr + "'"; // minus one because of wonderware's bullshit "initial value" in delta retrieval.
   string endDateStr = "'" + endStr + "'"; // because wonderware does fractional seconds
-  string idStr = "'" + id + "'";
   
   boost::replace_first(query, "?", idStr);
   boost::replace_first(query, "?", startDateStr);
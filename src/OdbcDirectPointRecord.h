@@ -27,6 +27,7 @@ namespace RTX {
     std::vector<Point> selectRange(const std::string& id, time_t startTime, time_t endTime);
     Point selectNext(const std::string& id, time_t time);
     Point selectPrevious(const std::string& id, time_t time);
+    std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime);
     
     
   private:
@@ -37,6 +38,8 @@ namespace RTX {
     Point selectPreviousIteratively(const std::string& id, time_t time);
     
     std::string stringQueryForRange(const std::string& id, time_t start, time_t end);
+    std::string stringQueryForRanges(const std::vector<std::string>& ids, time_t start, time_t end);
+    std::string stringQueryWithIdsAndRange(std::string query, const std::string& idStr, time_t start, time_t end);
     std::string stringQueryForSinglyBoundedRange(const std::string& id, time_t bound, OdbcQueryBoundType boundType);
     std::string stringQueryForIds();
 //    SQLHSTMT _directTagQueryStmt, _directRangeQueryStmt;
@@ -116,6 +116,7 @@ map<OdbcPointRecord::Sql_Connector_t, OdbcPointRecord::OdbcQuery> OdbcPointRecor
   wwQueries.singleSelect = "SELECT #DATECOL#, #VALUECOL#, #QUALITYCOL# FROM #TABLENAME# WHERE #TAGCOL# = ? AND (#DATECOL# = ?) AND wwTimeZone = 'UTC'";
   //wwQueries.rangeSelect =  "SELECT #DATECOL#, #TAGCOL#, #VALUECOL#, #QUALITYCOL# FROM #TABLENAME# WHERE (#DATECOL# >= ?) AND (#DATECOL# <= ?) AND #TAGCOL# = ? AND wwTimeZone = 'UTC' ORDER BY #DATECOL# asc"; // experimentally, ORDER BY is much slower. wonderware always returns rows ordered by DateTime ascending, so this is not really necessary.
   wwQueries.rangeSelect =  "SELECT #DATECOL#, #VALUECOL#, #QUALITYCOL# FROM #TABLENAME# WHERE #TAGCOL# = ? AND (#DATECOL# > ?) AND (#DATECOL# <= ?) AND wwTimeZone = 'UTC'";
+  wwQueries.multiRangeSelect =  "SELECT #DATECOL#, #VALUECOL#, #QUALITYCOL#, #TAGCOL# FROM #TABLENAME# WHERE #TAGCOL# IN (?) AND (#DATECOL# > ?) AND (#DATECOL# <= ?) AND wwTimeZone = 'UTC'";
   wwQueries.lowerBound = "";
   wwQueries.upperBound = "";
   wwQueries.timeQuery = "SELECT CONVERT(datetime, GETDATE()) AS DT";
@@ -127,6 +128,7 @@ map<OdbcPointRecord::Sql_Connector_t, OdbcPointRecord::OdbcQuery> OdbcPointRecor
   oraQueries.connectorName = "oracle";
   oraQueries.singleSelect = "";
   oraQueries.rangeSelect = "SELECT #DATECOL#, #VALUECOL#, #QUALITYCOL# FROM #TABLENAME# WHERE #TAGCOL# = ? AND (#DATECOL# >= ?) AND (#DATECOL# <= ?) ORDER BY #DATECOL# asc";
+  oraQueries.multiRangeSelect = "SELECT #DATECOL#, #VALUECOL#, #QUALITYCOL#, #TAGCOL# FROM #TABLENAME# WHERE #TAGCOL# IN (?) AND (#DATECOL# >= ?) AND (#DATECOL# <= ?) ORDER BY #DATECOL# asc";
   oraQueries.lowerBound = "";
   oraQueries.upperBound = "";
   oraQueries.timeQuery = "select sysdate from dual";
@@ -136,6 +138,7 @@ map<OdbcPointRecord::Sql_Connector_t, OdbcPointRecord::OdbcQuery> OdbcPointRecor
   OdbcQuery mssqlQueries = wwQueries;
   mssqlQueries.connectorName = "mssql";
   mssqlQueries.rangeSelect =  "SELECT #DATECOL#, #VALUECOL#, #QUALITYCOL# FROM #TABLENAME# WHERE #TAGCOL# = ? AND (#DATECOL# >= ?) AND (#DATECOL# <= ?)"; // ORDER BY #DATECOL# asc";
+  mssqlQueries.multiRangeSelect =  "SELECT #DATECOL#, #VALUECOL#, #QUALITYCOL#, #TAGCOL# FROM #TABLENAME# WHERE #TAGCOL# IN (?) AND (#DATECOL# >= ?) AND (#DATECOL# <= ?)";
   
 //  mssqlQueries.lowerBound = "SELECT TOP(1) #DATECOL#, #VALUECOL#, #QUALITYCOL# FROM #TABLENAME# WHERE #TAGCOL# = ? AND (#DATECOL# < ?) ORDER BY #DATECOL# ASC";
 //  mssqlQueries.upperBound = "SELECT TOP(1) #DATECOL#, #VALUECOL#, #QUALITYCOL# FROM #TABLENAME# WHERE #TAGCOL# = ? AND (#DATECOL# > ?) ORDER BY #DATECOL# DESC";
@@ -234,6 +237,7 @@ void OdbcPointRecord::rebuildQueries() {
     vector<string*> querystrings;
     querystrings.push_back(&_querySyntax.singleSelect);
     querystrings.push_back(&_querySyntax.rangeSelect);
+    querystrings.push_back(&_querySyntax.multiRangeSelect);
     querystrings.push_back(&_querySyntax.upperBound);
     querystrings.push_back(&_querySyntax.lowerBound);
     
@@ -361,26 +365,10 @@ std::vector<Point> OdbcPointRecord::pointsFromStatement(SQLHSTMT statement) {
   SQL_CHECK(SQLFreeStmt(statement, SQL_UNBIND), "SQL_UNBIND", statement, SQL_HANDLE_STMT);
   
   BOOST_FOREACH(const ScadaRecord& record, records) {
-    Point p;
-    time_t t;
-    if (_timeFormat == PointRecordTime::UTC) {
-      t = PointRecordTime::time(record.time);
-    }
-    else {
-      t = PointRecordTime::timeFromZone(record.time, _specifiedTimeZone);
-    }
-    double v = record.value;
-    Point::PointQuality q = Point::opc_good;
-    q = (Point::PointQuality)record.quality;
-    
-    if (record.valueInd > 0) {
-      // ok
-      p = Point(t, v, q, 0.);
+    Point p = this->pointFromRecord(record);
+    if (p.isValid) {
       points.push_back(p);
     }
-    else {
-      // nothing
-    }
   }
   
   // make sure the points are sorted
@@ -390,6 +378,71 @@ std::vector<Point> OdbcPointRecord::pointsFromStatement(SQLHSTMT statement) {
 }
 
 
+// same, for a multiRangeSelect: the tag name comes back in a fourth column.
+std::map<std::string, std::vector<Point> > OdbcPointRecord::pointsByTagFromStatement(SQLHSTMT statement) {
+  map<string, vector<Point> > pointsByTag;
+  vector< pair<string, ScadaRecord> > records;
+  SQLCHAR tagName[MAX_SCADA_TAG];
+  SQLLEN tagNameInd;
+  
+  this->bindOutputColumns(statement, &_tempRecord);
+  
+  try {
+    if (statement == NULL) {
+      throw string("Connection not initialized.");
+    }
+    SQL_CHECK(SQLBindCol(statement, 4, SQL_C_CHAR, tagName, MAX_SCADA_TAG, &tagNameInd), "SQLBindCol", statement, SQL_HANDLE_STMT);
+    while (SQL_SUCCEEDED(SQLFetch(statement))) {
+      // a null tag (SQL_NULL_DATA) belongs to no series, and a truncated one (SQL_NO_TOTAL, or too long
+      // for the buffer) can't name a series we asked for. the buffer still holds the last row's tag.
+      if (tagNameInd < 0 || tagNameInd >= MAX_SCADA_TAG) {
+        continue;
+      }
+      records.push_back(make_pair(string((char*)tagName, (size_t)tagNameInd), _tempRecord));
+    }
+  }
+  catch(string errorMessage) {
+    cerr << errorMessage << endl;
+    cerr << "Could not get data from db connection\n";
+    cerr << "Attempting to reconnect..." << endl;
+    this->dbConnect();
+    cerr << "Connection returned " << this->isConnected() << endl;
+  }
+  
+  SQL_CHECK(SQLFreeStmt(statement, SQL_UNBIND), "SQL_UNBIND", statement, SQL_HANDLE_STMT);
+  
+  typedef pair<string, ScadaRecord> tagRecordPair;
+  BOOST_FOREACH(const tagRecordPair& record, records) {
+    Point p = this->pointFromRecord(record.second);
+    if (p.isValid) {
+      pointsByTag[record.first].push_back(p);
+    }
+  }
+  
+  typedef pair<const string, vector<Point> > tagPointsPair;
+  BOOST_FOREACH(tagPointsPair& tagPoints, pointsByTag) {
+    std::sort(tagPoints.second.begin(), tagPoints.second.end(), &Point::comparePointTime);
+  }
+  
+  return pointsByTag;
+}
+
+
+Point OdbcPointRecord::pointFromRecord(const ScadaRecord& record) {
+  if (record.valueInd <= 0) {
+    return Point(); // null value
+  }
+  time_t t;
+  if (_timeFormat == PointRecordTime::UTC) {
+    t = PointRecordTime::time(record.time);
+  }
+  else {
+    t = PointRecordTime::timeFromZone(record.time, _specifiedTimeZone);
+  }
+  return Point(t, record.value, (Point::PointQuality)record.quality, 0.);
+}
+
+
 bool OdbcPointRecord::supportsBoundedQueries() {
   return (!RTX_STRINGS_ARE_EQUAL(_querySyntax.upperBound, "") && !RTX_STRINGS_ARE_EQUAL(_querySyntax.lowerBound, ""));
 }
@@ -53,7 +53,7 @@ namespace RTX {
     
     class OdbcQuery {
     public:
-      std::string connectorName, singleSelect, rangeSelect, upperBound, lowerBound, timeQuery;
+      std::string connectorName, singleSelect, rangeSelect, multiRangeSelect, upperBound, lowerBound, timeQuery;
     };
     
     class OdbcTableDescription {
@@ -131,7 +131,7 @@ namespace RTX {
     // insertions or alterations may choose to ignore / deny
     // pseudo-abstract base is no-op
     virtual void insertSingle(const std::string& id, Point point) {};
-    virtual void insertRange(const std::string& id, std::vector<Point> points) {};
+    virtual void insertRange(const std::string& id, const std::vector<Point>& points) {};
     virtual void removeRecord(const std::string& id) {};
     virtual void truncate() {};
     
@@ -167,6 +167,8 @@ namespace RTX {
     void bindOutputColumns(SQLHSTMT statement, ScadaRecord* record);
     
     std::vector<Point> pointsFromStatement(SQLHSTMT statement);
+    std::map<std::string, std::vector<Point> > pointsByTagFromStatement(SQLHSTMT statement);
+    Point pointFromRecord(const ScadaRecord& record);
     std::string extract_error(std::string function, SQLHANDLE handle, SQLSMALLINT type);
     
     
@@ -43,8 +43,7 @@ bool OutlierExclusionTimeSeries::willResample() {
   return TimeSeriesFilter::willResample() || ( this->clock() );
 }
 
-TimeSeries::PointCollection OutlierExclusionTimeSeries::filterPointsInRange(TimeRange range) {
-  
+TimeRange OutlierExclusionTimeSeries::sourceQueryRange(TimeRange range) {
   // if we are to resample, then there's a possibility that we need to expand the range
   // used to query the source ts. but we have to limit the search to something reasonable, in case
   // too many points are excluded. yikes!
@@ -55,12 +54,27 @@ TimeSeries::PointCollection OutlierExclusionTimeSeries::filterPointsInRange(Time
     sourceQuery.start -= range.duration();
     sourceQuery.end += range.duration();
   }
+  return sourceQuery;
+}
+
+TimeRange OutlierExclusionTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
+  // raw points, plus a stats window around each of them
+  return this->windowedRange(this->sourceQueryRange(range));
+}
+
+
+TimeSeries::PointCollection OutlierExclusionTimeSeries::filterPointsInRange(TimeRange range) {
+  
+  TimeRange sourceQuery = this->sourceQueryRange(range);
 
   // get raw values, exclude outliers, then resample if needed.
   PointCollection raw = this->source()->pointCollection(sourceQuery);
-  set<time_t> rawTimes = raw.times();
+  TimeGrid rawTimes = raw.times();
   
-  set<time_t> proposedOutTimes; // = this->timeValuesInRange(range); // can't do this because recursion.
+  TimeGrid proposedOutTimes; // = this->timeValuesInRange(range); // can't do this because recursion.
   if (this->clock()) {
     proposedOutTimes = this->clock()->timeValuesInRange(range);
   }
@@ -91,7 +105,7 @@ TimeSeries::PointCollection OutlierExclusionTimeSeries::filterPointsInRange(Time
     }
   }// end for each raw point
   
-  PointCollection outCollection(goodPoints, this->units());
+  PointCollection outCollection(std::move(goodPoints), this->units());
   if (this->willResample()) {
     outCollection.resample(proposedOutTimes);
   }
@@ -110,8 +124,12 @@ Point OutlierExclusionTimeSeries::pointWithCollectionAndPoint(RTX::TimeSeries::P
   switch (this->exclusionMode()) {
     case OutlierExclusionModeInterquartileRange:
     {
-      q25 = col.percentile(.25);
-      q75 = col.percentile(.75);
+      vector<double> quartiles;
+      quartiles.push_back(.25);
+      quartiles.push_back(.75);
+      PointCollection::Summary summary = col.summary(quartiles);
+      q25 = summary.quantile(.25);
+      q75 = summary.quantile(.75);
       iqr = q75 - q25;
       if ( !( (p.value < q25 - m*iqr) || (m*iqr + q75 < p.value) )) {
         // store the point if it's within bounds
@@ -121,8 +139,9 @@ Point OutlierExclusionTimeSeries::pointWithCollectionAndPoint(RTX::TimeSeries::P
       break; // OutlierExclusionModeInterquartileRange
     case OutlierExclusionModeStdDeviation:
     {
-      mean = col.mean();
-      stddev = sqrt(col.variance());
+      PointCollection::Summary summary = col.summary();
+      mean = summary.mean;
+      stddev = sqrt(summary.variance);
       if ( fabs(mean - p.value) <= (m * stddev) ) {
         pOut = Point::convertPoint(p, this->source()->units(), this->units());
       }
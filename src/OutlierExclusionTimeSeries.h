@@ -42,6 +42,7 @@ namespace RTX {
   protected:
     virtual bool willResample();
     PointCollection filterPointsInRange(TimeRange range);
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     bool canDropPoints() { return true;};
 //    bool canSetSource(TimeSeries::_sp ts);
 //    void didSetSource(TimeSeries::_sp ts);
@@ -51,6 +52,7 @@ namespace RTX {
     double _outlierMultiplier;
     exclusion_mode_t _exclusionMode;
     Point pointWithCollectionAndPoint(PointCollection c, Point p);
+    TimeRange sourceQueryRange(TimeRange range);
   };
 }
 
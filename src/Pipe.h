@@ -38,9 +38,6 @@ namespace RTX {
     // states
     TimeSeries::_sp flow();
     
-    // public ivars for temporary (that is, steady-state) solutions
-    double state_flow;
-    
     // parameters
     TimeSeries::_sp statusParameter();
     void setStatusParameter(TimeSeries::_sp status);
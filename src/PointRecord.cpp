@@ -10,12 +10,13 @@
 
 #include "PointRecord.h"
 #include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
 
 using namespace RTX;
 using namespace std;
 
 
-PointRecord::PointRecord() : _name("") {
+PointRecord::PointRecord() : _name(""), _maxConcurrentReads(0), _activeReads(0) {
 }
 
 
@@ -39,8 +40,10 @@ std::ostream& PointRecord::toStream(std::ostream &stream) {
 
 
 bool PointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) {
-  if (_singlePointCache.find(recordName) == _singlePointCache.end()) {
-    _singlePointCache[recordName] = Point();
+  handle_t handle = this->handleForIdentifier(recordName);
+  boost::mutex::scoped_lock lock(_singlePointCacheMutex);
+  if ((size_t)handle >= _singlePointCache.size()) {
+    _singlePointCache.resize(handle + 1);
   }
   return true;
 }
@@ -54,8 +57,10 @@ const map<string, Units> PointRecord::identifiersAndUnits() {
 Point PointRecord::point(const string& identifier, time_t time) {
   // return the cached point if it is valid
   
-  if (_singlePointCache.find(identifier) != _singlePointCache.end()) {
-    Point p = _singlePointCache[identifier];
+  handle_t handle = this->existingHandle(identifier);
+  boost::mutex::scoped_lock lock(_singlePointCacheMutex);
+  if (handle != RTX_NO_HANDLE && (size_t)handle < _singlePointCache.size()) {
+    Point p = _singlePointCache[handle];
     if (p.time == time) {
       return p;
     }
@@ -105,14 +110,16 @@ PointRecord::time_pair_t PointRecord::range(const string& id) {
 void PointRecord::addPoint(const string& identifier, Point point) {
   // Cache this single point
   
-  if (_singlePointCache.find(identifier) != _singlePointCache.end()) {
-    _singlePointCache[identifier] = point;
+  handle_t handle = this->existingHandle(identifier);
+  boost::mutex::scoped_lock lock(_singlePointCacheMutex);
+  if (handle != RTX_NO_HANDLE && (size_t)handle < _singlePointCache.size()) {
+    _singlePointCache[handle] = point;
   }
   
 }
 
 
-void PointRecord::addPoints(const string& identifier, std::vector<Point> points) {
+void PointRecord::addPoints(const string& identifier, const std::vector<Point>& points) {
   
 }
 
@@ -126,3 +133,92 @@ void PointRecord::reset(const string& identifier) {
 }
 
 
+#pragma mark - Handles
+
+PointRecord::handle_t PointRecord::handleForIdentifier(const string& identifier) {
+  handle_t handle = this->existingHandle(identifier);
+  if (handle != RTX_NO_HANDLE) {
+    return handle;
+  }
+  boost::unique_lock<boost::shared_mutex> lock(_handleMutex);
+  map<string, handle_t>::const_iterator found = _handles.find(identifier);
+  if (found != _handles.end()) {
+    return found->second; // assigned while we waited
+  }
+  handle = (handle_t)_identifiers.size();
+  _identifiers.push_back(identifier);
+  _handles[identifier] = handle;
+  return handle;
+}
+
+PointRecord::handle_t PointRecord::existingHandle(const string& identifier) {
+  boost::shared_lock<boost::shared_mutex> lock(_handleMutex);
+  map<string, handle_t>::const_iterator found = _handles.find(identifier);
+  return (found == _handles.end()) ? RTX_NO_HANDLE : found->second;
+}
+
+std::string PointRecord::identifierForHandle(handle_t handle) {
+  boost::shared_lock<boost::shared_mutex> lock(_handleMutex);
+  if (handle < 0 || (size_t)handle >= _identifiers.size()) {
+    return string();
+  }
+  return _identifiers[handle];
+}
+
+
+// compatibility: records that only know identifiers get them back here.
+Point PointRecord::point(handle_t handle, time_t time) {
+  return this->point(this->identifierForHandle(handle), time);
+}
+
+Point PointRecord::pointBefore(handle_t handle, time_t time) {
+  return this->pointBefore(this->identifierForHandle(handle), time);
+}
+
+Point PointRecord::pointAfter(handle_t handle, time_t time) {
+  return this->pointAfter(this->identifierForHandle(handle), time);
+}
+
+std::vector<Point> PointRecord::pointsInRange(handle_t handle, time_t startTime, time_t endTime) {
+  return this->pointsInRange(this->identifierForHandle(handle), startTime, endTime);
+}
+
+void PointRecord::addPoint(handle_t handle, Point point) {
+  this->addPoint(this->identifierForHandle(handle), point);
+}
+
+void PointRecord::addPoints(handle_t handle, const std::vector<Point>& points) {
+  this->addPoints(this->identifierForHandle(handle), points);
+}
+
+
+#pragma mark - Concurrency
+
+int PointRecord::maxConcurrentReads() {
+  boost::mutex::scoped_lock lock(_readSlotMutex);
+  return _maxConcurrentReads;
+}
+
+void PointRecord::setMaxConcurrentReads(int n) {
+  boost::mutex::scoped_lock lock(_readSlotMutex);
+  _maxConcurrentReads = (n > 0) ? n : 0;
+  _readSlotCondition.notify_all();
+}
+
+void PointRecord::acquireReadSlot() {
+  boost::mutex::scoped_lock lock(_readSlotMutex);
+  while (_maxConcurrentReads > 0 && _activeReads >= _maxConcurrentReads) {
+    _readSlotCondition.wait(lock);
+  }
+  ++_activeReads;
+}
+
+void PointRecord::releaseReadSlot() {
+  boost::mutex::scoped_lock lock(_readSlotMutex);
+  if (_activeReads > 0) {
+    --_activeReads;
+  }
+  _readSlotCondition.notify_one();
+}
+
+
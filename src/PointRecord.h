@@ -16,6 +16,10 @@
 #include <fstream>
 #include <map>
 
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
 #include "Point.h"
 #include "Units.h"
 #include "rtxMacros.h"
@@ -23,6 +27,8 @@
 
 using std::string;
 
+#define RTX_NO_HANDLE (-1)
+
 namespace RTX {
   
   /*! 
@@ -49,6 +55,19 @@ namespace RTX {
    \return The requested Points (as a vector of shared pointers)
    \sa Point
    */
+  /*!
+   \fn void PointRecord::setMaxConcurrentReads(int n)
+   \brief Limit the number of branches of a TimeSeries graph that may read from this record at once.
+   \param n The maximum number of concurrent readers, or 0 for no limit.
+   
+   Parallel fetches (see TimeSeriesFetchPool) hold a read slot on every bounded record a branch depends on. Memory-backed records are unbounded; database records default to a single reader, since most backends share one connection.
+   */
+  /*!
+   \fn PointRecord::handle_t PointRecord::handleForIdentifier(const std::string& identifier)
+   \brief A small integer standing for an identifier in this record, assigned on first request.
+   
+   Handles are dense and never reused, so a subclass can keep its per-series state in a vector indexed by handle. Each point, range and insert method has a handle overload; by default it looks up the identifier and calls the string version, and subclasses override both to skip the lookup. TimeSeries asks its record for a handle whenever it registers, and uses the handle from then on.
+   */
   
     
   class PointRecord {
@@ -59,6 +78,7 @@ namespace RTX {
     
     RTX_SHARED_POINTER(PointRecord);
     typedef std::pair<time_t, time_t> time_pair_t;
+    typedef int handle_t;
     
     PointRecord();
     virtual ~PointRecord() {};
@@ -75,7 +95,7 @@ namespace RTX {
     virtual Point pointAfter(const string& identifier, time_t time);
     virtual std::vector<Point> pointsInRange(const string& identifier, time_t startTime, time_t endTime);
     virtual void addPoint(const string& identifier, Point point);
-    virtual void addPoints(const string& identifier, std::vector<Point> points);
+    virtual void addPoints(const string& identifier, const std::vector<Point>& points);
     virtual void reset(); // clear memcache for all ids
     virtual void reset(const string& identifier); // clear memcache for just this id
     virtual void invalidate(const string& identifier) {reset(identifier);}; // alias here, override for database implementations
@@ -83,20 +103,43 @@ namespace RTX {
     virtual Point lastPoint(const string& id);
     virtual time_pair_t range(const string& id);
     
+    handle_t handleForIdentifier(const string& identifier);
+    std::string identifierForHandle(handle_t handle);
+    virtual Point point(handle_t handle, time_t time);
+    virtual Point pointBefore(handle_t handle, time_t time);
+    virtual Point pointAfter(handle_t handle, time_t time);
+    virtual std::vector<Point> pointsInRange(handle_t handle, time_t startTime, time_t endTime);
+    virtual void addPoint(handle_t handle, Point point);
+    virtual void addPoints(handle_t handle, const std::vector<Point>& points);
+    
     virtual std::ostream& toStream(std::ostream &stream);
     
     virtual void beginBulkOperation() {};
     virtual void endBulkOperation() {};
+    
+    int maxConcurrentReads();
+    void setMaxConcurrentReads(int n);
+    void acquireReadSlot(); // blocks while the record is at its limit
+    void releaseReadSlot();
 
   protected:
+    handle_t existingHandle(const string& identifier); // RTX_NO_HANDLE if none was ever assigned
+    
 //    std::string _cachedPointId;
 //    Point _cachedPoint;
     
-    std::map<std::string,Point> _singlePointCache;
+    std::vector<Point> _singlePointCache; // by handle
+    boost::mutex _singlePointCacheMutex; // guards _singlePointCache: registration, reads and writes may run on different threads
 //    std::map<std::string, std::vector<Point> > _pointVectorCache;
     
   private:
     std::string _name;
+    int _maxConcurrentReads, _activeReads;
+    boost::mutex _readSlotMutex;
+    boost::condition_variable _readSlotCondition;
+    std::map<std::string, handle_t> _handles;
+    std::vector<std::string> _identifiers; // by handle
+    boost::shared_mutex _handleMutex;
   
   };
   
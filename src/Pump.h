@@ -22,7 +22,6 @@ namespace RTX {
     
     // states
     TimeSeries::_sp energy();
-    double energy_state;
     
     // parameters
     TimeSeries::_sp curveParameter();
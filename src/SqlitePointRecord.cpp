@@ -1,5 +1,7 @@
 #include "SqlitePointRecord.h"
 #include <boost/foreach.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <cstring>
 
 using namespace RTX;
 using namespace std;
@@ -9,12 +11,243 @@ using namespace std;
 using boost::signals2::mutex;
 using boost::interprocess::scoped_lock;
 
-static int sqlitePointRecordCurrentDbVersion = 2;
+static int sqlitePointRecordCurrentDbVersion = 3;
+static const int sqlitePointRecordChunkedDbVersion = 4; // optional: points kept in compressed chunks (connection option storage=chunks)
+static const int sqlitePointRecordBulkInsertRows = 100; // rows per multi-row insert: 5 parameters each, well under sqlite's limit
+static const time_t sqlitePointRecordChunkDuration = 24 * 60 * 60; // part of the schema: changing it means migrating the chunks
+static const size_t sqlitePointRecordChunkPendingPoints = 1 << 20; // points queued by bulk operations on a chunked file before they're written (~32 MB)
 
 typedef const unsigned char* sqltext;
 
 /******************************************************************************************/
-static string initTablesStr = "CREATE TABLE 'meta' ('series_id' INTEGER PRIMARY KEY ASC AUTOINCREMENT, 'name' TEXT UNIQUE ON CONFLICT ABORT, 'units' TEXT, 'regular_period' INTEGER, 'regular_offset' INTEGER); CREATE TABLE 'points' ('time' INTEGER, 'series_id' INTEGER REFERENCES 'meta'('series_id'), 'value' REAL, 'confidence' REAL, 'quality' INTEGER, UNIQUE (series_id, time asc) ON CONFLICT IGNORE); PRAGMA user_version = 2";
+static string initTablesStr = "CREATE TABLE 'meta' ('series_id' INTEGER PRIMARY KEY ASC AUTOINCREMENT, 'name' TEXT UNIQUE ON CONFLICT ABORT, 'units' TEXT, 'regular_period' INTEGER, 'regular_offset' INTEGER); CREATE TABLE 'points' ('time' INTEGER, 'series_id' INTEGER REFERENCES 'meta'('series_id'), 'value' REAL, 'confidence' REAL, 'quality' INTEGER, UNIQUE (series_id, time asc) ON CONFLICT IGNORE); CREATE INDEX 'points_covering' ON 'points' ('series_id', 'time', 'value', 'quality', 'confidence'); PRAGMA user_version = 3";
+static string initChunksStr = "CREATE TABLE 'chunks' ('series_id' INTEGER REFERENCES 'meta'('series_id'), 'start' INTEGER, 'first_time' INTEGER, 'last_time' INTEGER, 'count' INTEGER, 'data' BLOB, PRIMARY KEY (series_id, start)) WITHOUT ROWID";
+/******************************************************************************************/
+
+/******************************************************************************************/
+// chunk encoding (schema version 4). one chunk holds a series' points within one
+// sqlitePointRecordChunkDuration, in time order, packed into a bit stream:
+//   a 32-bit count, then the first point as-is (64-bit time, 64-bit value, 8-bit quality, 64-bit confidence),
+//   then for each following point:
+//   - time as a delta-of-delta: '0' for a regular step, else '10', '110' or '1110' and 7, 9 or 12 bits, or '1111' and 64 bits
+//   - value and confidence XORed with the previous ones: '0' if unchanged, '10' and the changed bits if they fit
+//     within the previous window of meaningful bits, else '11', 5 bits of leading zeros, 6 bits of length, and the bits
+//   - quality: '0' if unchanged, else '1' and 8 bits
+namespace {
+  
+  class BitWriter {
+  public:
+    BitWriter() : _free(0) {}
+    void write(uint64_t bits, int n) {
+      while (n > 0) {
+        if (_free == 0) {
+          _bytes.push_back(0);
+          _free = 8;
+        }
+        int take = min(n, _free);
+        uint8_t chunk = (uint8_t)((bits >> (n - take)) & ((1u << take) - 1));
+        _bytes.back() |= (uint8_t)(chunk << (_free - take));
+        _free -= take;
+        n -= take;
+      }
+    }
+    const vector<uint8_t>& bytes() { return _bytes; }
+  private:
+    vector<uint8_t> _bytes;
+    int _free;
+  };
+  
+  class BitReader {
+  public:
+    BitReader(const uint8_t* data, size_t size) : _data(data), _size(size), _pos(0), _bit(0) {}
+    uint64_t read(int n) {
+      uint64_t bits = 0;
+      while (n > 0) {
+        if (_pos >= _size) {
+          return bits << n; // truncated: pad with zeros
+        }
+        int avail = 8 - _bit;
+        int take = min(n, avail);
+        uint64_t chunk = (_data[_pos] >> (avail - take)) & ((1u << take) - 1);
+        bits = (bits << take) | chunk;
+        _bit += take;
+        n -= take;
+        if (_bit == 8) {
+          _bit = 0;
+          ++_pos;
+        }
+      }
+      return bits;
+    }
+  private:
+    const uint8_t* _data;
+    size_t _size, _pos;
+    int _bit;
+  };
+  
+  // the previous value's bits, and its window of meaningful bits
+  struct XorState {
+    XorState() : bits(0), leading(-1), trailing(0) {}
+    uint64_t bits;
+    int leading, trailing;
+  };
+  
+  uint64_t doubleBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+  
+  double bitsDouble(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  
+  void writeXor(BitWriter& w, XorState& s, double value) {
+    uint64_t bits = doubleBits(value);
+    uint64_t x = bits ^ s.bits;
+    s.bits = bits;
+    if (x == 0) {
+      w.write(0, 1);
+      return;
+    }
+    int leading = min(__builtin_clzll(x), 31);
+    int trailing = __builtin_ctzll(x);
+    if (s.leading >= 0 && leading >= s.leading && trailing >= s.trailing) {
+      w.write(2, 2);
+      w.write(x >> s.trailing, 64 - s.leading - s.trailing);
+    }
+    else {
+      int meaningful = 64 - leading - trailing;
+      w.write(3, 2);
+      w.write(leading, 5);
+      w.write(meaningful - 1, 6);
+      w.write(x >> trailing, meaningful);
+      s.leading = leading;
+      s.trailing = trailing;
+    }
+  }
+  
+  double readXor(BitReader& r, XorState& s) {
+    if (r.read(1) == 1) {
+      if (r.read(1) == 1) {
+        s.leading = (int)r.read(5);
+        int meaningful = (int)r.read(6) + 1;
+        s.trailing = 64 - s.leading - meaningful;
+      }
+      s.bits ^= r.read(64 - s.leading - s.trailing) << s.trailing;
+    }
+    return bitsDouble(s.bits);
+  }
+  
+  vector<uint8_t> encodeChunk(const vector<Point>& points) {
+    BitWriter w;
+    w.write(points.size(), 32);
+    if (points.empty()) {
+      return w.bytes();
+    }
+    const Point& first = points.front();
+    w.write((uint64_t)first.time, 64);
+    w.write(doubleBits(first.value), 64);
+    w.write(first.quality, 8);
+    w.write(doubleBits(first.confidence), 64);
+    
+    XorState value, confidence;
+    value.bits = doubleBits(first.value);
+    confidence.bits = doubleBits(first.confidence);
+    int64_t delta = 0;
+    for (size_t i = 1; i < points.size(); ++i) {
+      const Point& p = points[i];
+      int64_t newDelta = (int64_t)(p.time - points[i-1].time);
+      int64_t dod = newDelta - delta;
+      delta = newDelta;
+      if (dod == 0) {
+        w.write(0, 1);
+      }
+      else if (dod >= -63 && dod <= 64) {
+        w.write(2, 2);
+        w.write(dod + 63, 7);
+      }
+      else if (dod >= -255 && dod <= 256) {
+        w.write(6, 3);
+        w.write(dod + 255, 9);
+      }
+      else if (dod >= -2047 && dod <= 2048) {
+        w.write(14, 4);
+        w.write(dod + 2047, 12);
+      }
+      else {
+        w.write(15, 4);
+        w.write((uint64_t)dod, 64);
+      }
+      writeXor(w, value, p.value);
+      writeXor(w, confidence, p.confidence);
+      if (p.quality == points[i-1].quality) {
+        w.write(0, 1);
+      }
+      else {
+        w.write(1, 1);
+        w.write(p.quality, 8);
+      }
+    }
+    return w.bytes();
+  }
+  
+  void decodeChunk(const void* data, int size, vector<Point>& points) {
+    if (!data || size <= 0) {
+      return;
+    }
+    BitReader r((const uint8_t*)data, (size_t)size);
+    size_t count = (size_t)r.read(32);
+    if (count == 0) {
+      return;
+    }
+    points.reserve(points.size() + count);
+    time_t time = (time_t)r.read(64);
+    double firstValue = bitsDouble(r.read(64));
+    Point::PointQuality quality = (Point::PointQuality)r.read(8);
+    double firstConfidence = bitsDouble(r.read(64));
+    points.push_back(Point(time, firstValue, quality, firstConfidence));
+    
+    XorState value, confidence;
+    value.bits = doubleBits(firstValue);
+    confidence.bits = doubleBits(firstConfidence);
+    int64_t delta = 0;
+    for (size_t i = 1; i < count; ++i) {
+      int64_t dod;
+      if (r.read(1) == 0) {
+        dod = 0;
+      }
+      else if (r.read(1) == 0) {
+        dod = (int64_t)r.read(7) - 63;
+      }
+      else if (r.read(1) == 0) {
+        dod = (int64_t)r.read(9) - 255;
+      }
+      else if (r.read(1) == 0) {
+        dod = (int64_t)r.read(12) - 2047;
+      }
+      else {
+        dod = (int64_t)r.read(64);
+      }
+      delta += dod;
+      time += delta;
+      double v = readXor(r, value);
+      double c = readXor(r, confidence);
+      if (r.read(1) == 1) {
+        quality = (Point::PointQuality)r.read(8);
+      }
+      points.push_back(Point(time, v, quality, c));
+    }
+  }
+  
+  time_t chunkStart(time_t time) {
+    time_t offset = time % sqlitePointRecordChunkDuration;
+    return time - (offset < 0 ? offset + sqlitePointRecordChunkDuration : offset);
+  }
+  
+}
 /******************************************************************************************/
 
 SqlitePointRecord::SqlitePointRecord() {
@@ -24,27 +257,112 @@ SqlitePointRecord::SqlitePointRecord() {
   _inBulkOperation = false;
   _transactionStackCount = 0;
   _maxTransactionStackCount = 5000;
+  _nPendingPoints = 0;
   _mutex.reset(new boost::signals2::mutex);
   _dbHandle = NULL;
   _insertSingleStmt = NULL;
+  _selectRangeStmt = NULL;
+  _selectNextStmt = NULL;
+  _selectPreviousStmt = NULL;
+  _selectFirstTimeStmt = NULL;
+  _selectLastTimeStmt = NULL;
+  _insertIdentifierStmt = NULL;
+  _selectSeriesIdStmt = NULL;
+  _insertBulkStmt = NULL;
+  _selectChunkStmt = NULL;
+  _replaceChunkStmt = NULL;
+  _chunked = false;
+  _chunkQualityFilter = OpcPassThrough;
 }
 
 SqlitePointRecord::~SqlitePointRecord() {
   this->setConnectionString("");
   
-  sqlite3_finalize(_insertSingleStmt);
+  this->finalizeStatements();
   sqlite3_close(_dbHandle);
 }
 
 string SqlitePointRecord::connectionString() {
-  return _path;
+  stringstream ss;
+  ss << _path;
+  char separator = '?';
+  typedef pair<const string, string> optionPair_t;
+  BOOST_FOREACH(const optionPair_t& option, _connectionOptions) {
+    ss << separator << option.first << "=" << option.second;
+    separator = '&';
+  }
+  return ss.str();
 }
 
 void SqlitePointRecord::setConnectionString(const std::string& path) {
   if (this->isConnected()) {
+    {
+      scoped_lock<boost::signals2::mutex> lock(*_mutex);
+      this->writePendingPoints();
+    }
+    // the handle won't close while it has statements
+    this->finalizeStatements();
     sqlite3_close(_dbHandle);
+    _dbHandle = NULL;
+    _connected = false;
+  }
+  
+  // "path?option=value&option=value"
+  size_t query = path.find('?');
+  _path = path.substr(0, query);
+  _connectionOptions.clear();
+  while (query != string::npos) {
+    size_t next = path.find('&', query + 1);
+    string option = path.substr(query + 1, (next == string::npos) ? string::npos : next - query - 1);
+    size_t equals = option.find('=');
+    if (equals != string::npos) {
+      this->setConnectionOption(option.substr(0, equals), option.substr(equals + 1));
+    }
+    query = next;
+  }
+}
+
+void SqlitePointRecord::setConnectionOption(const std::string& option, const std::string& value) {
+  static const char* supported[] = {"journal_mode", "synchronous", "mmap_size", "cache_size", "temp_store", "busy_timeout", "storage"};
+  string key = boost::algorithm::to_lower_copy(option);
+  if (find(supported, supported + sizeof(supported) / sizeof(supported[0]), key) == supported + sizeof(supported) / sizeof(supported[0])) {
+    cerr << "sqlite: unsupported connection option " << option << endl;
+    return;
+  }
+  if (value.empty()) {
+    _connectionOptions.erase(key);
+    return;
+  }
+  // values go straight into a pragma, so only a word or a number will do.
+  BOOST_FOREACH(char c, value) {
+    if (!isalnum(c) && c != '-' && c != '_') {
+      cerr << "sqlite: invalid value for connection option " << option << ": " << value << endl;
+      return;
+    }
+  }
+  _connectionOptions[key] = value;
+}
+
+std::string SqlitePointRecord::connectionOption(const std::string& option) {
+  map<string, string>::const_iterator found = _connectionOptions.find(boost::algorithm::to_lower_copy(option));
+  return (found == _connectionOptions.end()) ? "" : found->second;
+}
+
+std::map<std::string, std::string> SqlitePointRecord::connectionOptions() {
+  return _connectionOptions;
+}
+
+void SqlitePointRecord::applyConnectionOptions() {
+  typedef pair<const string, string> optionPair_t;
+  BOOST_FOREACH(const optionPair_t& option, _connectionOptions) {
+    if (option.first == "storage") {
+      continue; // not a pragma: see dbConnect
+    }
+    string pragma = "PRAGMA " + option.first + " = " + option.second;
+    if (sqlite3_exec(_dbHandle, pragma.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+      logDbError();
+    }
   }
-  _path = path;
 }
 
 
@@ -61,15 +379,12 @@ void SqlitePointRecord::dbConnect() throw(RtxException) {
     }
     
     int returnCode;
+    bool created = false;
     returnCode = sqlite3_open_v2(_path.c_str(), &_dbHandle, SQLITE_OPEN_READWRITE, NULL); // only if exists
     if (returnCode == SQLITE_CANTOPEN) {
       // attempt to create the db.
       returnCode = sqlite3_open_v2(_path.c_str(), &_dbHandle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
-      if (returnCode == SQLITE_OK) {
-        if (!this->initTables()) {
-          return;
-        }
-      }
+      created = (returnCode == SQLITE_OK);
     }
     if( returnCode != SQLITE_OK ){
       this->logDbError();
@@ -77,6 +392,11 @@ void SqlitePointRecord::dbConnect() throw(RtxException) {
       return;
     }
     
+    this->applyConnectionOptions();
+    if (created && !this->initTables()) {
+      return;
+    }
+    
     // check schema
     bool updateSuccess = true;
     int databaseVersion = this->dbSchemaVersion();
@@ -88,13 +408,16 @@ void SqlitePointRecord::dbConnect() throw(RtxException) {
       sqlite3_close(_dbHandle);
       return;
     }
-    if (databaseVersion < sqlitePointRecordCurrentDbVersion) {
-      cerr << "Point Record Database Schema version not compatible. Require version " << sqlitePointRecordCurrentDbVersion << " or greater. Updating." << endl;
-      updateSuccess = this->updateSchema();
+    int requiredVersion = (this->connectionOption("storage") == "chunks") ? sqlitePointRecordChunkedDbVersion : sqlitePointRecordCurrentDbVersion;
+    if (databaseVersion < requiredVersion) {
+      cerr << "Point Record Database Schema version not compatible. Require version " << requiredVersion << " or greater. Updating." << endl;
+      updateSuccess = this->updateSchema(requiredVersion);
     }
+    _chunked = (this->dbSchemaVersion() >= sqlitePointRecordChunkedDbVersion);
     
     // prepare the select & insert statments
-    string selectPreamble = "SELECT time, value, quality, confidence FROM points INNER JOIN meta USING (series_id) WHERE name = ? AND ";
+    // selects are by series_id (see seriesId), so they use the (series_id, time) index without joining meta
+    string selectPreamble = "SELECT time, value, quality, confidence FROM points WHERE series_id = ? AND ";
     _selectSingleStr = selectPreamble + "time = ? order by time asc";
     
     // unpack the filtering clause incase there is a black/white list
@@ -120,20 +443,41 @@ void SqlitePointRecord::dbConnect() throw(RtxException) {
     
     
     _selectRangeStr = selectPreamble + "time >= ? AND time <= ?" + qualClause + " order by time asc";
+    _selectRangesStr = "SELECT time, value, quality, confidence, series_id FROM points WHERE time >= ? AND time <= ?" + qualClause + " AND series_id IN "; // + (?,?,...)
     _selectNextStr = selectPreamble + "time > ?" + qualClause + " order by time asc LIMIT 1";
     _selectPreviousStr = selectPreamble + "time < ?" + qualClause + " order by time desc LIMIT 1";
-    _insertSingleStr = "INSERT INTO points (time, series_id, value, quality, confidence) SELECT ?,series_id,?,?,? FROM meta WHERE name = ?";
-    _selectFirstStr = selectPreamble + "1 order by time asc limit 1";
-    _selectLastStr = selectPreamble + "1 order by time desc limit 1";
-    _selectNamesStr = "select name,units from meta order by name asc";
-    
+    _insertSingleStr = "INSERT INTO points (time, series_id, value, quality, confidence) VALUES (?,?,?,?,?)";
+    stringstream bulkSS;
+    bulkSS << _insertSingleStr;
+    for (int i = 1; i < sqlitePointRecordBulkInsertRows; ++i) {
+      bulkSS << ",(?,?,?,?,?)";
+    }
+    _insertBulkStr = bulkSS.str();
+    _selectFirstTimeStr = "select min(time) from points where series_id = ?";
+    _selectLastTimeStr = "select max(time) from points where series_id = ?";
+    _selectNamesStr = "select name,units,series_id from meta order by name asc";
+    _insertIdentifierStr = "insert or ignore into meta (name,units) values (?,?)";
+    _selectSeriesIdStr = "select series_id from meta where name = ?";
     
+    if (_chunked) {
+      // a chunk holds the points from its start to just before the next one's, so the chunks a range overlaps start after the one holding its start time.
+      // the quality filter is applied as chunks are decoded.
+      string chunkPreamble = "SELECT data FROM chunks WHERE series_id = ? AND ";
+      _selectRangeStr = chunkPreamble + "start >= ? AND start <= ? order by start asc";
+      _selectNextStr = chunkPreamble + "start >= ? order by start asc";
+      _selectPreviousStr = chunkPreamble + "start <= ? order by start desc";
+      _selectFirstTimeStr = "select first_time from chunks where series_id = ? order by start asc LIMIT 1";
+      _selectLastTimeStr = "select last_time from chunks where series_id = ? order by start desc LIMIT 1";
+      _selectChunkStr = chunkPreamble + "start = ?";
+      _replaceChunkStr = "INSERT OR REPLACE INTO chunks (series_id, start, first_time, last_time, count, data) VALUES (?,?,?,?,?,?)";
+      _insertSingleStr = _insertBulkStr = _selectRangesStr = "";
+      _chunkQualityFilter = this->opcFilterType();
+      _chunkQualityCodes = this->opcFilterList();
+    }
     
     // prepare statements for performance
-    sqlite3_finalize(_insertSingleStmt);
-    sqlite3_prepare_v2(_dbHandle, _insertSingleStr.c_str(), -1, &_insertSingleStmt, NULL);
-    
-    
+    this->prepareStatements();
+    _seriesIds.clear();
     
     errorMessage = "OK";
     _connected = true;
@@ -142,6 +486,48 @@ void SqlitePointRecord::dbConnect() throw(RtxException) {
 }
 
 
+void SqlitePointRecord::prepareStatements() {
+  this->finalizeStatements();
+  sqlite3_prepare_v2(_dbHandle, _insertSingleStr.c_str(), -1, &_insertSingleStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _selectRangeStr.c_str(), -1, &_selectRangeStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _selectNextStr.c_str(), -1, &_selectNextStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _selectPreviousStr.c_str(), -1, &_selectPreviousStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _selectFirstTimeStr.c_str(), -1, &_selectFirstTimeStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _selectLastTimeStr.c_str(), -1, &_selectLastTimeStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _insertIdentifierStr.c_str(), -1, &_insertIdentifierStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _selectSeriesIdStr.c_str(), -1, &_selectSeriesIdStmt, NULL);
+  sqlite3_prepare_v2(_dbHandle, _insertBulkStr.c_str(), -1, &_insertBulkStmt, NULL);
+  if (_chunked) {
+    sqlite3_prepare_v2(_dbHandle, _selectChunkStr.c_str(), -1, &_selectChunkStmt, NULL);
+    sqlite3_prepare_v2(_dbHandle, _replaceChunkStr.c_str(), -1, &_replaceChunkStmt, NULL);
+  }
+}
+
+void SqlitePointRecord::finalizeStatements() {
+  sqlite3_stmt **statements[] = {&_insertSingleStmt, &_selectRangeStmt, &_selectNextStmt, &_selectPreviousStmt, &_selectFirstTimeStmt, &_selectLastTimeStmt, &_insertIdentifierStmt, &_selectSeriesIdStmt, &_insertBulkStmt, &_selectChunkStmt, &_replaceChunkStmt};
+  BOOST_FOREACH(sqlite3_stmt **stmt, statements) {
+    sqlite3_finalize(*stmt);
+    *stmt = NULL;
+  }
+}
+
+int SqlitePointRecord::seriesId(const std::string& name) {
+  map<string, int>::const_iterator found = _seriesIds.find(name);
+  if (found != _seriesIds.end()) {
+    return found->second;
+  }
+  // not seen yet: perhaps another connection added it.
+  int seriesId = -1;
+  sqlite3_bind_text(_selectSeriesIdStmt, 1, name.c_str(), -1, NULL);
+  if (sqlite3_step(_selectSeriesIdStmt) == SQLITE_ROW) {
+    seriesId = sqlite3_column_int(_selectSeriesIdStmt, 0);
+    _seriesIds[name] = seriesId;
+  }
+  sqlite3_reset(_selectSeriesIdStmt);
+  return seriesId;
+}
+
+
 bool SqlitePointRecord::initTables() {
   
   
@@ -176,11 +562,11 @@ void SqlitePointRecord::setDbSchemaVersion(int v) {
 }
 
 
-bool SqlitePointRecord::updateSchema() {
+bool SqlitePointRecord::updateSchema(int toVersion) {
   
   int currentVersion = this->dbSchemaVersion();
   
-  while (currentVersion >= 0 && currentVersion < sqlitePointRecordCurrentDbVersion) {
+  while (currentVersion >= 0 && currentVersion < toVersion) {
     
     switch (currentVersion) {
       case 0:
@@ -197,6 +583,61 @@ bool SqlitePointRecord::updateSchema() {
         this->setDbSchemaVersion(currentVersion);
       }
         break;
+      case 2:
+      {
+        // migrate 2->3: an index that holds whole points, so selects and next/previous seeks never visit the table
+        int ret = sqlite3_exec(_dbHandle, "CREATE INDEX IF NOT EXISTS 'points_covering' ON 'points' ('series_id', 'time', 'value', 'quality', 'confidence')", NULL, NULL, NULL);
+        if (ret != SQLITE_OK) {
+          logDbError();
+          return false;
+        }
+        currentVersion = 3;
+        this->setDbSchemaVersion(currentVersion);
+      }
+        break;
+      case 3:
+      {
+        // migrate 3->4: the points of each series, a chunk at a time, then drop the points table.
+        sqlite3_stmt *selectIds = NULL, *selectPoints = NULL, *replaceChunk = NULL;
+        bool migrated = (sqlite3_exec(_dbHandle, "BEGIN EXCLUSIVE TRANSACTION", NULL, NULL, NULL) == SQLITE_OK
+                         && sqlite3_exec(_dbHandle, initChunksStr.c_str(), NULL, NULL, NULL) == SQLITE_OK
+                         && sqlite3_prepare_v2(_dbHandle, "SELECT series_id FROM meta", -1, &selectIds, NULL) == SQLITE_OK
+                         && sqlite3_prepare_v2(_dbHandle, "SELECT time, value, quality, confidence FROM points WHERE series_id = ? order by time asc", -1, &selectPoints, NULL) == SQLITE_OK
+                         && sqlite3_prepare_v2(_dbHandle, "INSERT INTO chunks (series_id, start, first_time, last_time, count, data) VALUES (?,?,?,?,?,?)", -1, &replaceChunk, NULL) == SQLITE_OK);
+        while (migrated && sqlite3_step(selectIds) == SQLITE_ROW) {
+          int seriesId = sqlite3_column_int(selectIds, 0);
+          sqlite3_bind_int(selectPoints, 1, seriesId);
+          vector<Point> chunk;
+          int ret = sqlite3_step(selectPoints);
+          while (migrated && ret == SQLITE_ROW) {
+            Point p = pointFromStatment(selectPoints);
+            if (!chunk.empty() && chunkStart(p.time) != chunkStart(chunk.front().time)) {
+              migrated = this->writeChunk(replaceChunk, seriesId, chunkStart(chunk.front().time), chunk);
+              chunk.clear();
+            }
+            chunk.push_back(p);
+            ret = sqlite3_step(selectPoints);
+          }
+          if (migrated && !chunk.empty()) {
+            migrated = this->writeChunk(replaceChunk, seriesId, chunkStart(chunk.front().time), chunk);
+          }
+          migrated = migrated && (ret == SQLITE_DONE);
+          sqlite3_reset(selectPoints);
+        }
+        sqlite3_finalize(selectIds);
+        sqlite3_finalize(selectPoints);
+        sqlite3_finalize(replaceChunk);
+        
+        migrated = migrated && sqlite3_exec(_dbHandle, "DROP INDEX IF EXISTS 'points_covering'; DROP TABLE points; PRAGMA user_version = 4; COMMIT", NULL, NULL, NULL) == SQLITE_OK;
+        if (!migrated) {
+          logDbError();
+          sqlite3_exec(_dbHandle, "ROLLBACK", NULL, NULL, NULL);
+          return false;
+        }
+        sqlite3_exec(_dbHandle, "VACUUM", NULL, NULL, NULL); // give back the pages the rows took
+        currentVersion = 4;
+      }
+        break;
         
       default:
         break;
@@ -204,7 +645,7 @@ bool SqlitePointRecord::updateSchema() {
     
   }
   
-  if (currentVersion == sqlitePointRecordCurrentDbVersion) {
+  if (currentVersion == toVersion) {
     return true;
   }
   else {
@@ -288,8 +729,7 @@ bool SqlitePointRecord::insertIdentifierAndUnits(const std::string &id, RTX::Uni
     // INSERT IGNORE INTO meta (name,units) VALUES (?,?)
     string unitsStr = units.unitString();
     
-    sqlite3_stmt *stmt;
-    sqlite3_prepare_v2(_dbHandle, "insert or ignore into meta (name,units) values (?,?)", -1, &stmt, NULL);
+    sqlite3_stmt *stmt = _insertIdentifierStmt;
     sqlite3_bind_text(stmt, 1, id.c_str(), -1, NULL);
     sqlite3_bind_text(stmt, 2, unitsStr.c_str(), -1, NULL);
     ret = sqlite3_step(stmt);
@@ -300,10 +740,12 @@ bool SqlitePointRecord::insertIdentifierAndUnits(const std::string &id, RTX::Uni
       success = true;
     }
     sqlite3_reset(stmt);
-    sqlite3_finalize(stmt);
     
     // add to the cache.
     _identifiersAndUnitsCache[id] = units;
+    if (success && sqlite3_changes(_dbHandle) > 0) {
+      _seriesIds[id] = (int)sqlite3_last_insert_rowid(_dbHandle);
+    }
   }
   
   return success;
@@ -325,6 +767,7 @@ const std::map<std::string,Units> SqlitePointRecord::identifiersAndUnits() {
     this->dbConnect();
   }
   
+  map<string, int> seriesIds;
   if (this->isConnected()) {
     scoped_lock<boost::signals2::mutex> lock(*_mutex);
     sqlite3_stmt *selectIdsStmt;
@@ -343,6 +786,7 @@ const std::map<std::string,Units> SqlitePointRecord::identifiersAndUnits() {
         units = Units::unitOfType(unitsStr);
       }
       ids[name] = units;
+      seriesIds[name] = sqlite3_column_int(selectIdsStmt, 2);
       ret = sqlite3_step(selectIdsStmt);
     }
     sqlite3_reset(selectIdsStmt);
@@ -352,6 +796,7 @@ const std::map<std::string,Units> SqlitePointRecord::identifiersAndUnits() {
   {
     scoped_lock<boost::signals2::mutex> lock(*_mutex);
     _identifiersAndUnitsCache = ids;
+    _seriesIds = seriesIds;
   }
   
   return ids;
@@ -359,70 +804,34 @@ const std::map<std::string,Units> SqlitePointRecord::identifiersAndUnits() {
 
 
 PointRecord::time_pair_t SqlitePointRecord::range(const string& id) {
-  Point last,first;
-  vector<Point> points;
   
   if (!isConnected()) {
     this->dbConnect();
   }
   if (isConnected()) {
     scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    this->writePendingPoints();
     
-    // some optimizations here.
-    const bool optimized(true);
-    
-    if (optimized) {
-      time_t minTime = 0, maxTime = 0;
-      int ret;
-      sqlite3_stmt *selectFirstStmt;
-      string selectFirst("select min(time) from points where series_id=(select series_id from meta where name=?)");
-      ret = sqlite3_prepare_v2(_dbHandle, selectFirst.c_str(), -1, &selectFirstStmt, NULL);
-      ret = sqlite3_bind_text(selectFirstStmt, 1, id.c_str(), -1, NULL);
-      if (sqlite3_step(selectFirstStmt) == SQLITE_ROW) {
-        minTime = (time_t)sqlite3_column_int(selectFirstStmt, 0);
-      }
-      sqlite3_reset(selectFirstStmt);
-      sqlite3_finalize(selectFirstStmt);
-      
-      sqlite3_stmt *selectLastStmt;
-      string selectLast("select max(time) from points where series_id=(select series_id from meta where name=?)");
-      ret = sqlite3_prepare_v2(_dbHandle, selectLast.c_str(), -1, &selectLastStmt, NULL);
-      ret = sqlite3_bind_text(selectLastStmt, 1, id.c_str(), -1, NULL);
-      if (sqlite3_step(selectLastStmt) == SQLITE_ROW) {
-        maxTime = (time_t)sqlite3_column_int(selectLastStmt, 0);
-      }
-      sqlite3_reset(selectLastStmt);
-      sqlite3_finalize(selectLastStmt);
-      
+    time_t minTime = 0, maxTime = 0;
+    int seriesId = this->seriesId(id);
+    if (seriesId < 0) {
       return make_pair(minTime, maxTime);
     }
     
-    // non-optimized code -- deprecate
-    else {
-      int ret;
-      sqlite3_stmt *selectFirstStmt;
-      ret = sqlite3_prepare_v2(_dbHandle, _selectFirstStr.c_str(), -1, &selectFirstStmt, NULL);
-      sqlite3_bind_text(selectFirstStmt, 1, id.c_str(), -1, NULL);
-      points = pointsFromPreparedStatement(selectFirstStmt);
-      if (points.size() > 0) {
-        first = points.front();
-      }
-      
-      sqlite3_stmt *selectLastStmt;
-      ret = sqlite3_prepare_v2(_dbHandle, _selectLastStr.c_str(), -1, &selectLastStmt, NULL);
-      sqlite3_bind_text(selectLastStmt, 1, id.c_str(), -1, NULL);
-      points = pointsFromPreparedStatement(selectLastStmt);
-      if (points.size() > 0) {
-        last = points.front();
-      }
-      
-      sqlite3_reset(selectFirstStmt);
-      sqlite3_reset(selectLastStmt);
-      sqlite3_finalize(selectFirstStmt);
-      sqlite3_finalize(selectLastStmt);
+    sqlite3_bind_int(_selectFirstTimeStmt, 1, seriesId);
+    if (sqlite3_step(_selectFirstTimeStmt) == SQLITE_ROW) {
+      minTime = (time_t)sqlite3_column_int(_selectFirstTimeStmt, 0);
     }
+    sqlite3_reset(_selectFirstTimeStmt);
+    
+    sqlite3_bind_int(_selectLastTimeStmt, 1, seriesId);
+    if (sqlite3_step(_selectLastTimeStmt) == SQLITE_ROW) {
+      maxTime = (time_t)sqlite3_column_int(_selectLastTimeStmt, 0);
+    }
+    sqlite3_reset(_selectLastTimeStmt);
+    
+    return make_pair(minTime, maxTime);
   }
-  //  return make_pair(first.time, last.time);
   return make_pair(0, 0);
 }
 
@@ -433,118 +842,169 @@ std::vector<Point> SqlitePointRecord::selectRange(const std::string& id, time_t
     this->dbConnect();
   }
   if (isConnected()) {
-    // SELECT time, value, quality, confidence FROM points INNER JOIN meta USING (series_id) WHERE name = ? AND time >= ? AND time <= ? order by time asc
+    // SELECT time, value, quality, confidence FROM points WHERE series_id = ? AND time >= ? AND time <= ? order by time asc
     
     //    checkTransactions(true);
     
     scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    this->writePendingPoints();
     
-    sqlite3_stmt *s;
-    int ret = sqlite3_prepare_v2(_dbHandle, _selectRangeStr.c_str(), -1, &s, NULL);
+    int seriesId = this->seriesId(id);
+    if (seriesId < 0) {
+      return points;
+    }
     
-    sqlite3_bind_text(s, 1, id.c_str(), -1, NULL);
+    sqlite3_stmt *s = _selectRangeStmt;
+    sqlite3_bind_int(s, 1, seriesId);
+    if (_chunked) {
+      // only the chunks the range overlaps are decoded
+      sqlite3_bind_int(s, 2, (int)chunkStart(startTime));
+      sqlite3_bind_int(s, 3, (int)endTime);
+      return pointsFromChunks(s, startTime, endTime);
+    }
     sqlite3_bind_int(s, 2, (int)startTime);
     sqlite3_bind_int(s, 3, (int)endTime);
     
     points = pointsFromPreparedStatement(s);
     
-    sqlite3_reset(s);
-    sqlite3_finalize(s);
-    
   }
   return points;
 }
 
-Point SqlitePointRecord::selectNext(const std::string& id, time_t time) {
-  Point p;
-  
-  const time_t timeMargin = 60*60*24;
-  const int maxLookahead = 100; // 100 days
+std::map<std::string, std::vector<Point> > SqlitePointRecord::selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime) {
+  map<string, vector<Point> > selected;
   
   if (!isConnected()) {
     this->dbConnect();
   }
   if (isConnected()) {
+    scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    this->writePendingPoints();
     
-    vector<Point> points;
+    // every series gets an entry, even if it's empty. names the meta table doesn't know have nothing to select.
+    vector<int> seriesIds;
+    map<int, vector<Point>*> pointsById;
+    BOOST_FOREACH(const string& id, ids) {
+      vector<Point>* points = &selected[id];
+      int seriesId = this->seriesId(id);
+      if (seriesId >= 0 && pointsById.count(seriesId) == 0) {
+        seriesIds.push_back(seriesId);
+        pointsById[seriesId] = points;
+      }
+    }
     
-    // iterative lookahead, faster than unbounded query
-    time_t searchStartTime = time + 1;
-    int lookaheadsLeft = maxLookahead;
-    while (points.size() == 0 && lookaheadsLeft > 0) {
-      points = this->selectRange(id, searchStartTime, searchStartTime + timeMargin);
-      searchStartTime += timeMargin;
-      --lookaheadsLeft;
+    if (_chunked) {
+      // chunks are keyed by series, so a series at a time costs nothing over one select for all of them.
+      BOOST_FOREACH(int seriesId, seriesIds) {
+        sqlite3_bind_int(_selectRangeStmt, 1, seriesId);
+        sqlite3_bind_int(_selectRangeStmt, 2, (int)chunkStart(startTime));
+        sqlite3_bind_int(_selectRangeStmt, 3, (int)endTime);
+        *pointsById[seriesId] = pointsFromChunks(_selectRangeStmt, startTime, endTime);
+      }
+      return selected;
     }
     
-    // if iterative search fails, there still may be points here.
-    // suffer then long execution of the unbounded query.
-    if (points.size() == 0) {
-      // slow query
+    // sqlite limits the number of bound parameters, so go a few hundred series at a time.
+    const size_t maxIds = 500;
+    for (size_t first = 0; first < seriesIds.size(); first += maxIds) {
+      size_t n = min(maxIds, seriesIds.size() - first);
+      stringstream q;
+      q << _selectRangesStr << "(?";
+      for (size_t i = 1; i < n; ++i) {
+        q << ",?";
+      }
+      q << ")"; // no order by: rows come back a series at a time in index order, and sorting them all costs more than the selects save
       
       sqlite3_stmt *s;
-      sqlite3_prepare_v2(_dbHandle, _selectNextStr.c_str(), -1, &s, NULL);
+      int ret = sqlite3_prepare_v2(_dbHandle, q.str().c_str(), -1, &s, NULL);
+      if (ret != SQLITE_OK) {
+        logDbError();
+        continue;
+      }
+      sqlite3_bind_int(s, 1, (int)startTime);
+      sqlite3_bind_int(s, 2, (int)endTime);
+      for (size_t i = 0; i < n; ++i) {
+        sqlite3_bind_int(s, 3 + (int)i, seriesIds[first + i]);
+      }
       
-      sqlite3_bind_text(s, 1, id.c_str(), -1, NULL);
-      sqlite3_bind_int(s, 2, (int)time);
-      points = pointsFromPreparedStatement(s);
+      vector<Point>* points = NULL;
+      int seriesId = -1;
+      ret = sqlite3_step(s);
+      while (ret == SQLITE_ROW) {
+        int rowId = sqlite3_column_int(s, 4);
+        if (!points || seriesId != rowId) {
+          seriesId = rowId;
+          points = pointsById[seriesId];
+        }
+        points->push_back(pointFromStatment(s));
+        ret = sqlite3_step(s);
+      }
+      if (ret != SQLITE_DONE) {
+        cerr << "sqlite returns " << ret << " -- prepared statement fails" << endl;
+      }
       sqlite3_finalize(s);
     }
-    
-    
-    if (points.size() > 0) {
-      return points.front();
-    }
-    return Point();
   }
-  return p;
+  return selected;
+}
+
+Point SqlitePointRecord::selectNext(const std::string& id, time_t time) {
+  vector<Point> points;
   
+  if (!isConnected()) {
+    this->dbConnect();
+  }
+  if (isConnected()) {
+    // one seek on the (series_id, time) index, however far away the next point is
+    // SELECT time, value, quality, confidence FROM points WHERE series_id = ? AND time > ? order by time asc LIMIT 1
+    scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    this->writePendingPoints();
+    int seriesId = this->seriesId(id);
+    if (seriesId >= 0 && _chunked) {
+      sqlite3_bind_int(_selectNextStmt, 1, seriesId);
+      sqlite3_bind_int(_selectNextStmt, 2, (int)chunkStart(time));
+      return seekInChunks(_selectNextStmt, time, true);
+    }
+    if (seriesId >= 0) {
+      sqlite3_bind_int(_selectNextStmt, 1, seriesId);
+      sqlite3_bind_int(_selectNextStmt, 2, (int)time);
+      points = pointsFromPreparedStatement(_selectNextStmt);
+    }
+  }
   
+  if (points.size() > 0) {
+    return points.front();
+  }
+  return Point();
 }
 
 Point SqlitePointRecord::selectPrevious(const std::string& id, time_t time) {
-  
-  Point p;
-  
-  const time_t timeMargin = 60*60*24;
-  const int maxLookBehinds = 100; // 100 days
+  vector<Point> points;
   
   if (!isConnected()) {
     this->dbConnect();
   }
   if (isConnected()) {
-    
-    vector<Point> points;
-    
-    
-    // iterative lookbehind is faster than unbounded lookup
-    time_t searchEndTime = time - 1;
-    int lookbehandsLeft = maxLookBehinds;
-    while (points.size() == 0 && lookbehandsLeft > 0) {
-      points = this->selectRange(id, searchEndTime - timeMargin, searchEndTime);
-      searchEndTime -= timeMargin;
-      --lookbehandsLeft;
-    }
-    
-    // if the iterative lookbehind did not work
-    if (points.size() == 0) {
-      // slow query
-      sqlite3_stmt *s;
-      sqlite3_prepare_v2(_dbHandle, _selectPreviousStr.c_str(), -1, &s, NULL);
-      sqlite3_bind_text(s, 1, id.c_str(), -1, NULL);
-      sqlite3_bind_int(s, 2, (int)time);
-      points = pointsFromPreparedStatement(s);
-      sqlite3_finalize(s);
+    // SELECT time, value, quality, confidence FROM points WHERE series_id = ? AND time < ? order by time desc LIMIT 1
+    scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    this->writePendingPoints();
+    int seriesId = this->seriesId(id);
+    if (seriesId >= 0 && _chunked) {
+      sqlite3_bind_int(_selectPreviousStmt, 1, seriesId);
+      sqlite3_bind_int(_selectPreviousStmt, 2, (int)chunkStart(time));
+      return seekInChunks(_selectPreviousStmt, time, false);
     }
-    
-    if (points.size() > 0) {
-      return points.back();
+    if (seriesId >= 0) {
+      sqlite3_bind_int(_selectPreviousStmt, 1, seriesId);
+      sqlite3_bind_int(_selectPreviousStmt, 2, (int)time);
+      points = pointsFromPreparedStatement(_selectPreviousStmt);
     }
-    return Point();
   }
-  return p;
-  
   
+  if (points.size() > 0) {
+    return points.front();
+  }
+  return Point();
 }
 
 
@@ -566,7 +1026,7 @@ void SqlitePointRecord::endBulkOperation() {
 void SqlitePointRecord::insertSingle(const std::string &id, RTX::Point point) {
   
   if (_inBulkOperation) { // caller has promised to end the bulk operation eventually.
-    insertSingleInTransaction(id, point);
+    this->queuePoint(id, point); // written with the multi-row insert when the transaction commits
     this->checkTransactions(false); // only flush if we've reached the stride size.
   }
   
@@ -588,12 +1048,17 @@ void SqlitePointRecord::insertSingleInTransaction(const std::string& id, Point p
     scoped_lock<boost::signals2::mutex> lock(*_mutex);
     
     int ret;
-    // INSERT INTO points (time, series_id, value, quality, confidence) SELECT ?,series_id,?,?,? FROM meta WHERE name = ?
-    ret = sqlite3_bind_int(    _insertSingleStmt, 1, (int)point.time      );
-    ret = sqlite3_bind_double( _insertSingleStmt, 2, point.value          );
-    ret = sqlite3_bind_int(    _insertSingleStmt, 3, point.quality        );
-    ret = sqlite3_bind_double( _insertSingleStmt, 4, point.confidence     );
-    ret = sqlite3_bind_text(   _insertSingleStmt, 5, id.c_str(), -1, NULL );
+    int seriesId = this->seriesId(id);
+    if (seriesId < 0) {
+      return; // not registered
+    }
+    if (_chunked) {
+      this->writePendingPoints();
+      this->insertIntoChunks(seriesId, vector<Point>(1, point));
+      return;
+    }
+    // INSERT INTO points (time, series_id, value, quality, confidence) VALUES (?,?,?,?,?)
+    this->bindPoint(_insertSingleStmt, 1, seriesId, point);
     
     ret = sqlite3_step(_insertSingleStmt);
     if (ret != SQLITE_DONE) {
@@ -605,7 +1070,15 @@ void SqlitePointRecord::insertSingleInTransaction(const std::string& id, Point p
   return;
 }
 
-void SqlitePointRecord::insertRange(const std::string& id, std::vector<Point> points) {
+void SqlitePointRecord::bindPoint(sqlite3_stmt *stmt, int firstParameter, int seriesId, const Point& point) {
+  sqlite3_bind_int(    stmt, firstParameter,     (int)point.time  );
+  sqlite3_bind_int(    stmt, firstParameter + 1, seriesId         );
+  sqlite3_bind_double( stmt, firstParameter + 2, point.value      );
+  sqlite3_bind_int(    stmt, firstParameter + 3, point.quality    );
+  sqlite3_bind_double( stmt, firstParameter + 4, point.confidence );
+}
+
+void SqlitePointRecord::insertRange(const std::string& id, const std::vector<Point>& points) {
   
   if (!isConnected()) {
     dbConnect();
@@ -615,34 +1088,117 @@ void SqlitePointRecord::insertRange(const std::string& id, std::vector<Point> po
     int ret;
     char *errmsg;
     
-    {
-      checkTransactions(true); // any tranactions currently? tell them to quit.
-      scoped_lock<boost::signals2::mutex> lock(*_mutex);
-      ret = sqlite3_exec(_dbHandle, "begin exclusive transaction", NULL, NULL, &errmsg);
-      if (ret != SQLITE_OK) {
-        logDbError();
-        return;
-      }
+    checkTransactions(true); // any tranactions currently? tell them to quit.
+    scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    
+    this->writePendingPoints();
+    int seriesId = this->seriesId(id);
+    if (seriesId < 0) {
+      return; // not registered
     }
     
-    // this is always within a transaction
-    BOOST_FOREACH(const Point &p, points) {
-      this->insertSingleInTransaction(id, p);
+    ret = sqlite3_exec(_dbHandle, "begin exclusive transaction", NULL, NULL, &errmsg);
+    if (ret != SQLITE_OK) {
+      logDbError();
+      return;
     }
-    {
-      scoped_lock<boost::signals2::mutex> lock(*_mutex);
-      ret = sqlite3_exec(_dbHandle, "end transaction", NULL, NULL, &errmsg);
-      if (ret != SQLITE_OK) {
-        logDbError();
-        return;
+    
+    if (_chunked) {
+      this->insertIntoChunks(seriesId, points);
+    }
+    else {
+      vector<pair<int, Point> > rows;
+      rows.reserve(points.size());
+      BOOST_FOREACH(const Point& p, points) {
+        rows.push_back(make_pair(seriesId, p));
       }
+      this->insertRows(rows);
     }
     
-    
+    ret = sqlite3_exec(_dbHandle, "end transaction", NULL, NULL, &errmsg);
+    if (ret != SQLITE_OK) {
+      logDbError();
+      return;
+    }
   }
   
 }
 
+void SqlitePointRecord::insertRows(const std::vector<std::pair<int, Point> >& rows) {
+  // caller holds _mutex, and has a transaction open. rows are (series_id, point), in any order.
+  // as many full multi-row inserts as will fit, then the rest one at a time.
+  const size_t n = sqlitePointRecordBulkInsertRows;
+  size_t i = 0;
+  for ( ; i + n <= rows.size(); i += n) {
+    for (size_t row = 0; row < n; ++row) {
+      this->bindPoint(_insertBulkStmt, 1 + 5 * (int)row, rows[i + row].first, rows[i + row].second);
+    }
+    if (sqlite3_step(_insertBulkStmt) != SQLITE_DONE) {
+      logDbError();
+    }
+    sqlite3_reset(_insertBulkStmt);
+  }
+  for ( ; i < rows.size(); ++i) {
+    this->bindPoint(_insertSingleStmt, 1, rows[i].first, rows[i].second);
+    if (sqlite3_step(_insertSingleStmt) != SQLITE_DONE) {
+      logDbError();
+    }
+    sqlite3_reset(_insertSingleStmt);
+  }
+}
+
+void SqlitePointRecord::queuePoint(const std::string& id, Point point) {
+  if (!isConnected()) {
+    dbConnect();
+  }
+  if (isConnected()) {
+    scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    int seriesId = this->seriesId(id);
+    if (seriesId < 0) {
+      return; // not registered
+    }
+    _pendingPoints[seriesId].push_back(point);
+    ++_nPendingPoints;
+    // a chunk is rewritten whole, so on a chunked file the queue isn't written at each stride of the
+    // bulk operation, but once at its end: each chunk it touched is rewritten once. the limit bounds memory.
+    if (_chunked && _nPendingPoints >= sqlitePointRecordChunkPendingPoints) {
+      this->writePendingPoints();
+    }
+  }
+}
+
+void SqlitePointRecord::writePendingPoints() {
+  // caller holds _mutex. a step of a simulation is one point for each of many series,
+  // so the multi-row inserts are filled across series.
+  if (_pendingPoints.empty()) {
+    return;
+  }
+  bool ownTransaction = !_inTransaction;
+  if (ownTransaction) {
+    sqlite3_exec(_dbHandle, "BEGIN", 0, 0, 0);
+  }
+  typedef pair<const int, vector<Point> > pendingPair_t;
+  if (_chunked) {
+    BOOST_FOREACH(const pendingPair_t& pending, _pendingPoints) {
+      this->insertIntoChunks(pending.first, pending.second);
+    }
+  }
+  else {
+    vector<pair<int, Point> > rows;
+    BOOST_FOREACH(const pendingPair_t& pending, _pendingPoints) {
+      BOOST_FOREACH(const Point& p, pending.second) {
+        rows.push_back(make_pair(pending.first, p));
+      }
+    }
+    this->insertRows(rows);
+  }
+  _pendingPoints.clear();
+  _nPendingPoints = 0;
+  if (ownTransaction) {
+    sqlite3_exec(_dbHandle, "END", 0, 0, 0);
+  }
+}
+
 void SqlitePointRecord::removeRecord(const std::string& id) {
   scoped_lock<boost::signals2::mutex> lock(*_mutex);
   
@@ -650,9 +1206,16 @@ void SqlitePointRecord::removeRecord(const std::string& id) {
     return;
   }
   _identifiersAndUnitsCache.clear();
+  map<string, int>::const_iterator idIt = _seriesIds.find(id);
+  if (idIt != _seriesIds.end() && _pendingPoints.count(idIt->second)) {
+    _nPendingPoints -= _pendingPoints[idIt->second].size();
+    _pendingPoints.erase(idIt->second);
+  }
+  _seriesIds.erase(id);
   
   char *errmsg;
-  string sqlStr = "delete from points where series_id = (SELECT series_id FROM meta where name = \'" + id + "\'); delete from meta where name = \'" + id + "\'";
+  string table = _chunked ? "chunks" : "points";
+  string sqlStr = "delete from " + table + " where series_id = (SELECT series_id FROM meta where name = \'" + id + "\'); delete from meta where name = \'" + id + "\'";
   const char *sql = sqlStr.c_str();
   int ret = sqlite3_exec(_dbHandle, sql, NULL, NULL, &errmsg);
   if (ret != SQLITE_OK) {
@@ -666,9 +1229,14 @@ void SqlitePointRecord::truncate() {
     return;
   }
   _identifiersAndUnitsCache.clear();
+  {
+    scoped_lock<boost::signals2::mutex> lock(*_mutex);
+    _pendingPoints.clear();
+    _nPendingPoints = 0;
+  }
   
   char *errmsg;
-  int ret = sqlite3_exec(_dbHandle, "delete from points", NULL, NULL, &errmsg);
+  int ret = sqlite3_exec(_dbHandle, _chunked ? "delete from chunks" : "delete from points", NULL, NULL, &errmsg);
   if (ret != SQLITE_OK) {
     logDbError();
     return;
@@ -708,6 +1276,120 @@ Point SqlitePointRecord::pointFromStatment(sqlite3_stmt *stmt) {
 }
 
 
+#pragma mark - Chunks
+
+bool SqlitePointRecord::passesQualityFilter(const Point& point) {
+  // the same black/white list the row selects put in their where clause
+  if ((_chunkQualityFilter != OpcBlackList && _chunkQualityFilter != OpcWhiteList) || _chunkQualityCodes.empty()) {
+    return true;
+  }
+  bool listed = _chunkQualityCodes.count(point.quality) > 0;
+  return (_chunkQualityFilter == OpcWhiteList) ? listed : !listed;
+}
+
+std::vector<Point> SqlitePointRecord::pointsFromChunks(sqlite3_stmt *stmt, time_t startTime, time_t endTime) {
+  // SELECT data FROM chunks ... order by start asc
+  vector<Point> points, chunk;
+  int ret = sqlite3_step(stmt);
+  while (ret == SQLITE_ROW) {
+    chunk.clear();
+    decodeChunk(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0), chunk);
+    BOOST_FOREACH(const Point& p, chunk) {
+      if (p.time >= startTime && p.time <= endTime && passesQualityFilter(p)) {
+        points.push_back(p);
+      }
+    }
+    ret = sqlite3_step(stmt);
+  }
+  if (ret != SQLITE_DONE) {
+    cerr << "sqlite returns " << ret << " -- prepared statement fails" << endl;
+  }
+  sqlite3_reset(stmt);
+  return points;
+}
+
+Point SqlitePointRecord::seekInChunks(sqlite3_stmt *stmt, time_t time, bool forward) {
+  // chunks come in the direction of the search, starting with the one holding time.
+  // usually the point is in the first one; across a gap, the next chunk is the next row.
+  Point found;
+  bool seeking = true;
+  vector<Point> chunk;
+  while (seeking && sqlite3_step(stmt) == SQLITE_ROW) {
+    chunk.clear();
+    decodeChunk(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0), chunk);
+    if (forward) {
+      BOOST_FOREACH(const Point& p, chunk) {
+        if (p.time > time && passesQualityFilter(p)) {
+          found = p;
+          seeking = false;
+          break;
+        }
+      }
+    }
+    else {
+      BOOST_REVERSE_FOREACH(const Point& p, chunk) {
+        if (p.time < time && passesQualityFilter(p)) {
+          found = p;
+          seeking = false;
+          break;
+        }
+      }
+    }
+  }
+  sqlite3_reset(stmt);
+  return found;
+}
+
+void SqlitePointRecord::insertIntoChunks(int seriesId, const std::vector<Point>& points) {
+  // caller holds _mutex. new points go into the chunks they belong to, merged with what's there:
+  // as with the unique constraint on points, a time that's already stored keeps its point.
+  map<time_t, map<time_t, Point> > byChunk;
+  BOOST_FOREACH(const Point& p, points) {
+    byChunk[chunkStart(p.time)].insert(make_pair(p.time, p));
+  }
+  
+  typedef pair<const time_t, map<time_t, Point> > chunkPair_t;
+  vector<Point> chunk;
+  BOOST_FOREACH(chunkPair_t& newChunk, byChunk) {
+    chunk.clear();
+    sqlite3_bind_int(_selectChunkStmt, 1, seriesId);
+    sqlite3_bind_int(_selectChunkStmt, 2, (int)newChunk.first);
+    if (sqlite3_step(_selectChunkStmt) == SQLITE_ROW) {
+      decodeChunk(sqlite3_column_blob(_selectChunkStmt, 0), sqlite3_column_bytes(_selectChunkStmt, 0), chunk);
+    }
+    sqlite3_reset(_selectChunkStmt);
+    
+    map<time_t, Point>& merged = newChunk.second;
+    BOOST_FOREACH(const Point& p, chunk) {
+      merged[p.time] = p;
+    }
+    chunk.clear();
+    chunk.reserve(merged.size());
+    typedef pair<const time_t, Point> timePoint_t;
+    BOOST_FOREACH(const timePoint_t& p, merged) {
+      chunk.push_back(p.second);
+    }
+    if (!this->writeChunk(_replaceChunkStmt, seriesId, newChunk.first, chunk)) {
+      logDbError();
+    }
+  }
+}
+
+bool SqlitePointRecord::writeChunk(sqlite3_stmt *stmt, int seriesId, time_t start, const std::vector<Point>& points) {
+  // (series_id, start, first_time, last_time, count, data); points in time order.
+  vector<uint8_t> data = encodeChunk(points);
+  sqlite3_bind_int(stmt, 1, seriesId);
+  sqlite3_bind_int(stmt, 2, (int)start);
+  sqlite3_bind_int(stmt, 3, (int)points.front().time);
+  sqlite3_bind_int(stmt, 4, (int)points.back().time);
+  sqlite3_bind_int(stmt, 5, (int)points.size());
+  sqlite3_bind_blob(stmt, 6, &data[0], (int)data.size(), SQLITE_TRANSIENT);
+  bool written = (sqlite3_step(stmt) == SQLITE_DONE);
+  sqlite3_reset(stmt);
+  return written;
+}
+
+
 bool SqlitePointRecord::supportsBoundedQueries() {
   return true;
 }
@@ -718,21 +1400,25 @@ void SqlitePointRecord::checkTransactions(bool forceEndTranaction) {
   // forcing to end?
   if (forceEndTranaction) {
     if (_inTransaction) {
+      this->writePendingPoints();
       _transactionStackCount = 0;
       sqlite3_exec(_dbHandle, "END", 0, 0, 0);
       _inTransaction = false;
       return;
     }
     else {
-      // do nothing
-      return;
+      this->writePendingPoints(); // in its own transaction, if anything's left
     }
+    return;
   }
   
   
   if (_inTransaction) {
     if (_transactionStackCount >= _maxTransactionStackCount) {
-      // reset the stack, commit the stack
+      // reset the stack, commit the stack. queued chunk points wait for the end of the bulk operation: see queuePoint.
+      if (!_chunked) {
+        this->writePendingPoints();
+      }
       _transactionStackCount = 0;
       sqlite3_exec(_dbHandle, "END", 0, 0, 0);
       _inTransaction = false;
@@ -18,6 +18,26 @@
 
 namespace RTX {
   
+  /*!
+   \class SqlitePointRecord
+   \brief A DbPointRecord stored in a SQLite file.
+   
+   The connection string is the path to the file, optionally followed by connection options in query-string form. Each option is a SQLite pragma applied whenever the record connects:
+   
+   \code
+   /path/to/points.db?journal_mode=WAL&synchronous=NORMAL&mmap_size=268435456
+   \endcode
+   
+   Supported options are journal_mode, synchronous, mmap_size, cache_size, temp_store and busy_timeout (milliseconds). With journal_mode=WAL, readers on other connections carry on while a long bulk write is in progress; busy_timeout makes a connection wait for a lock instead of failing. connectionString() includes the options, so they are kept wherever the connection string is saved, as in project files.
+   
+   One more option is not a pragma: storage=chunks moves the file to schema version 4, where each series is kept as one compressed BLOB per day (delta-of-delta times, XOR-coded values) instead of a row per point. Archives are several times smaller, and a select decodes only the days it overlaps; adding points to a day rewrites that day's chunk. Points added one at a time inside a bulk operation, as simulation results are, are held in memory until the bulk operation ends (or a read comes first), then each chunk they touch is rewritten once. A simulation step is one bulk operation, so a chunked file is best written with several steps per bulk operation, or with addPoints. Outside a bulk operation, each point added rewrites its chunk. The migration is one way: a version 4 file stays chunked whether or not the option is given.
+   */
+  
+  /*!
+   \fn void SqlitePointRecord::setConnectionOption(const std::string& option, const std::string& value)
+   \brief Set one connection option; an empty value removes it. Takes effect at the next dbConnect(). Unsupported options, and values other than a word or a number, are ignored.
+   */
+  
   class SqlitePointRecord : public DbPointRecord {
   public:
     RTX_SHARED_POINTER(SqlitePointRecord);
@@ -36,6 +56,10 @@ namespace RTX {
     std::string connectionString();
     void setConnectionString(const std::string& path);
     
+    void setConnectionOption(const std::string& option, const std::string& value);
+    std::string connectionOption(const std::string& option);
+    std::map<std::string, std::string> connectionOptions();
+    
     virtual bool supportsBoundedQueries();
     virtual void truncate();
     bool canAssignUnits();
@@ -48,20 +72,49 @@ namespace RTX {
     virtual std::vector<Point> selectRange(const std::string& id, time_t startTime, time_t endTime);
     virtual Point selectNext(const std::string& id, time_t time);
     virtual Point selectPrevious(const std::string& id, time_t time);
+    virtual std::map<std::string, std::vector<Point> > selectRanges(const std::vector<std::string>& ids, time_t startTime, time_t endTime);
     
     // insertions or alterations may choose to ignore / deny
     virtual void insertSingle(const std::string& id, Point point);
     void insertSingleInTransaction(const std::string &id, Point point);
-    virtual void insertRange(const std::string& id, std::vector<Point> points);
+    virtual void insertRange(const std::string& id, const std::vector<Point>& points);
     virtual void removeRecord(const std::string& id);
     
   private:
     sqlite3 *_dbHandle;
-    std::string _selectRangeStr, _selectSingleStr, _selectNamesStr, _selectPreviousStr, _selectNextStr, _insertSingleStr, _selectFirstStr, _selectLastStr;
-    
-    sqlite3_stmt *_insertSingleStmt;
+    std::string _selectRangeStr, _selectRangesStr, _selectSingleStr, _selectNamesStr, _selectPreviousStr, _selectNextStr, _insertSingleStr, _selectFirstTimeStr, _selectLastTimeStr, _insertIdentifierStr, _selectSeriesIdStr, _insertBulkStr, _selectChunkStr, _replaceChunkStr;
+    
+    // prepared once per connection, and reset after each use
+    sqlite3_stmt *_insertSingleStmt, *_selectRangeStmt, *_selectNextStmt, *_selectPreviousStmt, *_selectFirstTimeStmt, *_selectLastTimeStmt, *_insertIdentifierStmt, *_selectSeriesIdStmt, *_insertBulkStmt, *_selectChunkStmt, *_replaceChunkStmt;
+    void prepareStatements();
+    void finalizeStatements();
+    
+    // series_id by name, so that selects go straight to the (series_id, time) index
+    std::map<std::string, int> _seriesIds;
+    int seriesId(const std::string& name); // caller holds _mutex. -1 if there's no such series
+    void bindPoint(sqlite3_stmt *stmt, int firstParameter, int seriesId, const Point& point);
+    void insertRows(const std::vector<std::pair<int, Point> >& rows); // (series_id, point)
+    
+    // points added during a bulk operation, by series_id. written before any read, and before the transaction
+    // commits -- or, on a chunked file, at the end of the bulk operation, or once sqlitePointRecordChunkPendingPoints have been queued.
+    std::map<int, std::vector<Point> > _pendingPoints;
+    size_t _nPendingPoints;
+    void queuePoint(const std::string& id, Point point);
+    void writePendingPoints(); // caller holds _mutex
+    
+    // schema version 4: the range, next and previous statements select chunks instead of points
+    bool _chunked;
+    OpcFilterType _chunkQualityFilter;
+    std::set<unsigned int> _chunkQualityCodes;
+    bool passesQualityFilter(const Point& point);
+    std::vector<Point> pointsFromChunks(sqlite3_stmt *stmt, time_t startTime, time_t endTime);
+    Point seekInChunks(sqlite3_stmt *stmt, time_t time, bool forward);
+    void insertIntoChunks(int seriesId, const std::vector<Point>& points);
+    bool writeChunk(sqlite3_stmt *stmt, int seriesId, time_t start, const std::vector<Point>& points);
     
     std::string _path;
+    std::map<std::string, std::string> _connectionOptions;
+    void applyConnectionOptions();
     bool _connected;
     
     bool _inTransaction, _inBulkOperation;
@@ -77,7 +130,7 @@ namespace RTX {
     Point pointFromStatment(sqlite3_stmt *stmt);
     std::vector<Point> pointsFromPreparedStatement(sqlite3_stmt *stmt);
     
-    bool updateSchema();
+    bool updateSchema(int toVersion);
     int dbSchemaVersion();
     void setDbSchemaVersion(int v);
     
@@ -54,8 +54,7 @@ void StatsTimeSeries::setArbitraryPercentile(double p) {
 }
 
 
-TimeSeries::PointCollection StatsTimeSeries::filterPointsInRange(TimeRange range) {
-  
+TimeRange StatsTimeSeries::resampleRange(TimeRange range) {
   TimeRange qRange = range;
   if (this->willResample()) {
     // expand range
@@ -63,9 +62,24 @@ TimeSeries::PointCollection StatsTimeSeries::filterPointsInRange(TimeRange range
     qRange.end = this->source()->timeAfter(range.end - 1);
     qRange.correctWithRange(range);
   }
+  return qRange;
+}
+
+TimeRange StatsTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
+  // summaries are gathered for time values within the (resampling) range
+  return this->windowedRange(this->resampleRange(range));
+}
+
+
+TimeSeries::PointCollection StatsTimeSeries::filterPointsInRange(TimeRange range) {
   
+  TimeRange qRange = this->resampleRange(range);
   
-  set<time_t> times = this->timeValuesInRange(qRange);
+  
+  TimeGrid times = this->timeValuesInRange(qRange);
   
   pointSummaryMap_t summaries = this->filterSummaryCollection(times);
   vector<Point> outPoints;
@@ -84,7 +98,7 @@ TimeSeries::PointCollection StatsTimeSeries::filterPointsInRange(TimeRange range
     }
   }
   
-  PointCollection ret(outPoints, this->units());
+  PointCollection ret(std::move(outPoints), this->units());
   
   if (this->willResample()) {
     ret.resample(times);
@@ -107,43 +121,70 @@ TimeSeries::PointCollection StatsTimeSeries::filterPointsInRange(TimeRange range
 
 
 double StatsTimeSeries::valueFromSummary(TimeSeries::PointCollection col) {
-  double v;
+  double v = 0;
+  
+  // only ask for the quantiles this statistic needs; the rest comes from the same pass.
+  vector<double> quantiles;
+  switch (_statsType) {
+    case StatsTimeSeriesMedian:
+      quantiles.push_back(.5);
+      break;
+    case StatsTimeSeriesQ25:
+      quantiles.push_back(.25);
+      break;
+    case StatsTimeSeriesQ75:
+      quantiles.push_back(.75);
+      break;
+    case StatsTimeSeriesInterQuartileRange:
+      quantiles.push_back(.25);
+      quantiles.push_back(.75);
+      break;
+    case StatsTimeSeriesPercentile:
+      quantiles.push_back(_percentile);
+      break;
+    default:
+      break;
+  }
+  
+  PointCollection::Summary summary = col.summary(quantiles);
+  
   switch (_statsType) {
     case StatsTimeSeriesMean:
-      v = col.mean();
+      v = summary.mean;
       break;
     case StatsTimeSeriesStdDev:
-      v = sqrt(col.variance());
+      v = sqrt(summary.variance);
       break;
     case StatsTimeSeriesMedian:
-      v = col.percentile(.5);
+      v = summary.quantile(.5);
       break;
     case StatsTimeSeriesQ25:
-      v = col.percentile(.25);
+      v = summary.quantile(.25);
       break;
     case StatsTimeSeriesQ75:
-      v = col.percentile(.75);
+      v = summary.quantile(.75);
       break;
     case StatsTimeSeriesInterQuartileRange:
-      v = col.percentile(.75) - col.percentile(.25);
+      v = summary.quantile(.75) - summary.quantile(.25);
       break;
     case StatsTimeSeriesMax:
-      v = col.max();
+      v = summary.max;
       break;
     case StatsTimeSeriesMin:
-      v = col.min();
+      v = summary.min;
       break;
     case StatsTimeSeriesCount:
-      v = col.count();
+      v = summary.count;
       break;
     case StatsTimeSeriesVar:
-      v = col.variance();
+      v = summary.variance;
       break;
     case StatsTimeSeriesRMS:
-      v = sqrt(col.variance() + col.mean()*col.mean());
+      v = sqrt(summary.variance + summary.mean*summary.mean);
       break;
     case StatsTimeSeriesPercentile:
-      v = col.percentile(_percentile);
+      v = summary.quantile(_percentile);
+      break;
     default:
       break;
   }
@@ -71,6 +71,7 @@ namespace RTX {
     
   protected:
     PointCollection filterPointsInRange(TimeRange range);
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     bool canSetSource(TimeSeries::_sp ts);
     void didSetSource(TimeSeries::_sp ts);
     bool canChangeToUnits(Units units);
@@ -80,6 +81,7 @@ namespace RTX {
     double valueFromSummary(TimeSeries::PointCollection collection);
     Units statsUnits(Units sourceUnits, StatsTimeSeriesType type);
     double _percentile;
+    TimeRange resampleRange(TimeRange range);
     
   };
 }
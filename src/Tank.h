@@ -27,9 +27,6 @@ namespace RTX {
     double minLevel();
     double maxLevel();
     
-    // public ivars for temporary (that is, steady-state) solutions
-    double state_level;
-    
     void setGeometry(std::vector< std::pair<double,double> > levelVolumePoints, Units levelUnits, Units volumeUnits, const std::string& curveName);
     std::vector< std::pair<double,double> > geometry();
     std::pair<Units,Units> geometryUnits();
@@ -0,0 +1,128 @@
+//
+//  TimeGrid.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "TimeGrid.h"
+#include <algorithm>
+
+using namespace RTX;
+using namespace std;
+
+
+TimeGrid::TimeGrid() : _isRegular(true), _start(0), _period(1), _count(0) {
+
+}
+
+TimeGrid::TimeGrid(time_t start, time_t period, size_t count) : _isRegular(true), _start(start), _period(period), _count(count) {
+  if (period <= 0) {
+    // degenerate; at most one time value.
+    _period = 1;
+    _count = (count > 0) ? 1 : 0;
+  }
+}
+
+TimeGrid::TimeGrid(const vector<time_t>& times) : _isRegular(false), _start(0), _period(0), _count(0), _times(times) {
+  // most callers hand over times from an ordered point vector. only sort when we have to.
+  bool ordered = true;
+  for (size_t i = 1; i < _times.size(); ++i) {
+    if (_times[i] <= _times[i-1]) {
+      ordered = false;
+      break;
+    }
+  }
+  if (!ordered) {
+    std::sort(_times.begin(), _times.end());
+    _times.erase(std::unique(_times.begin(), _times.end()), _times.end());
+  }
+}
+
+TimeGrid::TimeGrid(const set<time_t>& times) : _isRegular(false), _start(0), _period(0), _count(0), _times(times.begin(), times.end()) {
+
+}
+
+
+TimeRange TimeGrid::range() const {
+  if (this->empty()) {
+    return TimeRange();
+  }
+  return TimeRange(this->front(), this->back());
+}
+
+
+size_t TimeGrid::lowerBound(time_t time) const {
+  if (_isRegular) {
+    if (_count == 0 || time <= _start) {
+      return 0;
+    }
+    time_t offset = time - _start;
+    size_t idx = (size_t)(offset / _period) + ((offset % _period) ? 1 : 0);
+    return std::min(idx, _count);
+  }
+  return (size_t)(std::lower_bound(_times.begin(), _times.end(), time) - _times.begin());
+}
+
+
+size_t TimeGrid::count(time_t time) const {
+  size_t idx = this->lowerBound(time);
+  if (idx < this->size() && (*this)[idx] == time) {
+    return 1;
+  }
+  return 0;
+}
+
+
+TimeGrid TimeGrid::unionWith(const TimeGrid& other) const {
+  if (other.empty()) {
+    return *this;
+  }
+  if (this->empty()) {
+    return other;
+  }
+  if (_isRegular && other._isRegular && _start == other._start && _period == other._period) {
+    return TimeGrid(_start, _period, std::max(_count, other._count));
+  }
+
+  vector<time_t> merged;
+  merged.reserve(this->size() + other.size());
+  const_iterator a = this->begin(), aEnd = this->end();
+  const_iterator b = other.begin(), bEnd = other.end();
+  while (a != aEnd && b != bEnd) {
+    time_t ta = *a, tb = *b;
+    if (ta < tb) {
+      merged.push_back(ta);
+      ++a;
+    }
+    else if (tb < ta) {
+      merged.push_back(tb);
+      ++b;
+    }
+    else {
+      merged.push_back(ta);
+      ++a;
+      ++b;
+    }
+  }
+  for ( ; a != aEnd; ++a) {
+    merged.push_back(*a);
+  }
+  for ( ; b != bEnd; ++b) {
+    merged.push_back(*b);
+  }
+  return TimeGrid(merged);
+}
+
+
+TimeGrid TimeGrid::shiftedBy(time_t offset) const {
+  if (_isRegular) {
+    return TimeGrid(_start + offset, _period, _count);
+  }
+  vector<time_t> shifted(_times);
+  for (size_t i = 0; i < shifted.size(); ++i) {
+    shifted[i] += offset;
+  }
+  return TimeGrid(shifted);
+}
@@ -0,0 +1,108 @@
+//
+//  TimeGrid.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__TimeGrid__
+#define __epanet_rtx__TimeGrid__
+
+#include <time.h>
+#include <vector>
+#include <set>
+#include <iterator>
+
+#include "TimeRange.h"
+
+namespace RTX {
+
+  /*!
+   \class TimeGrid
+   \brief An ordered, duplicate-free list of time values.
+
+   A regular grid (as generated by a Clock) is stored as a start, period and count, and is never materialized. An irregular grid (as derived from the times of a set of points) keeps a sorted vector. Either way, the grid is read like a sorted container: iterate it, index it, or test membership with count().
+   */
+
+  /*!
+   \fn TimeGrid::TimeGrid(time_t start, time_t period, size_t count)
+   \brief Construct a regular grid.
+   \param start The first time value.
+   \param period The spacing between time values (seconds).
+   \param count The number of time values.
+
+   \fn TimeGrid::TimeGrid(const std::vector<time_t>& times)
+   \brief Construct an irregular grid. Times are sorted and de-duplicated if needed.
+
+   \fn size_t TimeGrid::count(time_t time) const
+   \brief Membership test, analogous to std::set::count.
+   \return 1 if the time value is on the grid, otherwise 0.
+
+   \fn TimeGrid TimeGrid::unionWith(const TimeGrid& other) const
+   \brief Merge two grids. The result is regular only if both grids are regular and identical.
+   */
+
+  class TimeGrid {
+  public:
+
+    class const_iterator {
+    public:
+      typedef std::bidirectional_iterator_tag iterator_category;
+      typedef time_t value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const time_t* pointer;
+      typedef time_t reference;
+
+      const_iterator() : _grid(NULL), _index(0) {};
+      const_iterator(const TimeGrid* grid, size_t index) : _grid(grid), _index(index) {};
+      time_t operator*() const { return (*_grid)[_index]; };
+      const_iterator& operator++() { ++_index; return *this; };
+      const_iterator operator++(int) { const_iterator tmp = *this; ++_index; return tmp; };
+      const_iterator& operator--() { --_index; return *this; };
+      const_iterator operator--(int) { const_iterator tmp = *this; --_index; return tmp; };
+      bool operator==(const const_iterator& other) const { return _index == other._index && _grid == other._grid; };
+      bool operator!=(const const_iterator& other) const { return !(*this == other); };
+      size_t index() const { return _index; };
+    private:
+      const TimeGrid* _grid;
+      size_t _index;
+    };
+    typedef const_iterator iterator;
+    typedef time_t value_type;
+    typedef size_t size_type;
+
+    TimeGrid();
+    TimeGrid(time_t start, time_t period, size_t count);
+    TimeGrid(const std::vector<time_t>& times);
+    TimeGrid(const std::set<time_t>& times); // compatibility with set-based callers
+
+    bool isRegular() const { return _isRegular; };
+    time_t period() const { return _isRegular ? _period : 0; };
+
+    size_t size() const { return _isRegular ? _count : _times.size(); };
+    bool empty() const { return this->size() == 0; };
+    time_t operator[](size_t i) const { return _isRegular ? _start + (time_t)i * _period : _times[i]; };
+    time_t front() const { return (*this)[0]; };
+    time_t back() const { return (*this)[this->size() - 1]; };
+    TimeRange range() const;
+
+    size_t count(time_t time) const;
+    size_t lowerBound(time_t time) const; // index of the first time value >= time
+
+    TimeGrid unionWith(const TimeGrid& other) const;
+    TimeGrid shiftedBy(time_t offset) const;
+
+    const_iterator begin() const { return const_iterator(this, 0); };
+    const_iterator end() const { return const_iterator(this, this->size()); };
+
+  private:
+    bool _isRegular;
+    time_t _start, _period;
+    size_t _count;
+    std::vector<time_t> _times;
+  };
+
+}
+
+#endif /* defined(__epanet_rtx__TimeGrid__) */
@@ -7,32 +7,238 @@
 //
 
 #include <limits.h>
+#include <limits>
+#include <algorithm>
+#include <math.h>
 #include <boost/foreach.hpp>
 
 #include "TimeSeries.h"
 #include "PointRecord.h"
 
+#include <boost/foreach.hpp>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
-#include <boost/accumulators/statistics/tail_quantile.hpp>
-#include <boost/foreach.hpp>
 
 
 using namespace RTX;
 using namespace std;
 using namespace boost::accumulators;
 
+#pragma mark - Reduction kernels
+
+namespace {
+  
+  // min, max, mean and variance fused into one sweep of a contiguous buffer.
+  void _pcSummarize(const double *v, size_t n, TimeSeries::PointCollection::Summary& s) {
+    s.count = n;
+    if (n == 0) {
+      s.min = numeric_limits<double>::max();
+      s.max = -numeric_limits<double>::max();
+      s.mean = numeric_limits<double>::quiet_NaN();
+      s.variance = numeric_limits<double>::quiet_NaN();
+      return;
+    }
+    const double k = v[0];
+    double lo[4] = {k,k,k,k}, hi[4] = {k,k,k,k};
+    double s1[4] = {0,0,0,0}, s2[4] = {0,0,0,0};
+    size_t i = 0;
+    for ( ; i + 4 <= n; i += 4) {
+      for (int l = 0; l < 4; ++l) {
+        const double x = v[i+l];
+        const double d = x - k;
+        lo[l] = (x < lo[l]) ? x : lo[l];
+        hi[l] = (x > hi[l]) ? x : hi[l];
+        s1[l] += d;
+        s2[l] += d * d;
+      }
+    }
+    for ( ; i < n; ++i) {
+      const double x = v[i];
+      const double d = x - k;
+      lo[0] = (x < lo[0]) ? x : lo[0];
+      hi[0] = (x > hi[0]) ? x : hi[0];
+      s1[0] += d;
+      s2[0] += d * d;
+    }
+    const double sum = (s1[0] + s1[1]) + (s1[2] + s1[3]);
+    const double sumSq = (s2[0] + s2[1]) + (s2[2] + s2[3]);
+    const double dn = (double)n;
+    s.min = std::min( std::min(lo[0], lo[1]), std::min(lo[2], lo[3]) );
+    s.max = std::max( std::max(hi[0], hi[1]), std::max(hi[2], hi[3]) );
+    s.mean = k + sum / dn;
+    s.variance = std::max(0., (sumSq - sum * sum / dn) / dn);
+  }
+  
+  // zero-based index into an ascending buffer of n values for quantile p
+  size_t _pcQuantileIndex(size_t n, double p) {
+    size_t rank;
+    if (p <= 0.5) {
+      rank = (size_t)ceil((double)n * p);
+      return (rank > 0) ? std::min(rank, n) - 1 : 0;
+    }
+    rank = (size_t)ceil((double)n * (1. - p));
+    return (rank > 0) ? n - std::min(rank, n) : n - 1;
+  }
+  
+  // exact quantiles by selection, with the rank convention of the boost tail_quantile accumulator
+  // (lower tail for p <= 0.5, upper tail otherwise); out-of-range ranks are clamped to the extremes.
+  // the scratch buffer is partially reordered: each nth_element call only has to partition the
+  // part of the buffer above the previously selected rank, so several quantiles share one partition.
+  void _pcSelectQuantiles(vector<double>& scratch, const vector<double>& probabilities, map<double,double>& out) {
+    const size_t n = scratch.size();
+    if (n == 0) {
+      return;
+    }
+    
+    vector<pair<size_t,double> > wanted; // (index, probability)
+    wanted.reserve(probabilities.size());
+    BOOST_FOREACH(double p, probabilities) {
+      if (0. <= p && p <= 1.) {
+        wanted.push_back(make_pair(_pcQuantileIndex(n, p), p));
+      }
+    }
+    std::sort(wanted.begin(), wanted.end());
+    
+    vector<double>::iterator lo = scratch.begin();
+    size_t lastIndex = 0;
+    bool haveLast = false;
+    typedef pair<size_t,double> indexProb_t;
+    BOOST_FOREACH(const indexProb_t& ip, wanted) {
+      if (!haveLast || ip.first != lastIndex) {
+        std::nth_element(lo, scratch.begin() + ip.first, scratch.end());
+        lastIndex = ip.first;
+        lo = scratch.begin() + ip.first + 1;
+        haveLast = true;
+      }
+      out[ip.second] = scratch[lastIndex];
+    }
+  }
+
+
+  // output-time accessors for the resampling kernel. the regular accessor is pure arithmetic,
+  // so the per-tick loops below carry no branch on the grid representation.
+  class _pcRegularTimes {
+  public:
+    _pcRegularTimes(const TimeGrid& grid) : _start(grid.front()), _period(grid.period()) { };
+    time_t operator[](size_t i) const { return _start + (time_t)i * _period; };
+  private:
+    time_t _start, _period;
+  };
+
+  class _pcGridTimes {
+  public:
+    _pcGridTimes(const TimeGrid& grid) : _grid(grid) { };
+    time_t operator[](size_t i) const { return _grid[i]; };
+  private:
+    const TimeGrid& _grid;
+  };
+
+  // two-pointer resampling sweep. output slots are known up front (every grid time inside the
+  // source span yields exactly one point), so the buffer is sized once and filled by index.
+  // in linear mode, each source segment is visited once: its quality / confidence are computed
+  // there, and all grid times falling inside it are interpolated in one tight loop.
+  template<class T> void _pcResample(const vector<Point>& source, const TimeGrid& grid, const T& times, TimeSeries::TimeSeriesResampleMode mode, vector<Point>& out) {
+    const size_t nSource = source.size();
+    if (nSource == 0 || grid.empty()) {
+      out.clear();
+      return;
+    }
+
+    const size_t first = grid.lowerBound(source.front().time);
+    size_t last = grid.size();
+    if (mode == TimeSeries::TimeSeriesResampleModeLinear) {
+      // no extrapolation past the last source point
+      last = std::min(last, grid.lowerBound(source.back().time + 1));
+    }
+    if (first >= last) {
+      out.clear();
+      return;
+    }
+    // every slot is overwritten below, so a reused buffer is resized in place rather than cleared and
+    // rebuilt: Point's constructor and destructor are out of line, and would cost a call per slot.
+    out.resize(last - first);
+
+    Point *dst = &out.front();
+    size_t seg = 0;
+    size_t i = first;
+
+    if (mode == TimeSeries::TimeSeriesResampleModeStep) {
+      while (i < last) {
+        const time_t now = times[i];
+        while (seg + 1 < nSource && source[seg + 1].time <= now) {
+          ++seg;
+        }
+        // hold the point until the next one is reached. compared tick by tick rather than found with
+        // lowerBound, since a held point often covers a single tick (always, when downsampling).
+        const Point& held = source[seg];
+        const time_t next = (seg + 1 < nSource) ? source[seg + 1].time : numeric_limits<time_t>::max();
+        do {
+          *dst = held;
+          dst->time = times[i];
+          ++dst;
+          ++i;
+        } while (i < last && times[i] < next);
+      }
+      return;
+    }
+
+    while (i < last) {
+      const time_t now = times[i];
+      while (seg + 1 < nSource && source[seg + 1].time <= now) {
+        ++seg;
+      }
+      const Point& left = source[seg];
+      if (left.time == now) {
+        // exact hit; the source point is passed through untouched
+        *dst = left;
+        ++dst;
+        ++i;
+        continue;
+      }
+
+      // left.time < now <= source.back().time, so there is a right-hand point.
+      const Point& right = source[seg + 1];
+      const size_t end = std::min(grid.lowerBound(right.time), last);
+
+      Point proto(now, 0., (Point::PointQuality)(left.quality | right.quality), (left.confidence + right.confidence) / 2);
+      proto.addQualFlag(Point::rtx_interpolated);
+      const Point::PointQuality q = proto.quality;
+      const double c = proto.confidence;
+      const double v0 = left.value;
+      const double dv = right.value - left.value;
+      const time_t t0 = left.time;
+      const time_t dt = right.time - left.time;
+
+      for ( ; i < end; ++i, ++dst) {
+        const time_t t = times[i];
+        const double v = v0 + dv * (t - t0) / dt; // same operation order as Point::linearInterpolate
+        dst->time = t;
+        dst->value = v;
+        dst->quality = q;
+        dst->confidence = c;
+        dst->isValid = (v == v);
+      }
+    }
+  }
+
+}
+
+
 #pragma mark - Point Collection methods
 
-TimeSeries::PointCollection::PointCollection(vector<Point> points, Units units) : points(points), units(units) { }
+TimeSeries::PointCollection::PointCollection(vector<Point> points, Units units) : points(std::move(points)), units(units) { }
 TimeSeries::PointCollection::PointCollection() : points(vector<Point>()), units(1) { }
 
-set<time_t> TimeSeries::PointCollection::times() {
-  set<time_t> t;
+
+#pragma mark Collection
+
+TimeGrid TimeSeries::PointCollection::times() {
+  vector<time_t> t;
+  t.reserve(this->points.size());
   BOOST_FOREACH(const Point& p, this->points) {
-    t.insert(p.time);
+    t.push_back(p.time);
   }
-  return t;
+  return TimeGrid(t);
 }
 
 bool TimeSeries::PointCollection::convertToUnits(RTX::Units u) {
@@ -60,31 +266,28 @@ double TimeSeries::PointCollection::percentile(double p) {
     return 0.;
   }
   
-  int cacheSize = (int)this->points.size();
-  using namespace boost::accumulators;
-  
-  if (cacheSize == 1 && p == 0.5) {
-    // single point median
-    return this->points.front().value;
+  vector<double> scratch;
+  scratch.reserve(this->points.size());
+  BOOST_FOREACH(const Point& point, this->points) {
+    scratch.push_back(point.value);
   }
   
-  if (p <= 0.5) {
-    accumulator_set<double, stats<tag::tail_quantile<boost::accumulators::left> > > centile( tag::tail<boost::accumulators::left>::cache_size = cacheSize );
-    BOOST_FOREACH(const Point& point, this->points) {
-      centile(point.value);
-    }
-    double pct = quantile(centile, quantile_probability = p);
-    return pct;
+  map<double,double> q;
+  _pcSelectQuantiles(scratch, vector<double>(1, p), q);
+  if (q.empty()) {
+    return numeric_limits<double>::quiet_NaN();
   }
-  else {
-    accumulator_set<double, stats<tag::tail_quantile<boost::accumulators::right> > > centile( tag::tail<boost::accumulators::right>::cache_size = cacheSize );
-    BOOST_FOREACH(const Point& point, this->points) {
-      centile(point.value);
-    }
-    double pct = quantile(centile, quantile_probability = p);
-    return pct;
+  return q.begin()->second;
+}
+
+vector<double> TimeSeries::PointCollection::percentiles(const vector<double>& p) {
+  Summary s = this->summary(p);
+  vector<double> out;
+  out.reserve(p.size());
+  BOOST_FOREACH(double prob, p) {
+    out.push_back(s.quantile(prob));
   }
-  
+  return out;
 }
 
 size_t TimeSeries::PointCollection::count() {
@@ -137,11 +340,51 @@ double TimeSeries::PointCollection::variance() {
 }
 
 
+TimeSeries::PointCollection::Summary TimeSeries::PointCollection::summary(const vector<double>& quantiles) {
+  Summary s;
+  
+  // one pass over the points to get a contiguous value buffer, then a fused sweep over that.
+  vector<double> values;
+  values.reserve(this->points.size());
+  BOOST_FOREACH(const Point& p, this->points) {
+    values.push_back(p.value);
+  }
+  _pcSummarize(values.data(), values.size(), s);
+  
+  if (!quantiles.empty()) {
+    // the value buffer doubles as the selection scratch space
+    _pcSelectQuantiles(values, quantiles, s.quantiles);
+  }
+  
+  return s;
+}
+
+double TimeSeries::PointCollection::Summary::quantile(double p) const {
+  if (count == 0 || p < 0. || p > 1.) {
+    return numeric_limits<double>::quiet_NaN();
+  }
+  map<double,double>::const_iterator found = quantiles.find(p);
+  if (found != quantiles.end()) {
+    return found->second;
+  }
+  
+  // not selected: interpolate between the nearest quantiles that were, with min and max standing in for 0 and 1.
+  map<double,double> known(quantiles);
+  known.insert(make_pair(0., min));
+  known.insert(make_pair(1., max));
+  map<double,double>::const_iterator above = known.lower_bound(p);
+  map<double,double>::const_iterator below = above;
+  --below;
+  return below->second + (above->second - below->second) * (p - below->first) / (above->first - below->first);
+}
+
+
 
 
-bool TimeSeries::PointCollection::resample(set<time_t> timeList, TimeSeriesResampleMode mode) {
-  PointCollection c = this->resampledAtTimes(timeList,mode);
-  this->points = c.points;
+bool TimeSeries::PointCollection::resample(const TimeGrid& timeList, TimeSeriesResampleMode mode) {
+  vector<Point> resampled;
+  this->resampleInto(timeList, resampled, mode);
+  this->points.swap(resampled);
   
   if (this->count() > 0) {
     return true;
@@ -149,9 +392,16 @@ bool TimeSeries::PointCollection::resample(set<time_t> timeList, TimeSeriesResam
   return false;
 }
 
-TimeSeries::PointCollection TimeSeries::PointCollection::resampledAtTimes(std::set<time_t> timeList, TimeSeriesResampleMode mode) {
-  
-  typedef std::vector<Point>::const_iterator pVec_cIt;
+void TimeSeries::PointCollection::resampleInto(const TimeGrid& timeList, vector<Point>& out, TimeSeriesResampleMode mode) {
+  if (timeList.isRegular() && !timeList.empty()) {
+    _pcResample(this->points, timeList, _pcRegularTimes(timeList), mode, out);
+  }
+  else {
+    _pcResample(this->points, timeList, _pcGridTimes(timeList), mode, out);
+  }
+}
+
+TimeSeries::PointCollection TimeSeries::PointCollection::resampledAtTimes(const TimeGrid& timeList, TimeSeriesResampleMode mode) {
   
   // sanity
   if (timeList.empty()) {
@@ -161,58 +411,26 @@ TimeSeries::PointCollection TimeSeries::PointCollection::resampledAtTimes(std::s
     return PointCollection();
   }
   
+  PointCollection resampled(vector<Point>(), this->units);
+  this->resampleInto(timeList, resampled.points, mode);
   
-  vector<Point> resampled;
-  vector<Point>::size_type s = timeList.size();
-  resampled.reserve(s);
-  
-  
-  // iterators for scrubbing through the source points
-  pVec_cIt sourceBegin = this->points.begin();
-  pVec_cIt sourceEnd = this->points.end();
-  pVec_cIt right = sourceBegin;
-  pVec_cIt left = sourceBegin;
-  
-  ++right; // get one step ahead.
-  
-  BOOST_FOREACH(const time_t now, timeList) {
-    
-    // maybe we can't resample at now
-    if (now < left->time) {
-      continue;
-    }
-    
-    // get positioned
-    while (right != sourceEnd && right->time <= now) {
-      ++left;
-      ++right;
-    }
-    
-    Point p;
-    if (mode == TimeSeriesResampleModeLinear) {
-      if (right != sourceEnd) {
-        p = Point::linearInterpolate(*left, *right, now);
-        resampled.push_back(p);
-      }
-      else {
-        if (left->time == now) {
-          p = *left;
-          resampled.push_back(p);
-        }
-        break;
+  return resampled;
+}
+
+
+void TimeSeries::PointCollection::trimToRange(TimeRange range) {
+  size_t nKept = 0;
+  for (size_t i = 0; i < this->points.size(); ++i) {
+    if (range.contains(this->points[i].time)) {
+      if (nKept != i) {
+        this->points[nKept] = this->points[i];
       }
-    }
-    else if (mode == TimeSeriesResampleModeStep) {
-      p = *left;
-      p.time = now;
-      resampled.push_back(p);
+      ++nKept;
     }
   }
-  
-  return PointCollection(resampled,this->units);
+  this->points.resize(nKept);
 }
 
-
 TimeSeries::PointCollection TimeSeries::PointCollection::trimmedToRange(TimeRange range) {
   
   vector<Point> filtered;
@@ -223,7 +441,7 @@ TimeSeries::PointCollection TimeSeries::PointCollection::trimmedToRange(TimeRang
     }
   }
   
-  PointCollection pc(filtered, this->units);
+  PointCollection pc(std::move(filtered), this->units);
   return pc;
 }
 
@@ -244,7 +462,7 @@ TimeSeries::PointCollection TimeSeries::PointCollection::asDelta() {
     }
   }
   
-  return PointCollection(deltaPoints, this->units);
+  return PointCollection(std::move(deltaPoints), this->units);
 }
 
 
@@ -254,6 +472,7 @@ TimeSeries::PointCollection TimeSeries::PointCollection::asDelta() {
 TimeSeries::TimeSeries() {
   _name = "";
   _points.reset( new PointRecord() );
+  _handle = RTX_NO_HANDLE;
   setName("Time Series");
   _units = RTX_NO_UNITS;
 }
@@ -275,6 +494,7 @@ std::ostream& RTX::operator<< (std::ostream &out, TimeSeries &ts) {
 void TimeSeries::setName(const std::string& name) {
   _name = name;
   _points->registerAndGetIdentifierForSeriesWithUnits(name, this->units());
+  _handle = _points->handleForIdentifier(name);
 }
 
 std::string TimeSeries::name() {
@@ -282,11 +502,11 @@ std::string TimeSeries::name() {
 }
 
 void TimeSeries::insert(Point thisPoint) {
-  _points->addPoint(name(), thisPoint);
+  _points->addPoint(_handle, thisPoint);
 }
 
-void TimeSeries::insertPoints(std::vector<Point> points) {
-  _points->addPoints(name(), points);
+void TimeSeries::insertPoints(const std::vector<Point>& points) {
+  _points->addPoints(_handle, points);
 }
 
 Point TimeSeries::point(time_t time) {
@@ -314,18 +534,12 @@ std::vector< Point > TimeSeries::points(TimeRange range) {
     return points;
   }
   
-  points = this->record()->pointsInRange(this->name(), range.start, range.end);
+  points = _points->pointsInRange(_handle, range.start, range.end);
   return points;
 }
 
-std::set<time_t> TimeSeries::timeValuesInRange(TimeRange range) {
-  
-  vector<Point> points = this->points(range);
-  set<time_t> times;
-  BOOST_FOREACH(const Point& p, points) {
-    times.insert(p.time);
-  }
-  return times;
+TimeGrid TimeSeries::timeValuesInRange(TimeRange range) {
+  return this->pointCollection(range).times();
 }
 
 time_t TimeSeries::timeAfter(time_t t) {
@@ -356,7 +570,7 @@ Point TimeSeries::pointBefore(time_t time) {
     return myPoint;
   }
   
-  myPoint = this->record()->pointBefore(this->name(), time);
+  myPoint = _points->pointBefore(_handle, time);
   return myPoint;
 }
 
@@ -366,7 +580,7 @@ Point TimeSeries::pointAfter(time_t time) {
     return myPoint;
   }
   
-  myPoint = this->record()->pointAfter(this->name(), time);
+  myPoint = _points->pointAfter(_handle, time);
   return myPoint;
 }
 
@@ -387,6 +601,7 @@ void TimeSeries::setRecord(PointRecord::_sp record) {
   
   if (record->registerAndGetIdentifierForSeriesWithUnits(this->name(),this->units())) {
     _points = record;
+    _handle = record->handleForIdentifier(this->name());
   }
   
   return;
@@ -407,6 +622,7 @@ void TimeSeries::invalidate() {
       PointRecord::_sp pr( new PointRecord() );
       _points = pr;
     }
+    _handle = _points->handleForIdentifier(this->name());
   }
 }
 
@@ -427,6 +643,7 @@ void TimeSeries::setUnits(Units newUnits) {
       else {
         if (_points) {
           _points->registerAndGetIdentifierForSeriesWithUnits(this->name(), this->units());
+          _handle = _points->handleForIdentifier(this->name());
         }
       }
     }
@@ -14,6 +14,7 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <utility>
 #include <iostream>
 
 #include "rtxMacros.h"
@@ -22,6 +23,7 @@
 #include "Clock.h"
 #include "Units.h"
 #include "TimeRange.h"
+#include "TimeGrid.h"
 
 namespace RTX {
 
@@ -51,6 +53,14 @@ namespace RTX {
    
    \sa Point
    */
+  /*!
+   \fn virtual TimeRange TimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range)
+   \brief The range of an upstream series that this series reads in order to produce a range of points.
+   \param upstream One of the series returned by upstreamSeries().
+   \param range The range requested of this series.
+   \return The (widened) range this series will request of upstream, or an invalid range if upstream is not an input.
+   \sa TimeSeriesEvaluationPlan
+   */
   
   
   
@@ -66,22 +76,35 @@ namespace RTX {
     // internal public class for managing meta-information
     class PointCollection {
     public:
-      PointCollection(std::vector<Point> points, Units units);
+
+      // everything the stats filters ask of a collection, gathered in a single pass.
+      class Summary {
+      public:
+        Summary() : count(0), min(0), max(0), mean(0), variance(0) {};
+        size_t count;
+        double min, max, mean, variance;
+        std::map<double,double> quantiles; // probability -> value
+        double quantile(double p) const; // one that wasn't asked for is interpolated from those that were (and min / max)
+      };
+
+      PointCollection(std::vector<Point> points, Units units); // pass a local vector with std::move to hand it over without a copy
       PointCollection(); // null constructor
-      
+
       std::vector<Point> points;
       Units units;
-      std::set<time_t> times();
+      TimeGrid times();
       
-      bool resample(std::set<time_t> timeList, TimeSeriesResampleMode mode = TimeSeriesResampleModeLinear);
+      bool resample(const TimeGrid& timeList, TimeSeriesResampleMode mode = TimeSeriesResampleModeLinear);
+      void resampleInto(const TimeGrid& timeList, std::vector<Point>& out, TimeSeriesResampleMode mode = TimeSeriesResampleModeLinear); // reuses out's storage
       bool convertToUnits(Units u);
+      void trimToRange(TimeRange range);
       void addQualityFlag(Point::PointQuality q);
       
       // non-mutating
       PointCollection trimmedToRange(TimeRange range);
-      PointCollection resampledAtTimes(std::set<time_t> times, TimeSeriesResampleMode mode = TimeSeriesResampleModeLinear);
+      PointCollection resampledAtTimes(const TimeGrid& times, TimeSeriesResampleMode mode = TimeSeriesResampleModeLinear);
       PointCollection asDelta();
-      
+
       // statistical methods on the collection
       double min();
       double max();
@@ -89,6 +112,8 @@ namespace RTX {
       double variance();
       size_t count();
       double percentile(double p);
+      std::vector<double> percentiles(const std::vector<double>& p); // several quantiles, one partition
+      Summary summary(const std::vector<double>& quantiles = std::vector<double>());
     };
     
     
@@ -104,7 +129,7 @@ namespace RTX {
     virtual void setClock(Clock::_sp clock) { };
     
     virtual void insert(Point aPoint);
-    virtual void insertPoints(std::vector<Point>);  /// option to add lots of (un)ordered points all at once.
+    virtual void insertPoints(const std::vector<Point>& points);  /// option to add lots of (un)ordered points all at once.
     
     virtual Point point(time_t time);
     virtual Point pointBefore(time_t time);
@@ -113,7 +138,7 @@ namespace RTX {
     PointCollection pointCollection(TimeRange range);
     virtual std::vector< Point > points(TimeRange range); // points in range
     
-    virtual std::set<time_t> timeValuesInRange(TimeRange range);
+    virtual TimeGrid timeValuesInRange(TimeRange range);
     virtual time_t timeAfter(time_t t);
     virtual time_t timeBefore(time_t t);
     
@@ -128,6 +153,8 @@ namespace RTX {
     virtual bool canChangeToUnits(Units units) {return true;};
     
     virtual TimeSeries::_sp rootTimeSeries() { return shared_from_this(); };
+    virtual std::vector<TimeSeries::_sp> upstreamSeries() { return std::vector<TimeSeries::_sp>(); }; // direct inputs; none for a root
+    virtual TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range) { return TimeRange(); }; // range of upstream read to produce range
     virtual void resetCache();
     virtual void invalidate();
     
@@ -141,6 +168,7 @@ namespace RTX {
     
   private:
     PointRecord::_sp _points;
+    PointRecord::handle_t _handle; // this series, in _points
     std::string _name;
     Units _units;
     std::pair<time_t, time_t> _validTimeRange;
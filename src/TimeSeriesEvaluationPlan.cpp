@@ -0,0 +1,313 @@
+//
+//  TimeSeriesEvaluationPlan.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "TimeSeriesEvaluationPlan.h"
+#include "BufferPointRecord.h"
+#include "DbPointRecord.h"
+#include "TimeSeriesFilter.h"
+#include "rtxExceptions.h"
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+
+using namespace RTX;
+using namespace std;
+
+namespace {
+  typedef map<TimeSeries::_sp, PointRecord::_sp> recordMap_t;
+  typedef pair<TimeSeries::_sp, PointRecord::_sp> tsRecordPair;
+  
+  void _restoreRecords(const recordMap_t& originalRecords) {
+    BOOST_FOREACH(const tsRecordPair& original, originalRecords) {
+      original.first->setRecord(original.second);
+    }
+  }
+  
+  bool _compareTime(const Point& p, time_t t) {
+    return p.time < t;
+  }
+  bool _compareTimeReverse(time_t t, const Point& p) {
+    return t < p.time;
+  }
+  
+  // an in-memory copy of one root's points over a known range. reads that can be
+  // answered from the copy are; anything else goes to the original record.
+  class _RootSnapshotRecord : public PointRecord {
+  public:
+    _RootSnapshotRecord(PointRecord::_sp original, TimeRange range, std::vector<Point> points) : _original(original), _range(range), _points(std::move(points)) {};
+    
+    using PointRecord::point;
+    using PointRecord::pointBefore;
+    using PointRecord::pointAfter;
+    using PointRecord::pointsInRange;
+    using PointRecord::addPoint;
+    using PointRecord::addPoints;
+    
+    bool registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) { return true; };
+    const std::map<std::string, Units> identifiersAndUnits() { return _original->identifiersAndUnits(); };
+    
+    Point point(const string& identifier, time_t time) {
+      if (!_range.contains(time)) {
+        return _original->point(identifier, time);
+      }
+      vector<Point>::const_iterator it = lower_bound(_points.begin(), _points.end(), time, _compareTime);
+      if (it != _points.end() && it->time == time) {
+        return *it;
+      }
+      return Point();
+    };
+    Point pointBefore(const string& identifier, time_t time) {
+      if (time > _range.start && time - 1 <= _range.end) {
+        vector<Point>::const_iterator it = lower_bound(_points.begin(), _points.end(), time, _compareTime);
+        if (it != _points.begin()) {
+          return *(--it);
+        }
+      }
+      return _original->pointBefore(identifier, time);
+    };
+    Point pointAfter(const string& identifier, time_t time) {
+      if (time < _range.end && time + 1 >= _range.start) {
+        vector<Point>::const_iterator it = upper_bound(_points.begin(), _points.end(), time, _compareTimeReverse);
+        if (it != _points.end()) {
+          return *it;
+        }
+      }
+      return _original->pointAfter(identifier, time);
+    };
+    std::vector<Point> pointsInRange(const string& identifier, time_t startTime, time_t endTime) {
+      if (startTime < _range.start || endTime > _range.end) {
+        return _original->pointsInRange(identifier, startTime, endTime);
+      }
+      vector<Point>::const_iterator first = lower_bound(_points.begin(), _points.end(), startTime, _compareTime);
+      vector<Point>::const_iterator last = upper_bound(first, _points.cend(), endTime, _compareTimeReverse);
+      return vector<Point>(first, last);
+    };
+    
+    void addPoint(const string& identifier, Point point) { _original->addPoint(identifier, point); };
+    void addPoints(const string& identifier, const std::vector<Point>& points) { _original->addPoints(identifier, points); };
+    void reset() { _original->reset(); };
+    void reset(const string& identifier) { _original->reset(identifier); };
+    Point firstPoint(const string& id) { return _original->firstPoint(id); };
+    Point lastPoint(const string& id) { return _original->lastPoint(id); };
+    time_pair_t range(const string& id) { return _original->range(id); };
+    
+  private:
+    PointRecord::_sp _original;
+    TimeRange _range;
+    std::vector<Point> _points;
+  };
+}
+
+std::ostream& RTX::operator<< (std::ostream &out, TimeSeriesEvaluationPlan &plan) {
+  return plan.toStream(out);
+}
+
+
+TimeSeriesEvaluationPlan::TimeSeriesEvaluationPlan(TimeSeries::_sp sink, TimeRange range) {
+  if (sink) {
+    _sinks.push_back(sink);
+  }
+  _range = range;
+  this->build();
+}
+
+TimeSeriesEvaluationPlan::TimeSeriesEvaluationPlan(std::vector<TimeSeries::_sp> sinks, TimeRange range) {
+  BOOST_FOREACH(TimeSeries::_sp sink, sinks) {
+    if (sink) {
+      _sinks.push_back(sink);
+    }
+  }
+  _range = range;
+  this->build();
+}
+
+
+#pragma mark - Public
+
+std::vector<TimeSeries::_sp> TimeSeriesEvaluationPlan::nodes() {
+  return _nodes;
+}
+
+std::vector<TimeSeries::_sp> TimeSeriesEvaluationPlan::roots() {
+  vector<TimeSeries::_sp> roots;
+  BOOST_FOREACH(TimeSeries::_sp ts, _nodes) {
+    if (ts->upstreamSeries().empty()) {
+      roots.push_back(ts);
+    }
+  }
+  return roots;
+}
+
+std::vector<TimeSeries::_sp> TimeSeriesEvaluationPlan::sinks() {
+  return _sinks;
+}
+
+TimeRange TimeSeriesEvaluationPlan::range() {
+  return _range;
+}
+
+TimeRange TimeSeriesEvaluationPlan::rangeForSeries(TimeSeries::_sp ts) {
+  map<TimeSeries::_sp, TimeRange>::const_iterator found = _ranges.find(ts);
+  if (found == _ranges.end()) {
+    return TimeRange();
+  }
+  return found->second;
+}
+
+std::vector<Point> TimeSeriesEvaluationPlan::points(TimeSeries::_sp sink) {
+  map<TimeSeries::_sp, vector<Point> >::const_iterator found = _results.find(sink);
+  if (found == _results.end()) {
+    return vector<Point>();
+  }
+  return found->second;
+}
+
+
+void TimeSeriesEvaluationPlan::preFetchRoots() {
+  // roots that share a database and a range are selected together.
+  typedef pair<DbPointRecord::_sp, pair<time_t,time_t> > batchKey_t;
+  map<batchKey_t, vector<string> > batches;
+  BOOST_FOREACH(TimeSeries::_sp ts, this->roots()) {
+    TimeRange r = this->rangeForSeries(ts);
+    DbPointRecord::_sp record = boost::dynamic_pointer_cast<DbPointRecord>(ts->record());
+    if (r.isValid() && record) {
+      batches[make_pair(record, make_pair(r.start, r.end))].push_back(ts->name());
+    }
+  }
+  typedef pair<const batchKey_t, vector<string> > batchPair_t;
+  BOOST_FOREACH(const batchPair_t& batch, batches) {
+    batch.first.first->preFetchRanges(batch.second, batch.first.second.first, batch.first.second.second);
+  }
+}
+
+
+void TimeSeriesEvaluationPlan::evaluate() {
+  _results.clear();
+  this->preFetchRoots();
+
+  recordMap_t originalRecords;
+  try {
+    BOOST_FOREACH(TimeSeries::_sp ts, _nodes) {
+      TimeRange r = this->rangeForSeries(ts);
+      PointRecord::_sp record = ts->record();
+      if (!r.isValid() || !record) {
+        continue;
+      }
+      if (ts->upstreamSeries().empty()) {
+        // roots are fetched once, over everything their consumers need. every read
+        // within that range is then answered from the snapshot.
+        vector<Point> fetched = record->pointsInRange(ts->name(), r.start, r.end);
+        originalRecords[ts] = record;
+        ts->setRecord(PointRecord::_sp(new _RootSnapshotRecord(record, r, std::move(fetched))));
+      }
+      else if (!boost::dynamic_pointer_cast<BufferPointRecord>(record)) {
+        // stages that don't keep their own buffer get a temporary one, so that
+        // downstream reads of a stage's output are served from memory.
+        originalRecords[ts] = record;
+        ts->setRecord(PointRecord::_sp(new BufferPointRecord()));
+      }
+    }
+    
+    // inputs first, sinks last.
+    BOOST_FOREACH(TimeSeries::_sp ts, _nodes) {
+      TimeRange r = this->rangeForSeries(ts);
+      bool isSink = (find(_sinks.begin(), _sinks.end(), ts) != _sinks.end());
+      if (!r.isValid() || (ts->upstreamSeries().empty() && !isSink)) {
+        continue; // roots are already in memory.
+      }
+      vector<Point> produced = ts->points(r);
+      if (isSink) {
+        TimeSeries::PointCollection c(std::move(produced), ts->units());
+        c.trimToRange(_range);
+        _results[ts] = std::move(c.points);
+      }
+    }
+  } catch (...) {
+    _restoreRecords(originalRecords);
+    throw;
+  }
+  
+  _restoreRecords(originalRecords);
+}
+
+
+std::ostream& TimeSeriesEvaluationPlan::toStream(std::ostream &stream) {
+  stream << "Evaluation plan: " << _nodes.size() << " nodes, " << _sinks.size() << " sinks" << endl;
+  BOOST_FOREACH(TimeSeries::_sp ts, _nodes) {
+    TimeRange r = this->rangeForSeries(ts);
+    stream << "  " << (ts->upstreamSeries().empty() ? "root " : "stage ") << "\"" << ts->name() << "\" : " << r.start << " - " << r.end << endl;
+  }
+  return stream;
+}
+
+
+#pragma mark - Private
+
+void TimeSeriesEvaluationPlan::build() {
+  _nodes.clear();
+  _ranges.clear();
+  _results.clear();
+
+  // depth-first, post-order: every series is listed after all of its inputs.
+  map<TimeSeries::_sp, int> state;
+  BOOST_FOREACH(TimeSeries::_sp sink, _sinks) {
+    this->visit(sink, state);
+  }
+
+  // walk back from the sinks. in reverse topological order, every consumer of
+  // a series has been visited before the series itself, so its range is complete.
+  BOOST_FOREACH(TimeSeries::_sp sink, _sinks) {
+    _ranges[sink] = _range;
+  }
+  for (vector<TimeSeries::_sp>::reverse_iterator it = _nodes.rbegin(); it != _nodes.rend(); ++it) {
+    TimeSeries::_sp consumer = *it;
+    TimeRange consumerRange = this->rangeForSeries(consumer);
+    if (!consumerRange.isValid()) {
+      continue;
+    }
+    BOOST_FOREACH(TimeSeries::_sp upstream, consumer->upstreamSeries()) {
+      TimeRange needed = consumer->upstreamRange(upstream, consumerRange);
+      if (!needed.isValid()) {
+        continue;
+      }
+      TimeSeriesFilter::_sp filter = boost::dynamic_pointer_cast<TimeSeriesFilter>(upstream);
+      if (filter && filter->canDropPoints()) {
+        // a consumer finds the points just outside its range with pointBefore / pointAfter, and on a
+        // filter that can drop points those search a stride at a time. cover the first stride each way.
+        needed.start -= RTX_FILTER_SEEK_STRIDE;
+        needed.end += RTX_FILTER_SEEK_STRIDE;
+      }
+      TimeRange known = this->rangeForSeries(upstream);
+      if (known.isValid()) {
+        needed.start = min(needed.start, known.start);
+        needed.end = max(needed.end, known.end);
+      }
+      _ranges[upstream] = needed;
+    }
+  }
+}
+
+
+void TimeSeriesEvaluationPlan::visit(TimeSeries::_sp ts, std::map<TimeSeries::_sp, int>& state) {
+  // state: 1 = on the current path, 2 = done
+  int& s = state[ts];
+  if (s == 2) {
+    return;
+  }
+  if (s == 1) {
+    throw RtxException("TimeSeries graph contains a cycle at \"" + ts->name() + "\"");
+  }
+  s = 1;
+  BOOST_FOREACH(TimeSeries::_sp upstream, ts->upstreamSeries()) {
+    if (upstream) {
+      this->visit(upstream, state);
+    }
+  }
+  state[ts] = 2;
+  _nodes.push_back(ts);
+}
@@ -0,0 +1,80 @@
+//
+//  TimeSeriesEvaluationPlan.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__TimeSeriesEvaluationPlan__
+#define __epanet_rtx__TimeSeriesEvaluationPlan__
+
+#include <vector>
+#include <map>
+#include <iostream>
+
+#include "rtxMacros.h"
+#include "TimeSeries.h"
+#include "PointRecord.h"
+
+namespace RTX {
+
+  /*!
+   \class TimeSeriesEvaluationPlan
+   \brief Pull-based evaluation of a TimeSeries graph over a single time range.
+
+   Asking a sink for points(range) lets every filter fetch its own inputs, so a series that feeds several stages (or several sinks) is queried once per consumer, and each query is only as wide as that consumer needs. The plan instead walks the graph from the sinks back to the roots, orders the nodes so that every series comes after its inputs, and asks each node (via TimeSeries::upstreamRange) exactly which range of its inputs it will read. The union of those ranges is what each input has to produce.
+
+   evaluate() then fetches each root once over its full range, and runs the stages in order. Intermediate stages that do not keep a buffer of their own are given a temporary BufferPointRecord for the duration of the evaluation, so that downstream reads are served from memory. Original records are restored afterwards.
+
+   The plan swaps records on the nodes of the graph while it runs: do not evaluate a plan while other threads are reading from the same series.
+   */
+
+  /*!
+   \fn TimeSeriesEvaluationPlan::TimeSeriesEvaluationPlan(TimeSeries::_sp sink, TimeRange range)
+   \brief Plan the evaluation of one series over a range.
+
+   \fn void TimeSeriesEvaluationPlan::evaluate()
+   \brief Fetch the roots and run every stage in topological order. Results are available from points(sink).
+
+   \fn void TimeSeriesEvaluationPlan::preFetchRoots()
+   \brief Load every database-backed root into its record's buffer, one DbPointRecord::preFetchRanges call per record and range, so that many roots cost a single query. evaluate() starts with this.
+
+   \fn TimeRange TimeSeriesEvaluationPlan::rangeForSeries(TimeSeries::_sp ts)
+   \brief The (widened) range a node of the graph is asked to produce, or an invalid range if the series is not part of the plan.
+   */
+
+  class TimeSeriesEvaluationPlan {
+  public:
+    RTX_SHARED_POINTER(TimeSeriesEvaluationPlan);
+    TimeSeriesEvaluationPlan(TimeSeries::_sp sink, TimeRange range);
+    TimeSeriesEvaluationPlan(std::vector<TimeSeries::_sp> sinks, TimeRange range);
+
+    void evaluate();
+    void preFetchRoots();
+
+    std::vector<TimeSeries::_sp> nodes(); // roots first, sinks last
+    std::vector<TimeSeries::_sp> roots();
+    std::vector<TimeSeries::_sp> sinks();
+    TimeRange range();
+    TimeRange rangeForSeries(TimeSeries::_sp ts);
+    std::vector<Point> points(TimeSeries::_sp sink); // results of the last evaluate()
+
+    std::ostream& toStream(std::ostream &stream);
+
+  private:
+    void build();
+    void visit(TimeSeries::_sp ts, std::map<TimeSeries::_sp, int>& state);
+
+    std::vector<TimeSeries::_sp> _sinks;
+    TimeRange _range;
+    std::vector<TimeSeries::_sp> _nodes;
+    std::map<TimeSeries::_sp, TimeRange> _ranges;
+    std::map<TimeSeries::_sp, std::vector<Point> > _results;
+  };
+
+  std::ostream& operator<< (std::ostream &out, TimeSeriesEvaluationPlan &plan);
+
+}
+
+#endif /* defined(__epanet_rtx__TimeSeriesEvaluationPlan__) */
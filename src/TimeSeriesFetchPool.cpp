@@ -0,0 +1,299 @@
+//
+//  TimeSeriesFetchPool.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "TimeSeriesFetchPool.h"
+#include "TimeSeriesEvaluationPlan.h"
+#include "DbPointRecord.h"
+
+#include <deque>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <exception>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+using namespace RTX;
+using namespace std;
+
+namespace {
+
+  boost::thread_specific_ptr<bool> _isFetchWorker;
+
+  // a handful of long-lived workers, started on demand.
+  class _FetchPool {
+  public:
+    _FetchPool() : _nWorkers(0), _nIdle(0) {
+      unsigned int hw = boost::thread::hardware_concurrency();
+      _maxThreads = (hw > 1) ? (size_t)hw : 4; // mostly waiting on i/o, so don't go below a few.
+    };
+
+    void submit(boost::function<void()> task) {
+      boost::mutex::scoped_lock lock(_mutex);
+      _queue.push_back(task);
+      if (_nWorkers < _maxThreads && _nIdle < _queue.size()) {
+        ++_nWorkers;
+        boost::thread worker(&_FetchPool::work, this);
+        worker.detach();
+      }
+      _hasWork.notify_one();
+    };
+
+    size_t maxThreads() {
+      boost::mutex::scoped_lock lock(_mutex);
+      return _maxThreads;
+    };
+
+    void setMaxThreads(size_t n) {
+      boost::mutex::scoped_lock lock(_mutex);
+      _maxThreads = (n > 0) ? n : 1;
+      _hasWork.notify_all(); // surplus idle workers exit
+    };
+
+  private:
+    void work() {
+      _isFetchWorker.reset(new bool(true));
+      while (true) {
+        boost::function<void()> task;
+        {
+          boost::mutex::scoped_lock lock(_mutex);
+          ++_nIdle;
+          while (_queue.empty() && _nWorkers <= _maxThreads) {
+            _hasWork.wait(lock);
+          }
+          --_nIdle;
+          if (_nWorkers > _maxThreads) {
+            --_nWorkers; // pool was shrunk
+            _hasWork.notify_one(); // let someone else pick up any queued work
+            return;
+          }
+          task = _queue.front();
+          _queue.pop_front();
+        }
+        task();
+      }
+    };
+
+    std::deque< boost::function<void()> > _queue;
+    boost::mutex _mutex;
+    boost::condition_variable _hasWork;
+    size_t _maxThreads, _nWorkers, _nIdle;
+  };
+
+  _FetchPool& _pool() {
+    static _FetchPool* pool = new _FetchPool(); // never destroyed: detached workers may outlive static destruction.
+    return *pool;
+  }
+
+
+  // completion state for one call to pointCollections
+  class _FetchBatch {
+  public:
+    _FetchBatch(size_t n) : remaining(n) {};
+    boost::mutex mutex;
+    boost::condition_variable finished;
+    size_t remaining;
+    std::exception_ptr error;
+  };
+
+
+  // every record in the branch that limits its readers, in a fixed (address) order.
+  std::vector<PointRecord::_sp> _boundedRecords(TimeSeries::_sp ts) {
+    set<TimeSeries::_sp> visited;
+    set<PointRecord::_sp> records;
+    vector<TimeSeries::_sp> stack(1, ts);
+    while (!stack.empty()) {
+      TimeSeries::_sp node = stack.back();
+      stack.pop_back();
+      if (!node || !visited.insert(node).second) {
+        continue;
+      }
+      PointRecord::_sp record = node->record();
+      if (record && record->maxConcurrentReads() > 0) {
+        records.insert(record);
+      }
+      BOOST_FOREACH(TimeSeries::_sp upstream, node->upstreamSeries()) {
+        stack.push_back(upstream);
+      }
+    }
+    return vector<PointRecord::_sp>(records.begin(), records.end());
+  }
+
+
+  TimeRange _fixedRange(TimeSeries::_sp ts, TimeRange range) {
+    return range;
+  }
+
+
+  typedef vector< pair<TimeSeries::_sp, TimeRange> > rootRanges_t;
+
+  // the range a branch is fetched over, and the range each of its roots will be read over.
+  void _planBranch(TimeSeries::_sp ts, TimeSeriesFetchPool::RangeFunction rangeForSeries, TimeRange* range, rootRanges_t* roots) {
+    *range = rangeForSeries(ts);
+    if (!range->isValid()) {
+      return;
+    }
+    TimeSeriesEvaluationPlan plan(ts, *range);
+    BOOST_FOREACH(TimeSeries::_sp root, plan.roots()) {
+      roots->push_back(make_pair(root, plan.rangeForSeries(root)));
+    }
+  }
+
+
+  // load the database-backed roots of every branch before any branch runs. roots that share a record and
+  // whose ranges overlap are selected together, over the span of their ranges, so they cost one query per
+  // record instead of one per branch.
+  void _preFetchRoots(const std::vector<rootRanges_t>& branches) {
+    typedef pair<time_t, pair<time_t,string> > rootRange_t; // start, (end, name)
+    map<DbPointRecord::_sp, vector<rootRange_t> > byRecord;
+    BOOST_FOREACH(const rootRanges_t& roots, branches) {
+      BOOST_FOREACH(const rootRanges_t::value_type& root, roots) {
+        TimeRange r = root.second;
+        DbPointRecord::_sp record = boost::dynamic_pointer_cast<DbPointRecord>(root.first->record());
+        if (r.isValid() && record) {
+          byRecord[record].push_back(make_pair(r.start, make_pair(r.end, root.first->name())));
+        }
+      }
+    }
+    typedef pair<const DbPointRecord::_sp, vector<rootRange_t> > recordPair_t;
+    BOOST_FOREACH(recordPair_t& entry, byRecord) {
+      vector<rootRange_t>& roots = entry.second;
+      sort(roots.begin(), roots.end());
+      size_t first = 0;
+      while (first < roots.size()) {
+        vector<string> names;
+        time_t start = roots[first].first, end = roots[first].second.first;
+        size_t next = first;
+        while (next < roots.size() && roots[next].first <= end) {
+          end = max(end, roots[next].second.first);
+          names.push_back(roots[next].second.second);
+          ++next;
+        }
+        entry.first->preFetchRanges(names, start, end);
+        first = next;
+      }
+    }
+  }
+
+
+  void _pointsOfBranch(TimeSeries::_sp ts, TimeRange range, TimeSeries::PointCollection* out) {
+    *out = ts->pointCollection(range);
+  }
+
+
+  void _runBranch(TimeSeries::_sp ts, boost::function<void()> work, _FetchBatch* batch) {
+    std::exception_ptr error;
+    vector<PointRecord::_sp> slots = _boundedRecords(ts);
+    size_t nAcquired = 0;
+    try {
+      BOOST_FOREACH(PointRecord::_sp record, slots) {
+        record->acquireReadSlot();
+        ++nAcquired;
+      }
+      work();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    for (size_t i = nAcquired; i > 0; --i) {
+      slots[i-1]->releaseReadSlot();
+    }
+
+    boost::mutex::scoped_lock lock(batch->mutex);
+    if (error && !batch->error) {
+      batch->error = error;
+    }
+    if (--batch->remaining == 0) {
+      batch->finished.notify_all();
+    }
+  }
+
+
+  // run one piece of work per non-null series on the pool, holding that branch's read slots. waits for all of them.
+  void _runBranches(const std::vector<TimeSeries::_sp>& series, const std::vector< boost::function<void()> >& work) {
+    _FetchBatch batch(series.size());
+    for (size_t i = 0; i < series.size(); ++i) {
+      if (!series[i]) {
+        boost::mutex::scoped_lock lock(batch.mutex);
+        --batch.remaining;
+        continue;
+      }
+      _pool().submit(boost::bind(&_runBranch, series[i], work[i], &batch));
+    }
+
+    boost::mutex::scoped_lock lock(batch.mutex);
+    while (batch.remaining > 0) {
+      batch.finished.wait(lock);
+    }
+    if (batch.error) {
+      std::rethrow_exception(batch.error);
+    }
+  }
+
+}
+
+
+std::vector<TimeSeries::PointCollection> TimeSeriesFetchPool::pointCollections(const std::vector<TimeSeries::_sp>& series, TimeRange range) {
+  return TimeSeriesFetchPool::pointCollections(series, boost::bind(&_fixedRange, boost::placeholders::_1, range));
+}
+
+std::vector<TimeSeries::PointCollection> TimeSeriesFetchPool::pointCollections(const std::vector<TimeSeries::_sp>& series, RangeFunction rangeForSeries) {
+
+  vector<TimeSeries::PointCollection> collections(series.size());
+  vector<TimeRange> ranges(series.size());
+  vector<rootRanges_t> roots(series.size());
+
+  // serial: nothing to overlap, parallelism is off, or we're already inside a branch.
+  if (series.size() < 2 || TimeSeriesFetchPool::maxThreads() < 2 || _isFetchWorker.get()) {
+    if (series.size() > 1) {
+      for (size_t i = 0; i < series.size(); ++i) {
+        if (series[i]) {
+          _planBranch(series[i], rangeForSeries, &ranges[i], &roots[i]);
+        }
+      }
+      _preFetchRoots(roots);
+    }
+    else if (series.size() == 1 && series[0]) {
+      ranges[0] = rangeForSeries(series[0]);
+    }
+    for (size_t i = 0; i < series.size(); ++i) {
+      if (series[i]) {
+        collections[i] = series[i]->pointCollection(ranges[i]);
+      }
+    }
+    return collections;
+  }
+
+  // plan the branches first (any seeking that takes overlaps), then load every root in as few queries
+  // as possible, then run the branches themselves, which read their roots from cache.
+  vector< boost::function<void()> > work(series.size());
+  for (size_t i = 0; i < series.size(); ++i) {
+    work[i] = boost::bind(&_planBranch, series[i], rangeForSeries, &ranges[i], &roots[i]);
+  }
+  _runBranches(series, work);
+
+  _preFetchRoots(roots);
+
+  for (size_t i = 0; i < series.size(); ++i) {
+    work[i] = boost::bind(&_pointsOfBranch, series[i], ranges[i], &collections[i]);
+  }
+  _runBranches(series, work);
+
+  return collections;
+}
+
+
+size_t TimeSeriesFetchPool::maxThreads() {
+  return _pool().maxThreads();
+}
+
+void TimeSeriesFetchPool::setMaxThreads(size_t n) {
+  _pool().setMaxThreads(n);
+}
@@ -0,0 +1,52 @@
+//
+//  TimeSeriesFetchPool.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__TimeSeriesFetchPool__
+#define __epanet_rtx__TimeSeriesFetchPool__
+
+#include <vector>
+#include <boost/function.hpp>
+
+#include "TimeSeries.h"
+#include "TimeRange.h"
+
+namespace RTX {
+
+  /*!
+   \class TimeSeriesFetchPool
+   \brief Fetches independent branches of a TimeSeries graph on a shared pool of worker threads.
+
+   Each series is fetched exactly as series->pointCollection(range) would fetch it, so results are identical to a serial loop; only the waiting overlaps. Before a branch runs, its worker takes a read slot on every record in that branch that sets a concurrency limit (PointRecord::setMaxConcurrentReads), so a backend never sees more simultaneous readers than it allows. Slots are taken in a fixed order, so branches that share records can't deadlock.
+
+   Once every branch's range is known, the database-backed roots of all the branches are loaded before any branch runs: roots in the same record whose ranges overlap are selected in one DbPointRecord::preFetchRanges call. Branches then read their roots from cache, so a record that allows a single reader is not held for a round trip per branch.
+
+   Fetches requested from a worker thread (a filter inside a branch fanning out again) run serially on that worker.
+   */
+
+  /*!
+   \fn static std::vector<TimeSeries::PointCollection> TimeSeriesFetchPool::pointCollections(const std::vector<TimeSeries::_sp>& series, RangeFunction rangeForSeries)
+   \brief Fetch several series, each over its own range.
+   \param series The series to fetch. Null entries yield empty collections.
+   \param rangeForSeries Called once per series, on the workers, before any branch fetches points, so that any seeking it does overlaps too and the roots of every branch can be loaded together.
+   \return One collection per series, in the order given. If any fetch throws, the first exception is rethrown once every branch has finished.
+   */
+
+  class TimeSeriesFetchPool {
+  public:
+    typedef boost::function<TimeRange(TimeSeries::_sp)> RangeFunction;
+    
+    static std::vector<TimeSeries::PointCollection> pointCollections(const std::vector<TimeSeries::_sp>& series, RangeFunction rangeForSeries);
+    static std::vector<TimeSeries::PointCollection> pointCollections(const std::vector<TimeSeries::_sp>& series, TimeRange range);
+
+    static size_t maxThreads();
+    static void setMaxThreads(size_t n); // 1 disables parallel fetching.
+  };
+
+}
+
+#endif /* defined(__epanet_rtx__TimeSeriesFetchPool__) */
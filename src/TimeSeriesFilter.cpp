@@ -77,22 +77,25 @@ vector<Point> TimeSeriesFilter::points(TimeRange range) {
     return filtered;
   }
   
-  set<time_t> pointTimes;
+  TimeGrid pointTimes;
   
   if (this->canDropPoints()) {
     // optmized fetching: we know we're going to use these same points...
     PointCollection c = this->filterPointsInRange(range);
-    cached = c.points;
     pointTimes = c.times();
+    cached.swap(c.points);
   }
   else {
-    pointTimes = this->timeValuesInRange(range);
     cached = TimeSeries::points(range); // base class call -> find any pre-cached points
+    if (cached.size() > 0) {
+      // only worth asking for the time values if there is something to compare them with
+      pointTimes = this->timeValuesInRange(range);
+    }
   }
   
   // important optimization. if this range has already been constructed and cached, then don't recreate it.
   bool alreadyCached = false;
-  if (cached.size() == pointTimes.size()) {
+  if (cached.size() == pointTimes.size() && (cached.size() > 0 || this->canDropPoints())) {
     // looks good, let's make sure that all time values line up.
     alreadyCached = true;
     BOOST_FOREACH(const Point& p, cached) {
@@ -108,9 +111,9 @@ vector<Point> TimeSeriesFilter::points(TimeRange range) {
   
   PointCollection outCollection = this->filterPointsInRange(range);
   this->insertPoints(outCollection.points);
-  outCollection = outCollection.trimmedToRange(range); // safeguard if filter doesn't respected the range
+  outCollection.trimToRange(range); // safeguard if filter doesn't respected the range
 
-  return outCollection.points;
+  return std::move(outCollection.points);
 }
 
 
@@ -126,7 +129,7 @@ Point TimeSeriesFilter::pointBefore(time_t time) {
   if (this->canDropPoints()) {
     // search iteratively?
     
-    time_t stride = 60*60*12; // 12 hour
+    time_t stride = RTX_FILTER_SEEK_STRIDE;
     PointCollection c;
     
     TimeRange q(time - stride, time - 1);
@@ -167,7 +170,7 @@ Point TimeSeriesFilter::pointAfter(time_t time) {
   if (this->canDropPoints()) {
     // search iteratively?
     
-    time_t stride = 60*60*12; // 12 hour
+    time_t stride = RTX_FILTER_SEEK_STRIDE;
     
     PointCollection c;
     TimeRange q(time + 1, time + stride);
@@ -235,13 +238,16 @@ bool TimeSeriesFilter::willResample() {
 }
 
 
-TimeSeries::PointCollection TimeSeriesFilter::filterPointsInRange(TimeRange range) {
+TimeRange TimeSeriesFilter::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
   
   TimeRange queryRange = range;
   if (this->willResample()) {
     // expand range
-    queryRange.start = this->source()->timeBefore(range.start + 1);
-    queryRange.end = this->source()->timeAfter(range.end - 1);
+    queryRange.start = upstream->timeBefore(range.start + 1);
+    queryRange.end = upstream->timeAfter(range.end - 1);
   }
   
   
@@ -249,21 +255,28 @@ TimeSeries::PointCollection TimeSeriesFilter::filterPointsInRange(TimeRange rang
   // i.e.,   ******[******-------]-------
   if (!queryRange.isValid()) {
     if (queryRange.start == 0) {
-      queryRange.start = this->source()->timeAfter(range.start); // go to next available point.
+      queryRange.start = upstream->timeAfter(range.start); // go to next available point.
     }
     if (queryRange.end == 0) {
-      queryRange.end = this->source()->timeBefore(range.end); // go to previous availble point.
+      queryRange.end = upstream->timeBefore(range.end); // go to previous availble point.
     }
   }
   
   queryRange.correctWithRange(range);
+  return queryRange;
+}
+
+
+TimeSeries::PointCollection TimeSeriesFilter::filterPointsInRange(TimeRange range) {
+  
+  TimeRange queryRange = this->upstreamRange(this->source(), range);
   
   PointCollection data = source()->pointCollection(queryRange);
   
   bool dataOk = false;
   dataOk = data.convertToUnits(this->units());
   if (dataOk && this->willResample()) {
-    set<time_t> timeValues = this->timeValuesInRange(range);
+    TimeGrid timeValues = this->timeValuesInRange(range);
     dataOk = data.resample(timeValues, _resampleMode);
   }
   
@@ -275,8 +288,8 @@ TimeSeries::PointCollection TimeSeriesFilter::filterPointsInRange(TimeRange rang
 }
 
 
-set<time_t> TimeSeriesFilter::timeValuesInRange(TimeRange range) {
-  set<time_t> times;
+TimeGrid TimeSeriesFilter::timeValuesInRange(TimeRange range) {
+  TimeGrid times;
   
   if (!range.isValid() || !this->source()) {
     return times;
@@ -373,5 +386,13 @@ TimeSeries::_sp TimeSeriesFilter::rootTimeSeries() {
   return source;
 }
 
+vector<TimeSeries::_sp> TimeSeriesFilter::upstreamSeries() {
+  vector<TimeSeries::_sp> upstream;
+  if (this->source()) {
+    upstream.push_back(this->source());
+  }
+  return upstream;
+}
+
 
 
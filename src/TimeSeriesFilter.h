@@ -20,15 +20,15 @@ namespace RTX {
   
   
   /*!
-   \fn virtual std::set<time_t> TimeSeriesFilter::timeValuesInRange(TimeRange range)
+   \fn virtual TimeGrid TimeSeriesFilter::timeValuesInRange(TimeRange range)
    \brief Allow derived classes to specify the occurence of points in time. Optional.
    \param range The time range over which to report time values.
-   \return A set of time values where the Time Series may provide points.
+   \return A TimeGrid of time values where the Time Series may provide points.
   
    Overriding this method is optional. Base functionality reports clock ticks if there is a clock, or the time values for this object's source points, if a source is set.
    */
   /*!
-   \fn virtual PointCollection TimeSeriesFilter::filterPointsAtTimes(std::set<time_t> times)
+   \fn virtual PointCollection TimeSeriesFilter::filterPointsAtTimes(const TimeGrid& times)
    \brief Generate time series values at given points.
    \param times The list of times for which to provide filtered data.
    \return A PointCollection containing the filtered data.
@@ -83,11 +83,13 @@ namespace RTX {
     virtual bool canDropPoints() { return false; };
     
     virtual TimeSeries::_sp rootTimeSeries();
+    virtual std::vector<TimeSeries::_sp> upstreamSeries();
+    virtual TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     
     // methods you must override to provide info to the base class
     virtual PointCollection filterPointsInRange(TimeRange range);
     
-    virtual std::set<time_t> timeValuesInRange(TimeRange range);
+    virtual TimeGrid timeValuesInRange(TimeRange range);
     virtual time_t timeAfter(time_t t);
     virtual time_t timeBefore(time_t t);
     
@@ -14,21 +14,31 @@ using namespace std;
 
 
 
-TimeSeries::PointCollection TimeSeriesFilterSinglePoint::filterPointsInRange(TimeRange range) {
+TimeRange TimeSeriesFilterSinglePoint::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
   
   TimeRange qRange = range;
   if (this->willResample()) {
     // expand range
-    qRange.start = this->source()->timeBefore(range.start + 1);
-    qRange.end = this->source()->timeAfter(range.end - 1);
+    qRange.start = upstream->timeBefore(range.start + 1);
+    qRange.end = upstream->timeAfter(range.end - 1);
   }
   
   qRange.correctWithRange(range);
-//  PointCollection sourceData = this->source()->pointCollection(qRange);
+  return qRange;
+}
+
+
+TimeSeries::PointCollection TimeSeriesFilterSinglePoint::filterPointsInRange(TimeRange range) {
+  
+  TimeRange qRange = TimeSeriesFilterSinglePoint::upstreamRange(this->source(), range);
   
   PointCollection data = source()->pointCollection(qRange);
   
   vector<Point> outPoints;
+  outPoints.reserve(data.points.size());
   bool didDropPoints = false;
   
   BOOST_FOREACH(const Point& sourcePoint, data.points) {
@@ -42,9 +52,9 @@ TimeSeries::PointCollection TimeSeriesFilterSinglePoint::filterPointsInRange(Tim
   }
   
   
-  PointCollection outData(outPoints, this->units());
+  PointCollection outData(std::move(outPoints), this->units());
   if (this->willResample() || (didDropPoints && this->clock())) {
-    set<time_t> timeValues = this->timeValuesInRange(range); // if infinite recursion occurs here, check canDropPoints
+    TimeGrid timeValues = this->timeValuesInRange(range); // if infinite recursion occurs here, check canDropPoints
     outData.resample(timeValues);
   }
   
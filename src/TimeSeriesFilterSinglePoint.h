@@ -16,6 +16,7 @@ namespace RTX {
   class TimeSeriesFilterSinglePoint : public TimeSeriesFilter {
   protected:
     PointCollection filterPointsInRange(TimeRange range); // non-virtual
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     virtual Point filteredWithSourcePoint(Point sourcePoint) = 0; // pure virtual. override must convert units.
   };
 }
@@ -0,0 +1,99 @@
+//
+//  TimeSeriesReadAhead.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "TimeSeriesReadAhead.h"
+
+#include <iostream>
+#include <exception>
+#include <boost/foreach.hpp>
+
+using namespace RTX;
+using namespace std;
+
+
+TimeSeriesReadAhead::TimeSeriesReadAhead(const std::vector<TimeSeries::_sp>& series, time_t window) : _window(window), _time(0), _loadedUntil(0), _hasTime(false), _shouldStop(false) {
+  BOOST_FOREACH(TimeSeries::_sp ts, series) {
+    DbPointRecord::_sp record = ts ? boost::dynamic_pointer_cast<DbPointRecord>(ts->record()) : DbPointRecord::_sp();
+    if (record) {
+      _batches[record].push_back(ts->name());
+    }
+  }
+  if (!_batches.empty() && _window > 0) {
+    boost::thread worker(&TimeSeriesReadAhead::run, this);
+    _thread.swap(worker);
+  }
+}
+
+TimeSeriesReadAhead::~TimeSeriesReadAhead() {
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _shouldStop = true;
+  }
+  _advanced.notify_all();
+  if (_thread.joinable()) {
+    _thread.join();
+  }
+}
+
+
+void TimeSeriesReadAhead::advanceTo(time_t time) {
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _time = time;
+    _hasTime = true;
+  }
+  _advanced.notify_one();
+}
+
+time_t TimeSeriesReadAhead::window() {
+  return _window;
+}
+
+time_t TimeSeriesReadAhead::loadedUntil() {
+  boost::mutex::scoped_lock lock(_mutex);
+  return _loadedUntil;
+}
+
+
+bool TimeSeriesReadAhead::needsRefill() {
+  return _hasTime && _loadedUntil < _time + _window / 2;
+}
+
+void TimeSeriesReadAhead::run() {
+  while (true) {
+    time_t from, to;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      while (!_shouldStop && !this->needsRefill()) {
+        _advanced.wait(lock);
+      }
+      if (_shouldStop) {
+        return;
+      }
+      // pick up where the last refill stopped, unless the clock has already passed it.
+      from = (_loadedUntil == 0) ? _time - _window : max(_loadedUntil, _time);
+      to = _time + _window;
+    }
+
+    typedef pair<const DbPointRecord::_sp, vector<string> > batchPair_t;
+    BOOST_FOREACH(const batchPair_t& batch, _batches) {
+      // count as one of the record's readers, like any fetch branch does.
+      batch.first->acquireReadSlot();
+      try {
+        batch.first->preFetchRanges(batch.second, from, to);
+      } catch (std::exception& e) {
+        // readers will select for themselves.
+        cerr << "RTX read-ahead failed :: " << from << " - " << to << " :: " << e.what() << endl;
+      }
+      batch.first->releaseReadSlot();
+    }
+
+    boost::mutex::scoped_lock lock(_mutex);
+    _loadedUntil = to;
+  }
+}
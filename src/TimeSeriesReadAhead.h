@@ -0,0 +1,72 @@
+//
+//  TimeSeriesReadAhead.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__TimeSeriesReadAhead__
+#define __epanet_rtx__TimeSeriesReadAhead__
+
+#include <vector>
+#include <map>
+#include <string>
+#include <boost/thread.hpp>
+
+#include "rtxMacros.h"
+#include "TimeSeries.h"
+#include "DbPointRecord.h"
+
+namespace RTX {
+
+  /*!
+   \class TimeSeriesReadAhead
+   \brief Keeps a window of database-backed series loaded ahead of a moving clock, on a background thread.
+
+   Made for simulation inputs: Model::runExtendedPeriod reads every boundary series at each step, and a read past the end of what a DbPointRecord has buffered waits on a select. The read-ahead is told the simulation time at each step with advanceTo(), and whenever less than half a window is loaded beyond that time, it loads up to one full window ahead. Series that share a record are loaded together (DbPointRecord::preFetchRanges), so each refill costs one query per record. Each of those queries holds one of the record's read slots (PointRecord::setMaxConcurrentReads) while it runs, so the read-ahead never adds a reader beyond the record's limit.
+
+   The first refill also reaches one window back, so the point at or before the starting time is in memory too. A reader that gets ahead of the read-ahead joins its select rather than issuing its own. If a refill fails, the error is logged and the readers fetch as they would without a read-ahead.
+
+   Only series whose record is a DbPointRecord are loaded; others are ignored. Destroying the read-ahead waits for a refill in progress.
+   */
+
+  /*!
+   \fn TimeSeriesReadAhead::TimeSeriesReadAhead(const std::vector<TimeSeries::_sp>& series, time_t window)
+   \brief Start a read-ahead for some series. Nothing is loaded until the first advanceTo().
+   \param series The series to keep loaded; normally roots (see TimeSeries::rootTimeSeries).
+   \param window How far past the clock to load, in seconds.
+
+   \fn void TimeSeriesReadAhead::advanceTo(time_t time)
+   \brief Move the clock. Returns at once; any refill happens on the background thread.
+   */
+
+  class TimeSeriesReadAhead {
+  public:
+    RTX_SHARED_POINTER(TimeSeriesReadAhead);
+    TimeSeriesReadAhead(const std::vector<TimeSeries::_sp>& series, time_t window);
+    ~TimeSeriesReadAhead();
+
+    void advanceTo(time_t time);
+    time_t window();
+    time_t loadedUntil(); // 0 before the first refill completes
+
+  private:
+    TimeSeriesReadAhead(const TimeSeriesReadAhead&);
+    TimeSeriesReadAhead& operator=(const TimeSeriesReadAhead&);
+
+    void run();
+    bool needsRefill(); // caller holds _mutex
+
+    std::map<DbPointRecord::_sp, std::vector<std::string> > _batches; // series names, by record
+    const time_t _window;
+    time_t _time, _loadedUntil;
+    bool _hasTime, _shouldStop;
+    boost::mutex _mutex;
+    boost::condition_variable _advanced;
+    boost::thread _thread;
+  };
+
+}
+
+#endif /* defined(__epanet_rtx__TimeSeriesReadAhead__) */
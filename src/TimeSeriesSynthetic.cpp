@@ -57,9 +57,7 @@ vector< Point > TimeSeriesSynthetic::points(TimeRange range) {
     return outPoints;
   }
   
-  set<time_t> times;
-  
-  times = this->clock()->timeValuesInRange(range);
+  TimeGrid times = this->clock()->timeValuesInRange(range);
   outPoints.reserve(times.size());
   
   BOOST_FOREACH(time_t now, times) {
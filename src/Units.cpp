@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 #include <deque>
+#include <algorithm>
 #include "Units.h"
 #include "rtxMacros.h"
 
@@ -201,6 +202,20 @@ double Units::convertValue(double value, const Units& fromUnits, const Units& to
   }
 }
 
+void Units::convertValues(std::vector<double>& values, const Units& fromUnits, const Units& toUnits) {
+  if (!fromUnits.isSameDimensionAs(toUnits)) {
+    cerr << "Units are not dimensionally consistent" << endl;
+    std::fill(values.begin(), values.end(), 0.);
+    return;
+  }
+  // same arithmetic as convertValue, in a loop the compiler can vectorize
+  const double fromOffset = fromUnits._offset, fromConversion = fromUnits._conversion;
+  const double toOffset = toUnits._offset, toConversion = toUnits._conversion;
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = ((values[i] + fromOffset) * fromConversion / toConversion) - toOffset;
+  }
+}
+
 
 std::map<std::string, Units> Units::unitStringMap = []()
 {
@@ -11,6 +11,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 // convenience defines ------------ unit= conversion,   dimension (m,l,t,current,temp,amount,intensity)
 #define RTX_NO_UNITS                RTX::Units(0)
@@ -121,6 +122,7 @@ namespace RTX {
     bool isDimensionless();
     double conversion() const;
     static double convertValue(double value, const Units& fromUnits, const Units& toUnits);
+    static void convertValues(std::vector<double>& values, const Units& fromUnits, const Units& toUnits); // in place
     static Units unitOfType(const std::string& unitString);
     static std::map<std::string, Units> unitStringMap;
     std::string unitString();
@@ -32,7 +32,10 @@ bool ValidRangeTimeSeries::willResample() {
 
 
 
-TimeSeries::PointCollection ValidRangeTimeSeries::filterPointsInRange(TimeRange range) {
+TimeRange ValidRangeTimeSeries::upstreamRange(TimeSeries::_sp upstream, TimeRange range) {
+  if (!upstream || upstream != this->source()) {
+    return TimeRange();
+  }
   
   // if we are to resample, then there's a possibility that we need to expand the range
   // used to query the source ts. but we have to limit the search to something reasonable, in case
@@ -44,6 +47,13 @@ TimeSeries::PointCollection ValidRangeTimeSeries::filterPointsInRange(TimeRange
     sourceQuery.start -= range.duration();
     sourceQuery.end += range.duration();
   }
+  return sourceQuery;
+}
+
+
+TimeSeries::PointCollection ValidRangeTimeSeries::filterPointsInRange(TimeRange range) {
+  
+  TimeRange sourceQuery = this->upstreamRange(this->source(), range);
   
   // get raw values, exclude outliers, then resample if needed.
   PointCollection raw = this->source()->pointCollection(sourceQuery);
@@ -79,7 +89,7 @@ TimeSeries::PointCollection ValidRangeTimeSeries::filterPointsInRange(TimeRange
   }
   
   if (this->willResample()) {
-    set<time_t> resTimes = this->timeValuesInRange(range);
+    TimeGrid resTimes = this->timeValuesInRange(range);
     outData.resample(resTimes);
   }
   
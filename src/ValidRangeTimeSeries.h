@@ -29,6 +29,7 @@ namespace RTX {
   protected:
     virtual bool willResample(); // we are special !
     PointCollection filterPointsInRange(TimeRange range);
+    TimeRange upstreamRange(TimeSeries::_sp upstream, TimeRange range);
     bool canDropPoints() { return true;};
     
   private:
@@ -26,5 +26,21 @@
 #define RTX_BUFFER_DEFAULT_CACHESIZE 100
 #endif
 
+#ifndef RTX_BUFFER_DEFAULT_BUDGET
+#define RTX_BUFFER_DEFAULT_BUDGET (256*1024*1024) // bytes of points per BufferPointRecord
+#endif
+
+#ifndef RTX_APPEND_BLOCK_SIZE
+#define RTX_APPEND_BLOCK_SIZE 1024 // points in an AppendPointRecord series' first block; each next block doubles
+#endif
+
+#ifndef RTX_BUFFER_CHUNK_DURATION
+#define RTX_BUFFER_CHUNK_DURATION (60*60*6) // seconds of one series evicted at a time
+#endif
+
+#ifndef RTX_FILTER_SEEK_STRIDE
+#define RTX_FILTER_SEEK_STRIDE (60*60*12) // seconds a filter that can drop points is searched at a time, for the point before or after a time
+#endif
+
 
 #endif